@@ -42,7 +42,7 @@
 #define PING_DELAY_ON_TIMEOUT 3
 #define MAX_RETRY_COUNT (5)
 
-struct oc_memb rep_objects_pool = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+struct oc_memb rep_objects_pool = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
 
 static void cloud_start_process(oc_cloud_context_t *ctx);
 static oc_event_callback_retval_t cloud_register(void *data);
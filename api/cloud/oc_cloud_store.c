@@ -228,11 +228,11 @@ cloud_store_load_internal(const char *store_name, oc_cloud_store_t *store)
     oc_rep_t rep_objects_pool[OC_MAX_NUM_REP_OBJECTS];
     memset(rep_objects_alloc, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(char));
     memset(rep_objects_pool, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t));
-    struct oc_memb rep_objects = { sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS,
-                                   rep_objects_alloc, (void *)rep_objects_pool,
-                                   0 };
+    struct oc_memb rep_objects =
+      OC_MEMB_INIT(sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS, rep_objects_alloc,
+                   (void *)rep_objects_pool, 0);
 #else  /* !OC_DYNAMIC_ALLOCATION */
-    struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+    struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
 #endif /* OC_DYNAMIC_ALLOCATION */
     oc_rep_set_pool(&rep_objects);
     oc_parse_rep(buf, (uint16_t)size, &rep);
@@ -18,6 +18,7 @@
 #include <oc_config.h>
 #ifdef OC_BLOCK_WISE
 #include "oc_blockwise.h"
+#include "oc_buffer.h"
 #include "oc_endpoint.h"
 #include "port/oc_log.h"
 #include "util/oc_list.h"
@@ -27,8 +28,8 @@ OC_MEMB(oc_blockwise_request_states_s, oc_blockwise_request_state_t,
         OC_MAX_NUM_CONCURRENT_REQUESTS);
 OC_MEMB(oc_blockwise_response_states_s, oc_blockwise_response_state_t,
         OC_MAX_NUM_CONCURRENT_REQUESTS);
-OC_LIST(oc_blockwise_requests);
-OC_LIST(oc_blockwise_responses);
+OC_DLIST(oc_blockwise_requests);
+OC_DLIST(oc_blockwise_responses);
 
 static oc_blockwise_state_t *
 oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
@@ -41,7 +42,8 @@ oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
   oc_blockwise_state_t *buffer = (oc_blockwise_state_t *)oc_memb_alloc(pool);
   if (buffer) {
 #ifdef OC_DYNAMIC_ALLOCATION
-    buffer->buffer = (uint8_t *)malloc(OC_MAX_APP_DATA_SIZE);
+    /* Starts at the smallest size class and grows as the payload does */
+    buffer->buffer = (uint8_t *)oc_buffer_alloc(0);
     if (!buffer->buffer) {
       oc_memb_free(pool, buffer);
       return NULL;
@@ -56,6 +58,7 @@ oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
     buffer->endpoint.next = NULL;
     oc_new_string(&buffer->href, href, href_len);
     buffer->next = NULL;
+    buffer->prev = NULL;
 #ifdef OC_CLIENT
     buffer->mid = 0;
     buffer->client_cb = NULL;
@@ -67,7 +70,7 @@ oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
 }
 
 static void
-oc_blockwise_free_buffer(oc_list_t list, struct oc_memb *pool,
+oc_blockwise_free_buffer(oc_dlist_t list, struct oc_memb *pool,
                          oc_blockwise_state_t *buffer)
 {
 
@@ -80,9 +83,9 @@ oc_blockwise_free_buffer(oc_list_t list, struct oc_memb *pool,
     oc_free_string(&buffer->uri_query);
   }
   oc_free_string(&buffer->href);
-  oc_list_remove(list, buffer);
+  oc_dlist_remove(list, buffer);
 #ifdef OC_DYNAMIC_ALLOCATION
-  free(buffer->buffer);
+  oc_buffer_free(buffer->buffer);
   buffer->buffer = NULL;
 #endif
   oc_memb_free(pool, buffer);
@@ -115,7 +118,7 @@ oc_blockwise_alloc_request_buffer(const char *href, size_t href_len,
   if (buffer) {
     oc_ri_add_timed_event_callback_seconds(buffer, oc_blockwise_request_timeout,
                                            OC_EXCHANGE_LIFETIME);
-    oc_list_add(oc_blockwise_requests, buffer);
+    oc_dlist_add(oc_blockwise_requests, buffer);
   }
   return (oc_blockwise_state_t *)buffer;
 }
@@ -141,7 +144,7 @@ oc_blockwise_alloc_response_buffer(const char *href, size_t href_len,
 #endif /* OC_CLIENT */
     oc_ri_add_timed_event_callback_seconds(
       buffer, oc_blockwise_response_timeout, OC_EXCHANGE_LIFETIME);
-    oc_list_add(oc_blockwise_responses, buffer);
+    oc_dlist_add(oc_blockwise_responses, buffer);
   }
   return (oc_blockwise_state_t *)buffer;
 }
@@ -164,7 +167,7 @@ oc_blockwise_free_response_buffer(oc_blockwise_state_t *buffer)
 void
 oc_blockwise_scrub_buffers_for_client_cb(void *cb)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(oc_blockwise_requests), *next;
+  oc_blockwise_state_t *buffer = oc_dlist_head(oc_blockwise_requests), *next;
   while (buffer != NULL) {
     next = buffer->next;
     if (buffer->client_cb == cb) {
@@ -173,7 +176,7 @@ oc_blockwise_scrub_buffers_for_client_cb(void *cb)
     buffer = next;
   }
 
-  buffer = oc_list_head(oc_blockwise_responses);
+  buffer = oc_dlist_head(oc_blockwise_responses);
   while (buffer != NULL) {
     next = buffer->next;
     if (buffer->client_cb == cb) {
@@ -187,7 +190,7 @@ oc_blockwise_scrub_buffers_for_client_cb(void *cb)
 void
 oc_blockwise_scrub_buffers(bool all)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(oc_blockwise_requests), *next;
+  oc_blockwise_state_t *buffer = oc_dlist_head(oc_blockwise_requests), *next;
   while (buffer != NULL) {
     next = buffer->next;
     if (buffer->ref_count == 0 || all) {
@@ -196,7 +199,7 @@ oc_blockwise_scrub_buffers(bool all)
     buffer = next;
   }
 
-  buffer = oc_list_head(oc_blockwise_responses);
+  buffer = oc_dlist_head(oc_blockwise_responses);
   while (buffer != NULL) {
     next = buffer->next;
     if (buffer->ref_count == 0 || all) {
@@ -208,10 +211,10 @@ oc_blockwise_scrub_buffers(bool all)
 
 #ifdef OC_CLIENT
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_token(oc_list_t list, uint8_t *token,
+oc_blockwise_find_buffer_by_token(oc_dlist_t list, uint8_t *token,
                                   uint8_t token_len)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  oc_blockwise_state_t *buffer = oc_dlist_head(list);
   while (buffer) {
     if (token_len > 0 && buffer->role == OC_BLOCKWISE_CLIENT &&
         buffer->token_len == token_len &&
@@ -237,9 +240,9 @@ oc_blockwise_find_response_buffer_by_token(uint8_t *token, uint8_t token_len)
 }
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_mid(oc_list_t list, uint16_t mid)
+oc_blockwise_find_buffer_by_mid(oc_dlist_t list, uint16_t mid)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  oc_blockwise_state_t *buffer = oc_dlist_head(list);
   while (buffer) {
     if (buffer->mid == mid && buffer->role == OC_BLOCKWISE_CLIENT)
       break;
@@ -261,10 +264,10 @@ oc_blockwise_find_response_buffer_by_mid(uint16_t mid)
 }
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_client_cb(oc_list_t list, oc_endpoint_t *endpoint,
+oc_blockwise_find_buffer_by_client_cb(oc_dlist_t list, oc_endpoint_t *endpoint,
                                       void *client_cb)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  oc_blockwise_state_t *buffer = oc_dlist_head(list);
   while (buffer) {
     if (buffer->role == OC_BLOCKWISE_CLIENT && buffer->client_cb == client_cb &&
         oc_endpoint_compare(endpoint, &buffer->endpoint) == 0) {
@@ -293,12 +296,12 @@ oc_blockwise_find_response_buffer_by_client_cb(oc_endpoint_t *endpoint,
 #endif /* OC_CLIENT */
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer(oc_list_t list, const char *href, size_t href_len,
+oc_blockwise_find_buffer(oc_dlist_t list, const char *href, size_t href_len,
                          oc_endpoint_t *endpoint, oc_method_t method,
                          const char *query, size_t query_len,
                          oc_blockwise_role_t role)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  oc_blockwise_state_t *buffer = oc_dlist_head(list);
   while (buffer) {
     if (strncmp(href, oc_string(buffer->href), href_len) == 0 &&
         oc_endpoint_compare(&buffer->endpoint, endpoint) == 0 &&
@@ -338,6 +341,15 @@ oc_blockwise_dispatch_block(oc_blockwise_state_t *buffer, uint32_t block_offset,
                             uint32_t *payload_size)
 {
   if (block_offset < buffer->payload_size) {
+#ifdef OC_DYNAMIC_ALLOCATION
+    /* The payload is complete once it is dispatched; release the room that
+     * was reserved for encoding it while the transfer is in progress.
+     */
+    if (block_offset == 0) {
+      buffer->buffer =
+        (uint8_t *)oc_buffer_shrink(buffer->buffer, buffer->payload_size);
+    }
+#endif /* OC_DYNAMIC_ALLOCATION */
     if (buffer->payload_size < requested_block_size)
       *payload_size = (uint32_t)buffer->payload_size;
     else {
@@ -350,6 +362,23 @@ oc_blockwise_dispatch_block(oc_blockwise_state_t *buffer, uint32_t block_offset,
   return NULL;
 }
 
+bool
+oc_blockwise_reserve_buffer(oc_blockwise_state_t *buffer, size_t size)
+{
+  if (!buffer || size > (size_t)OC_MAX_APP_DATA_SIZE) {
+    return false;
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  uint8_t *data = (uint8_t *)oc_buffer_grow(buffer->buffer, size);
+  if (!data) {
+    OC_ERR("could not grow block-wise buffer to %zu bytes", size);
+    return false;
+  }
+  buffer->buffer = data;
+#endif /* OC_DYNAMIC_ALLOCATION */
+  return true;
+}
+
 bool
 oc_blockwise_handle_block(oc_blockwise_state_t *buffer,
                           uint32_t incoming_block_offset,
@@ -363,6 +392,10 @@ oc_blockwise_handle_block(oc_blockwise_state_t *buffer,
   }
 
   if (buffer->next_block_offset == incoming_block_offset) {
+    if (!oc_blockwise_reserve_buffer(buffer, incoming_block_offset +
+                                               incoming_block_size)) {
+      return false;
+    }
     memcpy(&buffer->buffer[buffer->next_block_offset], incoming_block,
            incoming_block_size);
 
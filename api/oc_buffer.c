@@ -20,6 +20,7 @@
 #include "util/oc_memb.h"
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #ifdef OC_DYNAMIC_ALLOCATION
 #include <stdlib.h>
 #endif /* OC_DYNAMIC_ALLOCATION */
@@ -31,25 +32,474 @@
 #include "oc_buffer.h"
 #include "oc_config.h"
 #include "oc_events.h"
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+#include "util/oc_atomic_queue.h"
+#endif /* OC_LOCKFREE_NETWORK_EVENTS */
 
 OC_PROCESS(message_buffer_handler, "OC Message Buffer Handler");
 OC_MEMB(oc_incoming_buffers, oc_message_t, OC_MAX_NUM_CONCURRENT_REQUESTS);
 OC_MEMB(oc_outgoing_buffers, oc_message_t, OC_MAX_NUM_CONCURRENT_REQUESTS);
 
+static uint32_t message_drops[OC_MESSAGE_DROP_NUM_REASONS];
+
+#if defined(OC_LOCKFREE_NETWORK_EVENTS) && !defined(OC_DYNAMIC_ALLOCATION)
+/* Free blocks of the incoming pool. They are all moved here on first use and
+ * never go back to the pool, so that receive threads allocate and release
+ * incoming messages without locking. The pool counts them as used only
+ * while they are off this queue.
+ */
+OC_ATOMIC_QUEUE(incoming_free, OC_MAX_NUM_CONCURRENT_REQUESTS);
+static bool incoming_free_filled;
+
+static void
+fill_incoming_free(void)
+{
+  oc_network_event_handler_mutex_lock();
+  if (!__atomic_load_n(&incoming_free_filled, __ATOMIC_RELAXED)) {
+    void *block;
+    while ((block = oc_memb_alloc(&oc_incoming_buffers)) != NULL) {
+      oc_atomic_queue_push(&incoming_free, block);
+    }
+    oc_incoming_buffers.num_used = 0;
+#ifdef OC_MEMORY_STATS
+    oc_incoming_buffers.peak_used = 0;
+    oc_incoming_buffers.num_allocs = 0;
+    oc_incoming_buffers.num_failures = 0;
+#endif /* OC_MEMORY_STATS */
+    __atomic_store_n(&incoming_free_filled, true, __ATOMIC_RELEASE);
+  }
+  oc_network_event_handler_mutex_unlock();
+}
+#endif /* OC_LOCKFREE_NETWORK_EVENTS && !OC_DYNAMIC_ALLOCATION */
+
 static oc_message_t *
-allocate_message(struct oc_memb *pool)
+alloc_message_block(struct oc_memb *pool)
 {
+  oc_message_t *message;
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  if (pool == &oc_incoming_buffers) {
+#ifdef OC_DYNAMIC_ALLOCATION
+    message = (oc_message_t *)calloc(1, sizeof(oc_message_t));
+#else  /* OC_DYNAMIC_ALLOCATION */
+    if (!__atomic_load_n(&incoming_free_filled, __ATOMIC_ACQUIRE)) {
+      fill_incoming_free();
+    }
+    message = (oc_message_t *)oc_atomic_queue_pop(&incoming_free);
+    if (message) {
+      memset(message, 0, sizeof(oc_message_t));
+    }
+#endif /* !OC_DYNAMIC_ALLOCATION */
+    oc_memb_count_alloc(pool, message);
+    return message;
+  }
+#endif /* OC_LOCKFREE_NETWORK_EVENTS */
   oc_network_event_handler_mutex_lock();
-  oc_message_t *message = (oc_message_t *)oc_memb_alloc(pool);
+  message = (oc_message_t *)oc_memb_alloc(pool);
   oc_network_event_handler_mutex_unlock();
-  if (message) {
+  return message;
+}
+
+static void
+free_message_block(struct oc_memb *pool, oc_message_t *message)
+{
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  if (pool == &oc_incoming_buffers) {
 #ifdef OC_DYNAMIC_ALLOCATION
-    message->data = malloc(OC_PDU_SIZE);
-    if (!message->data) {
-      oc_memb_free(pool, message);
+    free(message);
+#else  /* OC_DYNAMIC_ALLOCATION */
+    /* Never full, as it has room for every block of the pool */
+    oc_atomic_queue_push(&incoming_free, message);
+#endif /* !OC_DYNAMIC_ALLOCATION */
+    oc_memb_count_free(pool);
+    if (pool->buffers_avail_cb) {
+      pool->buffers_avail_cb(oc_memb_numfree(pool));
+    }
+    return;
+  }
+#endif /* OC_LOCKFREE_NETWORK_EVENTS */
+  oc_network_event_handler_mutex_lock();
+  oc_memb_free(pool, message);
+  oc_network_event_handler_mutex_unlock();
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+/* Payload buffers are carved in a few size classes and released buffers of
+ * each class are kept on a short free list, so that small payloads do not
+ * pin a full OC_PDU_SIZE allocation. Requests above the largest class are
+ * allocated at their exact size.
+ */
+typedef union {
+  size_t capacity;
+  void *align_ptr;
+  double align_double;
+} oc_buffer_header_t;
+
+static const size_t buffer_classes[] = { 128, 512, 2048 };
+#define OC_BUFFER_NUM_CLASSES                                                  \
+  (sizeof(buffer_classes) / sizeof(buffer_classes[0]))
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+/* Released buffers of each class, taken and given back without locking */
+OC_ATOMIC_QUEUE(small_buffers, OC_BUFFER_FREE_LIST_SIZE);
+OC_ATOMIC_QUEUE(medium_buffers, OC_BUFFER_FREE_LIST_SIZE);
+OC_ATOMIC_QUEUE(large_buffers, OC_BUFFER_FREE_LIST_SIZE);
+
+static oc_atomic_queue_t *const buffer_free_lists[OC_BUFFER_NUM_CLASSES] = {
+  &small_buffers, &medium_buffers, &large_buffers
+};
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
+static struct
+{
+  oc_buffer_header_t *head;
+  size_t count;
+} buffer_free_lists[OC_BUFFER_NUM_CLASSES];
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+
+static oc_buffer_header_t *
+get_buffer_header(const void *ptr)
+{
+  return (oc_buffer_header_t *)ptr - 1;
+}
+
+static int
+get_buffer_class(size_t size)
+{
+  size_t i;
+  for (i = 0; i < OC_BUFFER_NUM_CLASSES; i++) {
+    if (size <= buffer_classes[i]) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+static void
+release_buffer(void *ptr)
+{
+  oc_buffer_header_t *header = get_buffer_header(ptr);
+  int c = get_buffer_class(header->capacity);
+  if (c < 0 || header->capacity != buffer_classes[c] ||
+      !oc_atomic_queue_push(buffer_free_lists[c], header)) {
+    free(header);
+  }
+}
+
+static oc_buffer_header_t *
+take_buffer(int c)
+{
+  return (oc_buffer_header_t *)oc_atomic_queue_pop(buffer_free_lists[c]);
+}
+#else /* OC_LOCKFREE_NETWORK_EVENTS */
+/* Must be called with the network event handler mutex held */
+static void
+release_buffer(void *ptr)
+{
+  oc_buffer_header_t *header = get_buffer_header(ptr);
+  int c = get_buffer_class(header->capacity);
+  if (c >= 0 && header->capacity == buffer_classes[c] &&
+      buffer_free_lists[c].count < OC_BUFFER_FREE_LIST_SIZE) {
+    memcpy(ptr, &buffer_free_lists[c].head, sizeof(oc_buffer_header_t *));
+    buffer_free_lists[c].head = header;
+    buffer_free_lists[c].count++;
+    return;
+  }
+  free(header);
+}
+
+static oc_buffer_header_t *
+take_buffer(int c)
+{
+  oc_network_event_handler_mutex_lock();
+  oc_buffer_header_t *header = buffer_free_lists[c].head;
+  if (header) {
+    memcpy(&buffer_free_lists[c].head, header + 1,
+           sizeof(oc_buffer_header_t *));
+    buffer_free_lists[c].count--;
+  }
+  oc_network_event_handler_mutex_unlock();
+  return header;
+}
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+
+void *
+oc_buffer_alloc(size_t size)
+{
+  oc_buffer_header_t *header = NULL;
+  int c = get_buffer_class(size);
+  if (c >= 0) {
+    size = buffer_classes[c];
+    header = take_buffer(c);
+  }
+  if (!header) {
+    header = (oc_buffer_header_t *)malloc(sizeof(oc_buffer_header_t) + size);
+    if (!header) {
+      OC_ERR("buffer: could not allocate payload buffer of %zu bytes", size);
       return NULL;
     }
+    header->capacity = size;
+  }
+  return header + 1;
+}
+
+void *
+oc_buffer_grow(void *ptr, size_t size)
+{
+  if (!ptr) {
+    return oc_buffer_alloc(size);
+  }
+  size_t capacity = oc_buffer_capacity(ptr);
+  if (size <= capacity) {
+    return ptr;
+  }
+  /* Past the largest class grow geometrically so that payloads assembled
+   * piecewise (e.g. blockwise transfers) are not copied on every append.
+   */
+  if (get_buffer_class(size) < 0 && size < 2 * capacity) {
+    size = 2 * capacity;
+    if (size > (size_t)OC_MAX_APP_DATA_SIZE &&
+        capacity < (size_t)OC_MAX_APP_DATA_SIZE) {
+      size = (size_t)OC_MAX_APP_DATA_SIZE;
+    }
+  }
+  void *grown = oc_buffer_alloc(size);
+  if (!grown) {
+    return NULL;
+  }
+  memcpy(grown, ptr, capacity);
+  oc_buffer_free(ptr);
+  return grown;
+}
+
+void *
+oc_buffer_shrink(void *ptr, size_t size)
+{
+  if (!ptr ||
+      get_buffer_class(size) == get_buffer_class(oc_buffer_capacity(ptr))) {
+    return ptr;
+  }
+  void *shrunk = oc_buffer_alloc(size);
+  if (!shrunk) {
+    return ptr;
+  }
+  memcpy(shrunk, ptr, size);
+  oc_buffer_free(ptr);
+  return shrunk;
+}
+
+void
+oc_buffer_free(void *ptr)
+{
+  if (!ptr) {
+    return;
+  }
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  release_buffer(ptr);
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
+  oc_network_event_handler_mutex_lock();
+  release_buffer(ptr);
+  oc_network_event_handler_mutex_unlock();
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+}
+
+size_t
+oc_buffer_capacity(const void *ptr)
+{
+  return ptr ? get_buffer_header(ptr)->capacity : 0;
+}
+
+/* Released messages of a pool that keep their payload buffer for reuse */
+typedef struct
+{
+  struct oc_memb *pool;
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  oc_atomic_queue_t *cache;
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
+  oc_message_t *head;
+  size_t pdu_size;
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+  oc_message_buffer_stats_t stats;
+} oc_message_magazine_t;
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+/* Receive threads take incoming messages from the cache without locking */
+OC_ATOMIC_QUEUE(incoming_cache, OC_MESSAGE_BUFFER_CACHE_SIZE);
+OC_ATOMIC_QUEUE(outgoing_cache, OC_MESSAGE_BUFFER_CACHE_SIZE);
+
+static oc_message_magazine_t magazines[] = {
+  { .pool = &oc_incoming_buffers, .cache = &incoming_cache },
+  { .pool = &oc_outgoing_buffers, .cache = &outgoing_cache }
+};
+
+#define MAGAZINE_STAT_ADD(stat, n)                                             \
+  __atomic_add_fetch(&(stat), (size_t)(n), __ATOMIC_RELAXED)
+#else /* OC_LOCKFREE_NETWORK_EVENTS */
+static oc_message_magazine_t magazines[] = {
+  { .pool = &oc_incoming_buffers }, { .pool = &oc_outgoing_buffers }
+};
+
+#define MAGAZINE_STAT_ADD(stat, n) ((stat) += (size_t)(n))
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+
+static oc_message_magazine_t *
+get_magazine(struct oc_memb *pool)
+{
+  size_t i;
+  for (i = 0; i < sizeof(magazines) / sizeof(magazines[0]); i++) {
+    if (magazines[i].pool == pool) {
+      return &magazines[i];
+    }
+  }
+  return NULL;
+}
+
+static void
+free_message(oc_message_t *message)
+{
+  oc_buffer_free(message->data);
+  free_message_block(message->pool, message);
+}
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+static oc_message_t *
+take_cached_message(struct oc_memb *pool)
+{
+  oc_message_magazine_t *magazine = get_magazine(pool);
+  if (!magazine) {
+    return NULL;
+  }
+  oc_message_t *message;
+  while ((message = (oc_message_t *)oc_atomic_queue_pop(magazine->cache))) {
+    MAGAZINE_STAT_ADD(magazine->stats.cached, -1);
+    if (oc_buffer_capacity(message->data) >= (size_t)OC_PDU_SIZE) {
+      break;
+    }
+    /* Cached before the PDU size grew */
+    free_message(message);
+  }
+  if (message) {
+    MAGAZINE_STAT_ADD(magazine->stats.recycled, 1);
+    uint8_t *data = message->data;
+    memset(message, 0, sizeof(oc_message_t));
+    message->data = data;
+  } else {
+    MAGAZINE_STAT_ADD(magazine->stats.allocated, 1);
+  }
+  return message;
+}
+
+static bool
+cache_message(oc_message_t *message)
+{
+  oc_message_magazine_t *magazine = get_magazine(message->pool);
+  if (!magazine ||
+      oc_buffer_capacity(message->data) < (size_t)OC_PDU_SIZE ||
+      !oc_atomic_queue_push(magazine->cache, message)) {
+    return false;
+  }
+  MAGAZINE_STAT_ADD(magazine->stats.cached, 1);
+  return true;
+}
+#else /* OC_LOCKFREE_NETWORK_EVENTS */
+/* Drops the cached buffers if the PDU size changed since they were made */
+static void
+check_magazine_pdu_size(oc_message_magazine_t *magazine)
+{
+  if (magazine->pdu_size == (size_t)OC_PDU_SIZE) {
+    return;
+  }
+  while (magazine->head) {
+    oc_message_t *message = magazine->head;
+    magazine->head = message->next;
+    release_buffer(message->data);
+    oc_memb_free(message->pool, message);
+  }
+  magazine->stats.cached = 0;
+  magazine->pdu_size = (size_t)OC_PDU_SIZE;
+}
+
+static oc_message_t *
+take_cached_message(struct oc_memb *pool)
+{
+  oc_message_magazine_t *magazine = get_magazine(pool);
+  if (!magazine) {
+    return NULL;
+  }
+  oc_network_event_handler_mutex_lock();
+  check_magazine_pdu_size(magazine);
+  oc_message_t *message = magazine->head;
+  if (message) {
+    magazine->head = message->next;
+    MAGAZINE_STAT_ADD(magazine->stats.cached, -1);
+    MAGAZINE_STAT_ADD(magazine->stats.recycled, 1);
+  } else {
+    MAGAZINE_STAT_ADD(magazine->stats.allocated, 1);
+  }
+  oc_network_event_handler_mutex_unlock();
+  if (message) {
+    uint8_t *data = message->data;
+    memset(message, 0, sizeof(oc_message_t));
+    message->data = data;
+  }
+  return message;
+}
+
+static bool
+cache_message(oc_message_t *message)
+{
+  oc_message_magazine_t *magazine = get_magazine(message->pool);
+  if (!magazine) {
+    return false;
+  }
+  bool cached = false;
+  oc_network_event_handler_mutex_lock();
+  check_magazine_pdu_size(magazine);
+  if (magazine->stats.cached < OC_MESSAGE_BUFFER_CACHE_SIZE &&
+      oc_buffer_capacity(message->data) >= (size_t)OC_PDU_SIZE) {
+    message->next = magazine->head;
+    magazine->head = message;
+    MAGAZINE_STAT_ADD(magazine->stats.cached, 1);
+    cached = true;
+  }
+  oc_network_event_handler_mutex_unlock();
+  return cached;
+}
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+
+void
+oc_get_message_buffer_stats(oc_message_buffer_stats_t *incoming,
+                            oc_message_buffer_stats_t *outgoing)
+{
+  oc_network_event_handler_mutex_lock();
+  if (incoming) {
+    *incoming = get_magazine(&oc_incoming_buffers)->stats;
+  }
+  if (outgoing) {
+    *outgoing = get_magazine(&oc_outgoing_buffers)->stats;
+  }
+  oc_network_event_handler_mutex_unlock();
+}
 #endif /* OC_DYNAMIC_ALLOCATION */
+
+static oc_message_t *
+allocate_message(struct oc_memb *pool)
+{
+#ifdef OC_DYNAMIC_ALLOCATION
+  oc_message_t *message = take_cached_message(pool);
+  if (!message) {
+    message = alloc_message_block(pool);
+    if (message) {
+      message->data = oc_buffer_alloc(OC_PDU_SIZE);
+      if (!message->data) {
+        free_message_block(pool, message);
+        return NULL;
+      }
+    }
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+  oc_message_t *message = alloc_message_block(pool);
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  if (message) {
     message->pool = pool;
     message->length = 0;
     message->next = 0;
@@ -112,23 +562,65 @@ oc_message_unref(oc_message_t *message)
     message->ref_count--;
     if (message->ref_count <= 0) {
 #ifdef OC_DYNAMIC_ALLOCATION
-      free(message->data);
-#endif /* OC_DYNAMIC_ALLOCATION */
       struct oc_memb *pool = message->pool;
-      oc_memb_free(pool, message);
-#ifndef OC_DYNAMIC_ALLOCATION
+      if (!cache_message(message)) {
+        free_message(message);
+      } else if (pool->buffers_avail_cb) {
+        /* oc_memb_free() notifies when the message is freed instead */
+        pool->buffers_avail_cb(oc_memb_numfree(pool));
+      }
+#else  /* OC_DYNAMIC_ALLOCATION */
+      struct oc_memb *pool = message->pool;
+      free_message_block(pool, message);
       OC_DBG("buffer: freed TX/RX buffer; num free: %d", oc_memb_numfree(pool));
 #endif /* !OC_DYNAMIC_ALLOCATION */
     }
   }
 }
 
+void
+oc_message_count_drop(oc_message_drop_reason_t reason)
+{
+  if (reason >= OC_MESSAGE_DROP_NUM_REASONS) {
+    return;
+  }
+  /* Receive threads count drops too */
+#ifdef __GNUC__
+  __atomic_add_fetch(&message_drops[reason], 1, __ATOMIC_RELAXED);
+#else  /* __GNUC__ */
+  message_drops[reason]++;
+#endif /* !__GNUC__ */
+}
+
+uint32_t
+oc_get_message_drop_count(oc_message_drop_reason_t reason)
+{
+  if (reason >= OC_MESSAGE_DROP_NUM_REASONS) {
+    return 0;
+  }
+#ifdef __GNUC__
+  return __atomic_load_n(&message_drops[reason], __ATOMIC_RELAXED);
+#else  /* __GNUC__ */
+  return message_drops[reason];
+#endif /* !__GNUC__ */
+}
+
+bool
+oc_try_recv_message(oc_message_t *message)
+{
+  return oc_process_post(&message_buffer_handler,
+                         oc_events[INBOUND_NETWORK_EVENT],
+                         message) != OC_PROCESS_ERR_FULL;
+}
+
 void
 oc_recv_message(oc_message_t *message)
 {
-  if (oc_process_post(&message_buffer_handler, oc_events[INBOUND_NETWORK_EVENT],
-                      message) == OC_PROCESS_ERR_FULL)
+  if (!oc_try_recv_message(message)) {
+    OC_WRN("buffer: event queue full, dropping incoming message");
+    oc_message_count_drop(OC_MESSAGE_DROP_INBOUND_QUEUE_FULL);
     oc_message_unref(message);
+  }
 }
 
 void
@@ -136,8 +628,11 @@ oc_send_message(oc_message_t *message)
 {
   if (oc_process_post(&message_buffer_handler,
                       oc_events[OUTBOUND_NETWORK_EVENT],
-                      message) == OC_PROCESS_ERR_FULL)
+                      message) == OC_PROCESS_ERR_FULL) {
+    OC_WRN("buffer: event queue full, dropping outgoing message");
+    oc_message_count_drop(OC_MESSAGE_DROP_OUTBOUND_QUEUE_FULL);
     message->ref_count--;
+  }
 
   _oc_signal_event_loop();
 }
@@ -207,7 +702,11 @@ OC_PROCESS_THREAD(message_buffer_handler, ev, data)
 #endif /* OC_SECURITY */
       {
         OC_DBG("Outbound network event: unicast message");
+#ifdef OC_SENDMMSG
+        oc_queue_send_buffer(message);
+#else  /* OC_SENDMMSG */
         oc_send_buffer(message);
+#endif /* !OC_SENDMMSG */
         oc_message_unref(message);
       }
     }
@@ -145,6 +145,10 @@ prepare_coap_request(oc_client_cb_t *cb)
       OC_ERR("request_buffer is NULL");
       return false;
     }
+    if (!oc_blockwise_reserve_buffer(request_buffer, OC_MAX_APP_DATA_SIZE)) {
+      oc_blockwise_free_request_buffer(request_buffer);
+      return false;
+    }
     oc_rep_new(request_buffer->buffer, OC_MAX_APP_DATA_SIZE);
 
     request_buffer->mid = cb->mid;
@@ -638,10 +638,9 @@ oc_handle_collection_request(oc_method_t method, oc_request_t *request,
               goto next_eps1;
             }
             oc_rep_object_array_start_item(eps);
-            oc_string_t ep;
-            if (oc_endpoint_to_string(eps, &ep) == 0) {
-              oc_rep_set_text_string(eps, ep, oc_string(ep));
-              oc_free_string(&ep);
+            char ep_str[OC_ENDPOINT_STRING_SIZE];
+            if (oc_endpoint_to_cached_string(eps, ep_str) == 0) {
+              oc_rep_set_text_string(eps, ep, ep_str);
             }
             oc_rep_object_array_end_item(eps);
           next_eps1:
@@ -713,10 +712,9 @@ oc_handle_collection_request(oc_method_t method, oc_request_t *request,
             goto next_eps2;
           }
           oc_rep_object_array_start_item(eps);
-          oc_string_t ep;
-          if (oc_endpoint_to_string(eps, &ep) == 0) {
-            oc_rep_set_text_string(eps, ep, oc_string(ep));
-            oc_free_string(&ep);
+          char ep_str[OC_ENDPOINT_STRING_SIZE];
+          if (oc_endpoint_to_cached_string(eps, ep_str) == 0) {
+            oc_rep_set_text_string(eps, ep, ep_str);
           }
           oc_rep_object_array_end_item(eps);
         next_eps2:
@@ -110,10 +110,9 @@ filter_resource(oc_resource_t *resource, oc_request_t *request,
       goto next_eps;
     }
     oc_rep_object_array_start_item(eps);
-    oc_string_t ep;
-    if (oc_endpoint_to_string(eps, &ep) == 0) {
-      oc_rep_set_text_string(eps, ep, oc_string(ep));
-      oc_free_string(&ep);
+    char ep_str[OC_ENDPOINT_STRING_SIZE];
+    if (oc_endpoint_to_cached_string(eps, ep_str) == 0) {
+      oc_rep_set_text_string(eps, ep, ep_str);
     }
     if (oc_core_get_latency() > 0)
       oc_rep_set_uint(eps, lat, oc_core_get_latency());
@@ -773,11 +772,11 @@ oc_ri_process_discovery_payload(uint8_t *payload, int len,
   oc_rep_t rep_objects_pool[OC_MAX_NUM_REP_OBJECTS];
   memset(rep_objects_alloc, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(char));
   memset(rep_objects_pool, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t));
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS,
-                                 rep_objects_alloc, (void *)rep_objects_pool,
-                                 0 };
+  struct oc_memb rep_objects =
+    OC_MEMB_INIT(sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS, rep_objects_alloc,
+                 (void *)rep_objects_pool, 0);
 #else  /* !OC_DYNAMIC_ALLOCATION */
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
 #endif /* OC_DYNAMIC_ALLOCATION */
   oc_rep_set_pool(&rep_objects);
 
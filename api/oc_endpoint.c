@@ -33,6 +33,50 @@
 #define OC_IPV6_ADDRLEN (16)
 #define OC_IPV4_ADDRLEN (4)
 
+#ifndef OC_ENDPOINT_STRING_CACHE_SIZE
+/* Slots of the rendered endpoint string cache, must be a power of two */
+#define OC_ENDPOINT_STRING_CACHE_SIZE (16)
+#endif /* !OC_ENDPOINT_STRING_CACHE_SIZE */
+
+/* Flags that select the scheme of an endpoint string */
+#define OC_ENDPOINT_STRING_FLAGS (SECURED | IPV4 | IPV6 | TCP)
+
+typedef struct
+{
+  oc_endpoint_t key;
+  char string[OC_ENDPOINT_STRING_SIZE];
+} oc_endpoint_string_t;
+
+/* Shared by every thread that renders endpoints. It has a lock of its own,
+ * held only for a lookup or a single rendering, so that the receive path
+ * does not wait on it; without GCC atomic builtins the network event mutex
+ * stands in. */
+static oc_endpoint_string_t endpoint_strings[OC_ENDPOINT_STRING_CACHE_SIZE];
+#ifdef __GNUC__
+static bool endpoint_strings_lock;
+#endif /* __GNUC__ */
+
+static void
+lock_endpoint_strings(void)
+{
+#ifdef __GNUC__
+  while (__atomic_test_and_set(&endpoint_strings_lock, __ATOMIC_ACQUIRE))
+    ;
+#else  /* __GNUC__ */
+  oc_network_event_handler_mutex_lock();
+#endif /* !__GNUC__ */
+}
+
+static void
+unlock_endpoint_strings(void)
+{
+#ifdef __GNUC__
+  __atomic_clear(&endpoint_strings_lock, __ATOMIC_RELEASE);
+#else  /* __GNUC__ */
+  oc_network_event_handler_mutex_unlock();
+#endif /* !__GNUC__ */
+}
+
 OC_MEMB(oc_endpoints_s, oc_endpoint_t, OC_MAX_NUM_ENDPOINTS);
 
 oc_endpoint_t *
@@ -64,41 +108,39 @@ oc_endpoint_set_di(oc_endpoint_t *endpoint, oc_uuid_t *di)
   }
 }
 
-#ifdef OC_IPV4
-static void
-oc_ipv4_endpoint_to_string(oc_endpoint_t *endpoint, oc_string_t *endpoint_str)
+static const char *
+oc_endpoint_scheme(const oc_endpoint_t *endpoint)
 {
-  if (!endpoint || !endpoint_str) {
-    return;
-  }
-  char ip[OC_IPV4_ADDRSTRLEN + 6];
-  uint8_t *addr = endpoint->addr.ipv4.address;
-  sprintf(ip, "%u.%u.%u.%u:%u", addr[0], addr[1], addr[2], addr[3],
-          endpoint->addr.ipv4.port);
 #ifdef OC_TCP
   if (endpoint->flags & TCP) {
     if (endpoint->flags & SECURED) {
-      oc_concat_strings(endpoint_str, OC_SCHEME_COAPS_TCP, ip);
-    } else {
-      oc_concat_strings(endpoint_str, OC_SCHEME_COAP_TCP, ip);
+      return OC_SCHEME_COAPS_TCP;
     }
-  } else
+    return OC_SCHEME_COAP_TCP;
+  }
 #endif
-    if (endpoint->flags & SECURED) {
-    oc_concat_strings(endpoint_str, OC_SCHEME_COAPS, ip);
-  } else {
-    oc_concat_strings(endpoint_str, OC_SCHEME_COAP, ip);
+  if (endpoint->flags & SECURED) {
+    return OC_SCHEME_COAPS;
   }
+  return OC_SCHEME_COAP;
+}
+
+#ifdef OC_IPV4
+static void
+oc_ipv4_endpoint_to_string(const oc_endpoint_t *endpoint, char *buffer)
+{
+  char ip[OC_IPV4_ADDRSTRLEN + 6];
+  const uint8_t *addr = endpoint->addr.ipv4.address;
+  sprintf(ip, "%u.%u.%u.%u:%u", addr[0], addr[1], addr[2], addr[3],
+          endpoint->addr.ipv4.port);
+  sprintf(buffer, "%s%s", oc_endpoint_scheme(endpoint), ip);
 }
 #endif /* OC_IPV4 */
 
 static void
-oc_ipv6_endpoint_to_string(oc_endpoint_t *endpoint, oc_string_t *endpoint_str)
+oc_ipv6_endpoint_to_string(const oc_endpoint_t *endpoint, char *buffer)
 {
-  if (!endpoint || !endpoint_str) {
-    return;
-  }
-  uint8_t *addr = endpoint->addr.ipv6.address;
+  const uint8_t *addr = endpoint->addr.ipv6.address;
   char ip[OC_IPV6_ADDRSTRLEN + 8];
   int addr_idx = 0, str_idx = 0, start_zeros = 0, last_zeros = OC_IPV6_ADDRLEN,
       num_zeros = 0, max_zeros_start = 0, max_zeros_num = 0;
@@ -153,20 +195,24 @@ oc_ipv6_endpoint_to_string(oc_endpoint_t *endpoint, oc_string_t *endpoint_str)
   } else {
     sprintf(&ip[str_idx], "]:%u", endpoint->addr.ipv6.port);
   }
-#ifdef OC_TCP
-  if (endpoint->flags & TCP) {
-    if (endpoint->flags & SECURED) {
-      oc_concat_strings(endpoint_str, OC_SCHEME_COAPS_TCP, ip);
-    } else {
-      oc_concat_strings(endpoint_str, OC_SCHEME_COAP_TCP, ip);
-    }
-  } else
-#endif
-    if (endpoint->flags & SECURED) {
-    oc_concat_strings(endpoint_str, OC_SCHEME_COAPS, ip);
-  } else {
-    oc_concat_strings(endpoint_str, OC_SCHEME_COAP, ip);
+  sprintf(buffer, "%s%s", oc_endpoint_scheme(endpoint), ip);
+}
+
+static int
+oc_endpoint_format(const oc_endpoint_t *endpoint, char *buffer)
+{
+  if (endpoint->flags & IPV6) {
+    oc_ipv6_endpoint_to_string(endpoint, buffer);
   }
+#ifdef OC_IPV4
+  else if (endpoint->flags & IPV4) {
+    oc_ipv4_endpoint_to_string(endpoint, buffer);
+  }
+#endif /* OC_IPV4 */
+  else {
+    return -1;
+  }
+  return 0;
 }
 
 int
@@ -175,18 +221,84 @@ oc_endpoint_to_string(oc_endpoint_t *endpoint, oc_string_t *endpoint_str)
   if (!endpoint || !endpoint_str)
     return -1;
 
-  if (endpoint->flags & IPV6) {
-    oc_ipv6_endpoint_to_string(endpoint, endpoint_str);
+  char buffer[OC_ENDPOINT_STRING_SIZE];
+  if (oc_endpoint_format(endpoint, buffer) < 0) {
+    return -1;
+  }
+  oc_new_string(endpoint_str, buffer, strlen(buffer));
+  return 0;
+}
+
+static uint32_t
+endpoint_string_hash(const oc_endpoint_t *endpoint)
+{
+  const uint8_t *addr = endpoint->addr.ipv6.address;
+  size_t i, len = OC_IPV6_ADDRLEN;
+  uint16_t port = endpoint->addr.ipv6.port;
+#ifdef OC_IPV4
+  if (endpoint->flags & IPV4) {
+    addr = endpoint->addr.ipv4.address;
+    len = OC_IPV4_ADDRLEN;
+    port = endpoint->addr.ipv4.port;
+  }
+#endif /* OC_IPV4 */
+  uint32_t hash = 2166136261u;
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ addr[i]) * 16777619u;
+  }
+  hash = (hash ^ port) * 16777619u;
+  hash = (hash ^ (uint32_t)(endpoint->flags & OC_ENDPOINT_STRING_FLAGS)) *
+         16777619u;
+  return hash;
+}
+
+static bool
+endpoint_string_key_match(const oc_endpoint_t *key,
+                          const oc_endpoint_t *endpoint)
+{
+  if ((key->flags & OC_ENDPOINT_STRING_FLAGS) !=
+      (endpoint->flags & OC_ENDPOINT_STRING_FLAGS)) {
+    return false;
   }
 #ifdef OC_IPV4
-  else if (endpoint->flags & IPV4) {
-    oc_ipv4_endpoint_to_string(endpoint, endpoint_str);
+  if (endpoint->flags & IPV4) {
+    return key->addr.ipv4.port == endpoint->addr.ipv4.port &&
+           memcmp(key->addr.ipv4.address, endpoint->addr.ipv4.address,
+                  OC_IPV4_ADDRLEN) == 0;
   }
 #endif /* OC_IPV4 */
-  else {
+  return key->addr.ipv6.port == endpoint->addr.ipv6.port &&
+         memcmp(key->addr.ipv6.address, endpoint->addr.ipv6.address,
+                OC_IPV6_ADDRLEN) == 0;
+}
+
+int
+oc_endpoint_to_cached_string(const oc_endpoint_t *endpoint, char *buffer)
+{
+  if (!endpoint || !buffer) {
     return -1;
   }
-  return 0;
+
+  int ret = 0;
+  lock_endpoint_strings();
+  oc_endpoint_string_t *entry =
+    &endpoint_strings[endpoint_string_hash(endpoint) &
+                      (OC_ENDPOINT_STRING_CACHE_SIZE - 1)];
+  if (entry->string[0] == '\0' ||
+      !endpoint_string_key_match(&entry->key, endpoint)) {
+    if (oc_endpoint_format(endpoint, entry->string) < 0) {
+      entry->string[0] = '\0';
+      ret = -1;
+    } else {
+      memcpy(&entry->key, endpoint, sizeof(oc_endpoint_t));
+      entry->key.next = NULL;
+    }
+  }
+  if (ret == 0) {
+    memcpy(buffer, entry->string, strlen(entry->string) + 1);
+  }
+  unlock_endpoint_strings();
+  return ret;
 }
 
 #ifdef OC_IPV4
@@ -23,6 +23,7 @@
 #include "port/oc_connectivity.h"
 
 #include "util/oc_etimer.h"
+#include "util/oc_memb.h"
 #include "util/oc_process.h"
 
 #include "oc_api.h"
@@ -191,6 +192,13 @@ oc_main_init(const oc_handler_t *handler)
 
   app_callbacks = handler;
 
+#ifdef OC_MEMB_PREALLOC
+  if (oc_memb_prealloc() == 0) {
+    ret = -1;
+    goto err;
+  }
+#endif /* OC_MEMB_PREALLOC */
+
 #ifdef OC_MEMORY_TRACE
   oc_mem_trace_init();
 #endif /* OC_MEMORY_TRACE */
@@ -277,10 +285,28 @@ err:
 oc_clock_time_t
 oc_main_poll(void)
 {
+  oc_timer_hold_now();
   oc_clock_time_t ticks_until_next_event = oc_etimer_request_poll();
   while (oc_process_run()) {
+    oc_timer_hold_now();
     ticks_until_next_event = oc_etimer_request_poll();
   }
+  oc_timer_release_now();
+#ifdef OC_SENDMMSG
+  oc_flush_send_buffers();
+#endif /* OC_SENDMMSG */
+#ifdef OC_CLOCK_MONOTONIC
+  if (ticks_until_next_event != 0) {
+    /* Timers run on the monotonic clock, but the event loop waits until a
+       time of oc_clock_time() */
+    oc_clock_time_t wait = ticks_until_next_event - oc_clock_time_monotonic();
+    if (wait > ((oc_clock_time_t)-1 >> 1)) {
+      /* The next timer is already due */
+      wait = 0;
+    }
+    ticks_until_next_event = oc_clock_time() + wait;
+  }
+#endif /* OC_CLOCK_MONOTONIC */
   return ticks_until_next_event;
 }
 
@@ -0,0 +1,136 @@
+/*
+ // Licensed under the Apache License, Version 2.0 (the "License");
+ // you may not use this file except in compliance with the License.
+ // You may obtain a copy of the License at
+ //
+ //      http://www.apache.org/licenses/LICENSE-2.0
+ //
+ // Unless required by applicable law or agreed to in writing, software
+ // distributed under the License is distributed on an "AS IS" BASIS,
+ // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ // See the License for the specific language governing permissions and
+ // limitations under the License.
+ */
+
+#include "oc_config.h"
+#ifdef OC_MEMORY_STATS
+#include "oc_mem_stats.h"
+#include "util/oc_memb.h"
+#include "util/oc_mmem.h"
+#ifdef OC_SERVER
+#include "oc_api.h"
+#endif /* OC_SERVER */
+
+typedef struct
+{
+  int mmem_pool;
+  struct oc_memb *memb;
+} mem_stats_cursor_t;
+
+static void
+get_memb_stats(struct oc_memb *m, oc_mem_pool_stats_t *stats)
+{
+  stats->name = m->name;
+  stats->unit_size = m->size;
+  stats->capacity = m->num;
+  stats->in_use = m->num_used;
+  stats->peak = m->peak_used;
+  stats->allocs = m->num_allocs;
+  stats->failures = m->num_failures;
+}
+
+static bool
+next_pool_stats(mem_stats_cursor_t *cursor, oc_mem_pool_stats_t *stats)
+{
+  if (cursor->mmem_pool <= DOUBLE_POOL) {
+    oc_mmem_get_stats((pool)cursor->mmem_pool++, stats);
+    if (cursor->mmem_pool > DOUBLE_POOL) {
+      cursor->memb = oc_memb_stats_head();
+    }
+    return true;
+  }
+  if (!cursor->memb) {
+    return false;
+  }
+  get_memb_stats(cursor->memb, stats);
+  cursor->memb = cursor->memb->stats_next;
+  return true;
+}
+
+void
+oc_mem_stats_iterate(oc_mem_stats_cb_t cb, void *user_data)
+{
+  mem_stats_cursor_t cursor = { 0, NULL };
+  oc_mem_pool_stats_t stats;
+  while (next_pool_stats(&cursor, &stats)) {
+    cb(&stats, user_data);
+  }
+}
+
+void
+oc_mem_stats_reset_peaks(void)
+{
+  int i;
+  for (i = BYTE_POOL; i <= DOUBLE_POOL; i++) {
+    oc_mmem_reset_peak((pool)i);
+  }
+  struct oc_memb *m = oc_memb_stats_head();
+  for (; m != NULL; m = m->stats_next) {
+    m->peak_used = m->num_used;
+  }
+}
+
+#ifdef OC_SERVER
+static void
+get_mem_stats(oc_request_t *request, oc_interface_mask_t iface_mask,
+              void *data)
+{
+  (void)data;
+  oc_rep_start_root_object();
+  switch (iface_mask) {
+  case OC_IF_BASELINE:
+    oc_process_baseline_interface(request->resource);
+  /* fall through */
+  case OC_IF_R: {
+    mem_stats_cursor_t cursor = { 0, NULL };
+    oc_mem_pool_stats_t stats;
+    oc_rep_set_array(root, pools);
+    while (next_pool_stats(&cursor, &stats)) {
+      oc_rep_object_array_start_item(pools);
+      oc_rep_set_text_string(pools, name, stats.name);
+      oc_rep_set_uint(pools, size, stats.unit_size);
+      oc_rep_set_uint(pools, capacity, stats.capacity);
+      oc_rep_set_uint(pools, inuse, stats.in_use);
+      oc_rep_set_uint(pools, peak, stats.peak);
+      oc_rep_set_uint(pools, allocs, stats.allocs);
+      oc_rep_set_uint(pools, failures, stats.failures);
+      oc_rep_object_array_end_item(pools);
+    }
+    oc_rep_close_array(root, pools);
+  } break;
+  default:
+    break;
+  }
+  oc_rep_end_root_object();
+  oc_send_response(request, OC_STATUS_OK);
+}
+
+bool
+oc_mem_stats_add_resource(size_t device)
+{
+  oc_resource_t *res = oc_new_resource(NULL, "/oc/memstats", 1, device);
+  if (!res) {
+    OC_ERR("could not allocate the memory statistics resource");
+    return false;
+  }
+  oc_resource_bind_resource_type(res, "x.org.iotivity.memstats");
+  oc_resource_bind_resource_interface(res, OC_IF_R);
+  oc_resource_set_default_interface(res, OC_IF_R);
+  oc_resource_set_discoverable(res, true);
+  oc_resource_set_request_handler(res, OC_GET, get_mem_stats, NULL);
+  return oc_add_resource(res);
+}
+#endif /* OC_SERVER */
+#else  /* OC_MEMORY_STATS */
+typedef int oc_mem_stats_unused_t;
+#endif /* !OC_MEMORY_STATS */
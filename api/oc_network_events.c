@@ -20,33 +20,164 @@
 #include "oc_signal_event_loop.h"
 #include "port/oc_connectivity.h"
 #include "util/oc_list.h"
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+#include "util/oc_atomic_queue.h"
+#endif /* OC_LOCKFREE_NETWORK_EVENTS */
 
 OC_LIST(network_events);
 #ifdef OC_NETWORK_MONITOR
 static bool interface_up, interface_down;
 #endif /* OC_NETWORK_MONITOR */
 
+/* Received messages the event loop could not take yet, oldest first. They
+ * keep holding their buffers, so receivers stop reading from the network
+ * once the pool runs dry instead of having later messages dropped.
+ */
+OC_LIST(stalled_network_events);
+
+static void
+deliver_network_event(oc_message_t *message)
+{
+  if (oc_list_head(stalled_network_events) || !oc_try_recv_message(message)) {
+    oc_list_add(stalled_network_events, message);
+  }
+}
+
+static void
+retry_stalled_network_events(void)
+{
+  oc_message_t *message;
+  while ((message = (oc_message_t *)oc_list_pop(stalled_network_events))) {
+    if (!oc_try_recv_message(message)) {
+      oc_list_push(stalled_network_events, message);
+      break;
+    }
+  }
+}
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+#ifndef OC_NETWORK_EVENT_QUEUE_SIZE
+#define OC_NETWORK_EVENT_QUEUE_SIZE (128)
+#endif /* !OC_NETWORK_EVENT_QUEUE_SIZE */
+
+/* Received messages reach the event loop through a lock-free queue. Once it
+ * fills up they go to the network_events list instead, and keep doing so
+ * until the event loop has drained that list, so that every thread's
+ * messages are still processed in the order they were received.
+ */
+OC_ATOMIC_QUEUE(network_event_queue, OC_NETWORK_EVENT_QUEUE_SIZE);
+static bool network_events_overflow;
+/* Overflowed messages taken off network_events, waiting for the pushes to
+ * the queue that were in progress when they overflowed */
+static oc_message_t *overflow_pending;
+
+/* Returns false if a push that claimed a slot has not completed yet */
+static bool
+drain_network_event_queue(void)
+{
+  oc_message_t *message;
+  while ((message =
+            (oc_message_t *)oc_atomic_queue_pop(&network_event_queue))) {
+    deliver_network_event(message);
+  }
+  return oc_atomic_queue_is_empty(&network_event_queue);
+}
+
 static void
 oc_process_network_event(void)
 {
+  retry_stalled_network_events();
+  for (;;) {
+    bool drained = drain_network_event_queue();
+    if (overflow_pending) {
+      if (!drained) {
+        /* Whatever goes into the queue was received before the overflow,
+         * so come back once the push completes rather than wait for it */
+        oc_process_poll(&oc_network_events);
+        break;
+      }
+      while (overflow_pending) {
+        oc_message_t *next = overflow_pending->next;
+        deliver_network_event(overflow_pending);
+        overflow_pending = next;
+      }
+    }
+    if (!__atomic_load_n(&network_events_overflow, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    oc_network_event_handler_mutex_lock();
+    overflow_pending = (oc_message_t *)oc_list_head(network_events);
+    oc_list_init(network_events);
+    if (!overflow_pending) {
+      __atomic_store_n(&network_events_overflow, false, __ATOMIC_RELEASE);
+    }
+    oc_network_event_handler_mutex_unlock();
+    if (!overflow_pending) {
+      break;
+    }
+  }
+  if (oc_list_head(stalled_network_events)) {
+    oc_process_poll(&oc_network_events);
+  }
+#ifdef OC_NETWORK_MONITOR
+  if (__atomic_exchange_n(&interface_up, false, __ATOMIC_ACQ_REL)) {
+    oc_process_post(&oc_network_events, oc_events[INTERFACE_UP], NULL);
+  }
+  if (__atomic_exchange_n(&interface_down, false, __ATOMIC_ACQ_REL)) {
+    oc_process_post(&oc_network_events, oc_events[INTERFACE_DOWN], NULL);
+  }
+#endif /* OC_NETWORK_MONITOR */
+}
+
+static void
+add_network_event(oc_message_t *message)
+{
+  if (!__atomic_load_n(&network_events_overflow, __ATOMIC_ACQUIRE) &&
+      oc_atomic_queue_push(&network_event_queue, message)) {
+    return;
+  }
   oc_network_event_handler_mutex_lock();
-  oc_message_t *message = (oc_message_t *)oc_list_pop(network_events);
+  __atomic_store_n(&network_events_overflow, true, __ATOMIC_RELEASE);
+  message->next = NULL;
+  oc_list_add(network_events, message);
+  oc_network_event_handler_mutex_unlock();
+}
+#else /* OC_LOCKFREE_NETWORK_EVENTS */
+static void
+oc_process_network_event(void)
+{
+  retry_stalled_network_events();
+
+  /* Detach the pending messages and deliver them after unlocking, as
+   * releasing a message takes the same mutex.
+   */
+  oc_network_event_handler_mutex_lock();
+  oc_message_t *message = (oc_message_t *)oc_list_head(network_events);
+  oc_list_init(network_events);
+#ifdef OC_NETWORK_MONITOR
+  bool up = interface_up, down = interface_down;
+  interface_up = interface_down = false;
+#endif /* OC_NETWORK_MONITOR */
+  oc_network_event_handler_mutex_unlock();
+
   while (message != NULL) {
-    oc_recv_message(message);
-    message = oc_list_pop(network_events);
+    oc_message_t *next = message->next;
+    deliver_network_event(message);
+    message = next;
+  }
+  if (oc_list_head(stalled_network_events)) {
+    oc_process_poll(&oc_network_events);
   }
 #ifdef OC_NETWORK_MONITOR
-  if (interface_up) {
+  if (up) {
     oc_process_post(&oc_network_events, oc_events[INTERFACE_UP], NULL);
-    interface_up = false;
   }
-  if (interface_down) {
+  if (down) {
     oc_process_post(&oc_network_events, oc_events[INTERFACE_DOWN], NULL);
-    interface_down = false;
   }
 #endif /* OC_NETWORK_MONITOR */
-  oc_network_event_handler_mutex_unlock();
 }
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
 
 OC_PROCESS(oc_network_events, "");
 OC_PROCESS_THREAD(oc_network_events, ev, data)
@@ -71,12 +202,55 @@ void
 oc_network_event(oc_message_t *message)
 {
   if (!oc_process_is_running(&(oc_network_events))) {
+    oc_message_count_drop(OC_MESSAGE_DROP_NOT_RUNNING);
     oc_message_unref(message);
     return;
   }
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  add_network_event(message);
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
   oc_network_event_handler_mutex_lock();
   oc_list_add(network_events, message);
   oc_network_event_handler_mutex_unlock();
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
+
+  oc_process_poll(&(oc_network_events));
+  _oc_signal_event_loop();
+}
+
+void
+oc_network_event_batch(oc_message_t **messages, size_t num_messages)
+{
+  size_t i;
+  if (!oc_process_is_running(&(oc_network_events))) {
+    for (i = 0; i < num_messages; i++) {
+      oc_message_count_drop(OC_MESSAGE_DROP_NOT_RUNNING);
+      oc_message_unref(messages[i]);
+    }
+    return;
+  }
+  if (num_messages == 0) {
+    return;
+  }
+
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  for (i = 0; i < num_messages; i++) {
+    add_network_event(messages[i]);
+  }
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
+  oc_network_event_handler_mutex_lock();
+  oc_message_t *tail = (oc_message_t *)oc_list_tail(network_events);
+  for (i = 0; i < num_messages; i++) {
+    messages[i]->next = NULL;
+    if (tail) {
+      oc_list_insert(network_events, tail, messages[i]);
+    } else {
+      oc_list_add(network_events, messages[i]);
+    }
+    tail = messages[i];
+  }
+  oc_network_event_handler_mutex_unlock();
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
 
   oc_process_poll(&(oc_network_events));
   _oc_signal_event_loop();
@@ -90,6 +264,15 @@ oc_network_interface_event(oc_interface_event_t event)
     return;
   }
 
+#ifdef OC_LOCKFREE_NETWORK_EVENTS
+  if (event == NETWORK_INTERFACE_DOWN) {
+    __atomic_store_n(&interface_down, true, __ATOMIC_RELEASE);
+  } else if (event == NETWORK_INTERFACE_UP) {
+    __atomic_store_n(&interface_up, true, __ATOMIC_RELEASE);
+  } else {
+    return;
+  }
+#else  /* OC_LOCKFREE_NETWORK_EVENTS */
   oc_network_event_handler_mutex_lock();
   if (event == NETWORK_INTERFACE_DOWN) {
     interface_down = true;
@@ -100,6 +283,7 @@ oc_network_interface_event(oc_interface_event_t event)
     return;
   }
   oc_network_event_handler_mutex_unlock();
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS */
 
   oc_process_poll(&(oc_network_events));
   _oc_signal_event_loop();
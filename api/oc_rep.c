@@ -22,16 +22,153 @@
 #include "util/oc_memb.h"
 
 #include <inttypes.h>
+#include <string.h>
+#if defined(OC_REP_ARENA) && defined(OC_DYNAMIC_ALLOCATION)
+#include <stdlib.h>
+#endif /* OC_REP_ARENA && OC_DYNAMIC_ALLOCATION */
 
 static struct oc_memb *rep_objects;
 static uint8_t *g_buf;
 CborEncoder g_encoder, root_map, links_array;
 CborError g_err;
 
+#ifdef OC_REP_ARENA
+/* Bump allocator holding the nodes and values of one parsed payload. Any
+ * allocation that does not fit spills over to the rep pool and oc_mmem.
+ */
+#ifdef OC_DYNAMIC_ALLOCATION
+#ifndef OC_REP_ARENA_CHUNK_SIZE
+#define OC_REP_ARENA_CHUNK_SIZE (1024)
+#endif /* !OC_REP_ARENA_CHUNK_SIZE */
+#else /* OC_DYNAMIC_ALLOCATION */
+#ifndef OC_REP_ARENA_SIZE
+#define OC_REP_ARENA_SIZE (1024)
+#endif /* !OC_REP_ARENA_SIZE */
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+typedef union {
+  void *p;
+  double d;
+  int64_t i;
+} oc_rep_arena_align_t;
+
+#define REP_ARENA_ALIGN(size)                                                  \
+  (((size) + sizeof(oc_rep_arena_align_t) - 1) &                               \
+   ~(sizeof(oc_rep_arena_align_t) - 1))
+
+typedef struct oc_rep_arena_chunk_s
+{
+  struct oc_rep_arena_chunk_s *next;
+  uint8_t *data;
+  size_t size;
+  size_t used;
+} oc_rep_arena_chunk_t;
+
+#ifndef OC_DYNAMIC_ALLOCATION
+static oc_rep_arena_align_t
+  rep_arena_data[OC_REP_ARENA_SIZE / sizeof(oc_rep_arena_align_t)];
+static oc_rep_arena_chunk_t rep_arena_chunk = { NULL, (uint8_t *)rep_arena_data,
+                                                sizeof(rep_arena_data), 0 };
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+static struct
+{
+  oc_rep_arena_chunk_t *chunks;
+  bool active;
+  bool spilled;
+} rep_arena;
+
+static void *
+rep_arena_alloc(size_t size)
+{
+  if (!rep_arena.active) {
+    return NULL;
+  }
+  size = REP_ARENA_ALIGN(size);
+  oc_rep_arena_chunk_t *chunk = rep_arena.chunks;
+  if (!chunk || chunk->size - chunk->used < size) {
+#ifdef OC_DYNAMIC_ALLOCATION
+    size_t chunk_size =
+      size > OC_REP_ARENA_CHUNK_SIZE ? size : OC_REP_ARENA_CHUNK_SIZE;
+    chunk = (oc_rep_arena_chunk_t *)malloc(
+      REP_ARENA_ALIGN(sizeof(oc_rep_arena_chunk_t)) + chunk_size);
+    if (!chunk) {
+      rep_arena.spilled = true;
+      return NULL;
+    }
+    chunk->data =
+      (uint8_t *)chunk + REP_ARENA_ALIGN(sizeof(oc_rep_arena_chunk_t));
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    chunk->next = rep_arena.chunks;
+    rep_arena.chunks = chunk;
+#else  /* OC_DYNAMIC_ALLOCATION */
+    rep_arena.spilled = true;
+    return NULL;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  }
+  void *ptr = chunk->data + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+static bool
+rep_arena_owns(const void *ptr)
+{
+  oc_rep_arena_chunk_t *chunk = rep_arena.chunks;
+  while (chunk) {
+    if ((const uint8_t *)ptr >= chunk->data &&
+        (const uint8_t *)ptr < chunk->data + chunk->size) {
+      return true;
+    }
+    chunk = chunk->next;
+  }
+  return false;
+}
+
+void
+oc_rep_begin_arena(void)
+{
+#ifndef OC_DYNAMIC_ALLOCATION
+  rep_arena.chunks = &rep_arena_chunk;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  rep_arena.active = true;
+  rep_arena.spilled = false;
+}
+
+void
+oc_rep_end_arena(oc_rep_t *rep)
+{
+  /* Only a payload that spilled over needs to be walked */
+  if (rep_arena.spilled) {
+    oc_free_rep(rep);
+  }
+  rep_arena.active = false;
+  rep_arena.spilled = false;
+  oc_rep_arena_chunk_t *chunk = rep_arena.chunks;
+  if (!chunk) {
+    return;
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  /* Keep the oldest chunk for the next payload */
+  while (chunk->next) {
+    oc_rep_arena_chunk_t *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  rep_arena.chunks = chunk;
+#endif /* OC_DYNAMIC_ALLOCATION */
+  chunk->used = 0;
+}
+#endif /* OC_REP_ARENA */
+
 void
 oc_rep_set_pool(struct oc_memb *rep_objects_pool)
 {
   rep_objects = rep_objects_pool;
+#ifdef OC_REP_ARENA
+  rep_arena.active = false;
+#endif /* OC_REP_ARENA */
 }
 
 void
@@ -70,7 +207,15 @@ oc_rep_get_encoded_payload_size(void)
 static oc_rep_t *
 _alloc_rep(void)
 {
-  oc_rep_t *rep = oc_memb_alloc(rep_objects);
+  oc_rep_t *rep = NULL;
+#ifdef OC_REP_ARENA
+  rep = rep_arena_alloc(sizeof(oc_rep_t));
+  if (rep != NULL) {
+    memset(rep, 0, sizeof(oc_rep_t));
+    return rep;
+  }
+#endif /* OC_REP_ARENA */
+  rep = oc_memb_alloc(rep_objects);
   if (rep != NULL) {
     rep->name.size = 0;
   }
@@ -83,9 +228,63 @@ _alloc_rep(void)
 static void
 _free_rep(oc_rep_t *rep_value)
 {
+#ifdef OC_REP_ARENA
+  if (rep_arena_owns(rep_value)) {
+    return;
+  }
+#endif /* OC_REP_ARENA */
   oc_memb_free(rep_objects, rep_value);
 }
 
+static void
+_alloc_rep_value(oc_handle_t *value, size_t size, pool pool_type)
+{
+#ifdef OC_REP_ARENA
+  size_t elem_size = (pool_type == INT_POOL)      ? sizeof(int64_t)
+                     : (pool_type == DOUBLE_POOL) ? sizeof(double)
+                                                  : sizeof(uint8_t);
+  void *ptr = rep_arena_alloc(size * elem_size);
+  if (ptr != NULL) {
+    value->next = NULL;
+    value->ptr = ptr;
+    value->size = size;
+    return;
+  }
+#endif /* OC_REP_ARENA */
+  switch (pool_type) {
+  case INT_POOL:
+    oc_new_int_array(value, size);
+    break;
+  case DOUBLE_POOL:
+    oc_new_double_array(value, size);
+    break;
+  default:
+    oc_alloc_string(value, size);
+    break;
+  }
+}
+
+static void
+_free_rep_value(oc_handle_t *value, pool pool_type)
+{
+#ifdef OC_REP_ARENA
+  if (rep_arena_owns(value->ptr)) {
+    return;
+  }
+#endif /* OC_REP_ARENA */
+  switch (pool_type) {
+  case INT_POOL:
+    oc_free_int_array(value);
+    break;
+  case DOUBLE_POOL:
+    oc_free_double_array(value);
+    break;
+  default:
+    oc_free_string(value);
+    break;
+  }
+}
+
 void
 oc_free_rep(oc_rep_t *rep)
 {
@@ -95,20 +294,18 @@ oc_free_rep(oc_rep_t *rep)
   switch (rep->type) {
   case OC_REP_BYTE_STRING_ARRAY:
   case OC_REP_STRING_ARRAY:
-    oc_free_string_array(&rep->value.array);
-    break;
   case OC_REP_BOOL_ARRAY:
-    oc_free_bool_array(&rep->value.array);
+    _free_rep_value(&rep->value.array, BYTE_POOL);
     break;
   case OC_REP_DOUBLE_ARRAY:
-    oc_free_double_array(&rep->value.array);
+    _free_rep_value(&rep->value.array, DOUBLE_POOL);
     break;
   case OC_REP_INT_ARRAY:
-    oc_free_int_array(&rep->value.array);
+    _free_rep_value(&rep->value.array, INT_POOL);
     break;
   case OC_REP_BYTE_STRING:
   case OC_REP_STRING:
-    oc_free_string(&rep->value.string);
+    _free_rep_value(&rep->value.string, BYTE_POOL);
     break;
   case OC_REP_OBJECT:
     oc_free_rep(rep->value.object);
@@ -120,7 +317,7 @@ oc_free_rep(oc_rep_t *rep)
     break;
   }
   if (rep->name.size > 0)
-    oc_free_string(&rep->name);
+    _free_rep_value(&rep->name, BYTE_POOL);
   _free_rep(rep);
 }
 
@@ -160,7 +357,7 @@ oc_parse_rep_value(CborValue *value, oc_rep_t **rep, CborError *err)
   len++;
   if (*err != CborNoError || len == 0)
     return;
-  oc_alloc_string(&cur->name, len);
+  _alloc_rep_value(&cur->name, len, BYTE_POOL);
   *err |= cbor_value_copy_text_string(value, (char *)oc_string(cur->name), &len,
                                       NULL);
   if (*err != CborNoError)
@@ -192,7 +389,7 @@ get_tagged_value:
     len++;
     if (*err != CborNoError || len == 0)
       return;
-    oc_alloc_string(&cur->value.string, len);
+    _alloc_rep_value(&cur->value.string, len, BYTE_POOL);
     *err |= cbor_value_copy_byte_string(
       value, oc_cast(cur->value.string, uint8_t), &len, NULL);
     cur->type = OC_REP_BYTE_STRING;
@@ -202,7 +399,7 @@ get_tagged_value:
     len++;
     if (*err != CborNoError || len == 0)
       return;
-    oc_alloc_string(&cur->value.string, len);
+    _alloc_rep_value(&cur->value.string, len, BYTE_POOL);
     *err |= cbor_value_copy_text_string(value, oc_string(cur->value.string),
                                         &len, NULL);
     cur->type = OC_REP_STRING;
@@ -238,7 +435,7 @@ get_tagged_value:
       switch (array.type) {
       case CborIntegerType:
         if (k == 0) {
-          oc_new_int_array(&cur->value.array, len);
+          _alloc_rep_value(&cur->value.array, len, INT_POOL);
           cur->type = OC_REP_INT | OC_REP_ARRAY;
         } else if ((cur->type & OC_REP_INT) != OC_REP_INT) {
           *err |= CborErrorIllegalType;
@@ -250,7 +447,7 @@ get_tagged_value:
         break;
       case CborDoubleType:
         if (k == 0) {
-          oc_new_double_array(&cur->value.array, len);
+          _alloc_rep_value(&cur->value.array, len, DOUBLE_POOL);
           cur->type = OC_REP_DOUBLE | OC_REP_ARRAY;
         } else if ((cur->type & OC_REP_DOUBLE) != OC_REP_DOUBLE) {
           *err |= CborErrorIllegalType;
@@ -262,7 +459,7 @@ get_tagged_value:
         break;
       case CborBooleanType:
         if (k == 0) {
-          oc_new_bool_array(&cur->value.array, len);
+          _alloc_rep_value(&cur->value.array, len, BYTE_POOL);
           cur->type = OC_REP_BOOL | OC_REP_ARRAY;
         } else if ((cur->type & OC_REP_BOOL) != OC_REP_BOOL) {
           *err |= CborErrorIllegalType;
@@ -274,7 +471,10 @@ get_tagged_value:
         break;
       case CborByteStringType: {
         if (k == 0) {
-          oc_new_byte_string_array(&cur->value.array, len);
+          _alloc_rep_value(&cur->value.array,
+                           len * STRING_ARRAY_ITEM_MAX_LEN, BYTE_POOL);
+          memset(oc_string(cur->value.array), 0,
+                 len * STRING_ARRAY_ITEM_MAX_LEN);
           cur->type = OC_REP_BYTE_STRING | OC_REP_ARRAY;
         } else if ((cur->type & OC_REP_BYTE_STRING) != OC_REP_BYTE_STRING) {
           *err |= CborErrorIllegalType;
@@ -295,7 +495,10 @@ get_tagged_value:
       } break;
       case CborTextStringType:
         if (k == 0) {
-          oc_new_string_array(&cur->value.array, len);
+          _alloc_rep_value(&cur->value.array,
+                           len * STRING_ARRAY_ITEM_MAX_LEN, BYTE_POOL);
+          memset(oc_string(cur->value.array), 0,
+                 len * STRING_ARRAY_ITEM_MAX_LEN);
           cur->type = OC_REP_STRING | OC_REP_ARRAY;
         } else if ((cur->type & OC_REP_STRING) != OC_REP_STRING) {
           *err |= CborErrorIllegalType;
@@ -16,6 +16,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "util/oc_etimer.h"
@@ -44,6 +45,8 @@
 #include "oc_ri.h"
 #include "oc_uuid.h"
 
+#include "api/oc_work_internal.h"
+
 #ifdef OC_BLOCK_WISE
 #include "oc_blockwise.h"
 #endif /* OC_BLOCK_WISE */
@@ -60,9 +63,17 @@
 #include "security/oc_audit.h"
 #endif /* OC_SECURITY */
 
+/* Event callbacks are kept ordered by deadline, and indexed by their data
+   and callback in a hash table of this many buckets so that they are found
+   without walking the list. */
+#ifndef OC_EVENT_CALLBACK_BUCKETS
+#define OC_EVENT_CALLBACK_BUCKETS (32)
+#endif /* !OC_EVENT_CALLBACK_BUCKETS */
+
 #ifdef OC_SERVER
 OC_LIST(app_resources);
-OC_LIST(observe_callbacks);
+OC_DLIST(observe_callbacks);
+static oc_event_callback_t *observe_callbacks_index[OC_EVENT_CALLBACK_BUCKETS];
 OC_MEMB(app_resources_s, oc_resource_t, OC_MAX_APP_RESOURCES);
 #endif /* OC_SERVER */
 
@@ -72,7 +83,8 @@ OC_LIST(client_cbs);
 OC_MEMB(client_cbs_s, oc_client_cb_t, OC_MAX_NUM_CONCURRENT_REQUESTS + 1);
 #endif /* OC_CLIENT */
 
-OC_LIST(timed_callbacks);
+OC_DLIST(timed_callbacks);
+static oc_event_callback_t *timed_callbacks_index[OC_EVENT_CALLBACK_BUCKETS];
 OC_MEMB(event_callbacks_s, oc_event_callback_t,
         1 + OCF_D * OC_MAX_NUM_DEVICES + OC_MAX_APP_RESOURCES +
           OC_MAX_NUM_CONCURRENT_REQUESTS * 2);
@@ -251,11 +263,13 @@ start_processes(void)
 #ifdef OC_TCP
   oc_process_start(&oc_session_events, NULL);
 #endif /* OC_TCP */
+  oc_process_start(&oc_work_events, NULL);
 }
 
 static void
 stop_processes(void)
 {
+  oc_process_exit(&oc_work_events);
 #ifdef OC_TCP
   oc_process_exit(&oc_session_events);
 #endif /* OC_TCP */
@@ -318,14 +332,14 @@ oc_ri_init(void)
 
 #ifdef OC_SERVER
   oc_list_init(app_resources);
-  oc_list_init(observe_callbacks);
+  oc_dlist_init(observe_callbacks);
 #endif
 
 #ifdef OC_CLIENT
   oc_list_init(client_cbs);
 #endif
 
-  oc_list_init(timed_callbacks);
+  oc_dlist_init(timed_callbacks);
 
   oc_process_init();
   start_processes();
@@ -393,22 +407,94 @@ oc_ri_free_resource_properties(oc_resource_t *resource)
   }
 }
 
+static unsigned
+event_callback_bucket(void *data, oc_trigger_t callback)
+{
+  uintptr_t key = ((uintptr_t)data >> 3) ^ ((uintptr_t)callback >> 2);
+  key ^= key >> 16;
+  return (unsigned)(key % OC_EVENT_CALLBACK_BUCKETS);
+}
+
+static bool
+deadline_before(oc_clock_time_t a, oc_clock_time_t b)
+{
+  /* Compare the distance between them, as the clock may wrap */
+  return (oc_clock_time_t)(a - b) > ((oc_clock_time_t)-1 >> 1);
+}
+
+static void
+insert_event_callback(oc_dlist_t list, oc_event_callback_t *event_cb)
+{
+  oc_clock_time_t expiration = oc_etimer_expiration_time(&event_cb->timer);
+  /* Most callbacks are due after all the others, so look from the tail */
+  oc_event_callback_t *prev = (oc_event_callback_t *)oc_dlist_tail(list);
+
+  while (prev != NULL &&
+         deadline_before(expiration, oc_etimer_expiration_time(&prev->timer))) {
+    prev = prev->prev;
+  }
+  oc_dlist_insert(list, prev, event_cb);
+}
+
+static void
+add_event_callback(oc_dlist_t list, oc_event_callback_t **index,
+                   oc_event_callback_t *event_cb)
+{
+  oc_event_callback_t **link =
+    &index[event_callback_bucket(event_cb->data, event_cb->callback)];
+
+  insert_event_callback(list, event_cb);
+  /* Appended, so that of several callbacks with the same data and callback
+     the one added first is found, as when the lists were searched */
+  while (*link != NULL) {
+    link = &(*link)->bucket_next;
+  }
+  event_cb->bucket_next = NULL;
+  *link = event_cb;
+}
+
+static oc_event_callback_t *
+find_event_callback(oc_event_callback_t **index, void *data,
+                    oc_trigger_t callback)
+{
+  oc_event_callback_t *event_cb = index[event_callback_bucket(data, callback)];
+
+  while (event_cb != NULL &&
+         (event_cb->data != data || event_cb->callback != callback)) {
+    event_cb = event_cb->bucket_next;
+  }
+  return event_cb;
+}
+
+static void
+remove_event_callback(oc_dlist_t list, oc_event_callback_t **index,
+                      oc_event_callback_t *event_cb)
+{
+  oc_event_callback_t **link =
+    &index[event_callback_bucket(event_cb->data, event_cb->callback)];
+
+  while (*link != NULL && *link != event_cb) {
+    link = &(*link)->bucket_next;
+  }
+  if (*link != NULL) {
+    *link = event_cb->bucket_next;
+  }
+  event_cb->bucket_next = NULL;
+  oc_dlist_remove(list, event_cb);
+}
+
 void
 oc_ri_remove_timed_event_callback(void *cb_data, oc_trigger_t event_callback)
 {
   oc_event_callback_t *event_cb =
-    (oc_event_callback_t *)oc_list_head(timed_callbacks);
+    find_event_callback(timed_callbacks_index, cb_data, event_callback);
 
-  while (event_cb != NULL) {
-    if (event_cb->data == cb_data && event_cb->callback == event_callback) {
-      OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
-      oc_etimer_stop(&event_cb->timer);
-      OC_PROCESS_CONTEXT_END(&timed_callback_events);
-      oc_list_remove(timed_callbacks, event_cb);
-      oc_memb_free(&event_callbacks_s, event_cb);
-      break;
-    }
-    event_cb = event_cb->next;
+  if (event_cb != NULL) {
+    OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
+    oc_etimer_stop(&event_cb->timer);
+    OC_PROCESS_CONTEXT_END(&timed_callback_events);
+    remove_event_callback(timed_callbacks, timed_callbacks_index, event_cb);
+    oc_memb_free(&event_callbacks_s, event_cb);
   }
 }
 
@@ -425,37 +511,33 @@ oc_ri_add_timed_event_callback_ticks(void *cb_data, oc_trigger_t event_callback,
     OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
     oc_etimer_set(&event_cb->timer, ticks);
     OC_PROCESS_CONTEXT_END(&timed_callback_events);
-    oc_list_add(timed_callbacks, event_cb);
+    add_event_callback(timed_callbacks, timed_callbacks_index, event_cb);
   } else {
     OC_WRN("insufficient memory to add timed event callback");
   }
 }
 
 static void
-poll_event_callback_timers(oc_list_t list, struct oc_memb *cb_pool)
+poll_event_callback_timers(oc_dlist_t list, oc_event_callback_t **index,
+                           struct oc_memb *cb_pool)
 {
-  oc_event_callback_t *event_cb = (oc_event_callback_t *)oc_list_head(list),
-                      *next;
+  oc_event_callback_t *event_cb;
 
-  while (event_cb != NULL) {
-    next = event_cb->next;
-
-    if (oc_etimer_expired(&event_cb->timer)) {
-      if (event_cb->callback(event_cb->data) == OC_EVENT_DONE) {
-        oc_list_remove(list, event_cb);
-        oc_memb_free(cb_pool, event_cb);
-        event_cb = oc_list_head(list);
-        continue;
-      } else {
-        OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
-        oc_etimer_restart(&event_cb->timer);
-        OC_PROCESS_CONTEXT_END(&timed_callback_events);
-        event_cb = oc_list_head(list);
-        continue;
-      }
+  /* The callbacks that are due are at the head of the list. One that
+     continues is not due again before its timer expires anew, so it can be
+     put back at its new place right away. */
+  while ((event_cb = (oc_event_callback_t *)oc_dlist_head(list)) != NULL &&
+         oc_etimer_expired(&event_cb->timer)) {
+    if (event_cb->callback(event_cb->data) == OC_EVENT_DONE) {
+      remove_event_callback(list, index, event_cb);
+      oc_memb_free(cb_pool, event_cb);
+    } else {
+      OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
+      oc_etimer_restart(&event_cb->timer);
+      OC_PROCESS_CONTEXT_END(&timed_callback_events);
+      oc_dlist_remove(list, event_cb);
+      insert_event_callback(list, event_cb);
     }
-
-    event_cb = next;
   }
 }
 
@@ -463,9 +545,11 @@ static void
 check_event_callbacks(void)
 {
 #ifdef OC_SERVER
-  poll_event_callback_timers(observe_callbacks, &event_callbacks_s);
+  poll_event_callback_timers(observe_callbacks, observe_callbacks_index,
+                             &event_callbacks_s);
 #endif /* OC_SERVER */
-  poll_event_callback_timers(timed_callbacks, &event_callbacks_s);
+  poll_event_callback_timers(timed_callbacks, timed_callbacks_index,
+                             &event_callbacks_s);
 }
 
 #ifdef OC_SERVER
@@ -494,22 +578,8 @@ periodic_observe_handler(void *data)
 static oc_event_callback_t *
 get_periodic_observe_callback(oc_resource_t *resource)
 {
-  oc_event_callback_t *event_cb;
-  bool found = false;
-
-  for (event_cb = (oc_event_callback_t *)oc_list_head(observe_callbacks);
-       event_cb; event_cb = event_cb->next) {
-    if (resource == event_cb->data) {
-      found = true;
-      break;
-    }
-  }
-
-  if (found) {
-    return event_cb;
-  }
-
-  return NULL;
+  return find_event_callback(observe_callbacks_index, resource,
+                             periodic_observe_handler);
 }
 
 static void
@@ -519,7 +589,8 @@ remove_periodic_observe_callback(oc_resource_t *resource)
 
   if (event_cb) {
     oc_etimer_stop(&event_cb->timer);
-    oc_list_remove(observe_callbacks, event_cb);
+    remove_event_callback(observe_callbacks, observe_callbacks_index,
+                          event_cb);
     oc_memb_free(&event_callbacks_s, event_cb);
   }
 }
@@ -543,7 +614,7 @@ add_periodic_observe_callback(oc_resource_t *resource)
     oc_etimer_set(&event_cb->timer,
                   resource->observe_period_seconds * OC_CLOCK_SECOND);
     OC_PROCESS_CONTEXT_END(&timed_callback_events);
-    oc_list_add(observe_callbacks, event_cb);
+    add_event_callback(observe_callbacks, observe_callbacks_index, event_cb);
   }
 
   return true;
@@ -555,22 +626,24 @@ free_all_event_timers(void)
 {
 #ifdef OC_SERVER
   oc_event_callback_t *obs_cb =
-    (oc_event_callback_t *)oc_list_pop(observe_callbacks);
+    (oc_event_callback_t *)oc_dlist_pop(observe_callbacks);
   while (obs_cb != NULL) {
     oc_etimer_stop(&obs_cb->timer);
-    oc_list_remove(observe_callbacks, obs_cb);
+    oc_dlist_remove(observe_callbacks, obs_cb);
     oc_memb_free(&event_callbacks_s, obs_cb);
-    obs_cb = oc_list_pop(observe_callbacks);
+    obs_cb = oc_dlist_pop(observe_callbacks);
   }
+  memset(observe_callbacks_index, 0, sizeof(observe_callbacks_index));
 #endif /* OC_SERVER */
   oc_event_callback_t *event_cb =
-    (oc_event_callback_t *)oc_list_pop(timed_callbacks);
+    (oc_event_callback_t *)oc_dlist_pop(timed_callbacks);
   while (event_cb != NULL) {
     oc_etimer_stop(&event_cb->timer);
-    oc_list_remove(timed_callbacks, event_cb);
+    oc_dlist_remove(timed_callbacks, event_cb);
     oc_memb_free(&event_callbacks_s, event_cb);
-    event_cb = oc_list_pop(timed_callbacks);
+    event_cb = oc_dlist_pop(timed_callbacks);
   }
+  memset(timed_callbacks_index, 0, sizeof(timed_callbacks_index));
 }
 
 oc_interface_mask_t
@@ -792,13 +865,16 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
   oc_rep_t rep_objects_pool[OC_MAX_NUM_REP_OBJECTS];
   memset(rep_objects_alloc, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(char));
   memset(rep_objects_pool, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t));
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS,
-                                 rep_objects_alloc, (void *)rep_objects_pool,
-                                 0 };
+  struct oc_memb rep_objects =
+    OC_MEMB_INIT(sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS, rep_objects_alloc,
+                 (void *)rep_objects_pool, 0);
 #else  /* !OC_DYNAMIC_ALLOCATION */
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
 #endif /* OC_DYNAMIC_ALLOCATION */
   oc_rep_set_pool(&rep_objects);
+#ifdef OC_REP_ARENA
+  oc_rep_begin_arena();
+#endif /* OC_REP_ARENA */
 
   if (payload_len > 0 &&
       (cf == APPLICATION_CBOR || cf == APPLICATION_VND_OCF_CBOR)) {
@@ -893,7 +969,9 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
       OC_DBG("creating new block-wise response state");
       *response_state = oc_blockwise_alloc_response_buffer(
         uri_path, uri_path_len, endpoint, method, OC_BLOCKWISE_SERVER);
-      if (!(*response_state)) {
+      if (!(*response_state) ||
+          !oc_blockwise_reserve_buffer(*response_state,
+                                       OC_MAX_APP_DATA_SIZE)) {
         OC_ERR("failure to alloc response state");
         bad_request = true;
       } else {
@@ -962,12 +1040,16 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
     }
   }
 
+#ifdef OC_REP_ARENA
+  oc_rep_end_arena(request_obj.request_payload);
+#else  /* OC_REP_ARENA */
   if (request_obj.request_payload) {
     /* To the extent that the request payload was parsed, free the
      * payload structure (and return its memory to the pool).
      */
     oc_free_rep(request_obj.request_payload);
   }
+#endif /* !OC_REP_ARENA */
 
   if (forbidden) {
     OC_WRN("ocri: Forbidden request");
@@ -1382,11 +1464,11 @@ oc_ri_invoke_client_cb(void *response, oc_client_cb_t *cb,
   oc_rep_t rep_objects_pool[OC_MAX_NUM_REP_OBJECTS];
   memset(rep_objects_alloc, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(char));
   memset(rep_objects_pool, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t));
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS,
-                                 rep_objects_alloc, (void *)rep_objects_pool,
-                                 0 };
+  struct oc_memb rep_objects =
+    OC_MEMB_INIT(sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS, rep_objects_alloc,
+                 (void *)rep_objects_pool, 0);
 #else  /* !OC_DYNAMIC_ALLOCATION */
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
 #endif /* OC_DYNAMIC_ALLOCATION */
   oc_rep_set_pool(&rep_objects);
   if (payload_len) {
@@ -1408,6 +1490,9 @@ oc_ri_invoke_client_cb(void *response, oc_client_cb_t *cb,
        * has not been set to the CBOR encoding.
        */
       if (cf == APPLICATION_CBOR || cf == APPLICATION_VND_OCF_CBOR) {
+#ifdef OC_REP_ARENA
+        oc_rep_begin_arena();
+#endif /* OC_REP_ARENA */
         err = oc_parse_rep(payload, payload_len, &client_response.payload);
       }
       if (err == 0) {
@@ -1417,9 +1502,13 @@ oc_ri_invoke_client_cb(void *response, oc_client_cb_t *cb,
       } else {
         OC_WRN("Error parsing payload!");
       }
+#ifdef OC_REP_ARENA
+      oc_rep_end_arena(client_response.payload);
+#else  /* OC_REP_ARENA */
       if (client_response.payload) {
         oc_free_rep(client_response.payload);
       }
+#endif /* !OC_REP_ARENA */
     }
   } else {
     if (pkt->type == COAP_TYPE_ACK && pkt->code == 0) {
@@ -509,6 +509,11 @@ oc_send_separate_response(oc_separate_response_t *handle,
           if (!response_state) {
             goto next_separate_request;
           }
+          if (!oc_blockwise_reserve_buffer(response_state,
+                                           response_buffer.response_length)) {
+            oc_blockwise_free_response_buffer(response_state);
+            goto next_separate_request;
+          }
 
           memcpy(response_state->buffer, response_buffer.buffer,
                  response_buffer.response_length);
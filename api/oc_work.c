@@ -0,0 +1,133 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "api/oc_work_internal.h"
+#include "oc_api.h"
+#include "oc_config.h"
+#include "oc_signal_event_loop.h"
+#include "port/oc_log.h"
+#include "port/oc_network_events_mutex.h"
+#include "util/oc_list.h"
+#include "util/oc_memb.h"
+
+#ifndef OC_MAX_NUM_WORK_ITEMS
+#define OC_MAX_NUM_WORK_ITEMS (8)
+#endif /* !OC_MAX_NUM_WORK_ITEMS */
+
+typedef struct oc_work_item_s
+{
+  struct oc_work_item_s *next;
+  struct oc_work_item_s *prev;
+  oc_work_handler_t handler;
+  void *data;
+} oc_work_item_t;
+
+/* The pool and the queue are shared with the submitting threads, so they are
+ * only touched with the network event mutex held, and never while a handler
+ * runs. Like other pools, the pool only limits the pending work without
+ * OC_DYNAMIC_ALLOCATION.
+ */
+OC_MEMB(work_items_s, oc_work_item_t, OC_MAX_NUM_WORK_ITEMS);
+OC_DLIST(work_items);
+
+static bool
+pop_work(oc_work_handler_t *handler, void **data)
+{
+  oc_network_event_handler_mutex_lock();
+  oc_work_item_t *item = (oc_work_item_t *)oc_dlist_pop(work_items);
+  if (item) {
+    *handler = item->handler;
+    *data = item->data;
+    oc_memb_free(&work_items_s, item);
+  }
+  oc_network_event_handler_mutex_unlock();
+  return item != NULL;
+}
+
+static void
+run_work(void)
+{
+  /* Work submitted by the handlers themselves waits for the next poll, so
+   * that a handler that keeps resubmitting cannot starve the event loop.
+   */
+  oc_network_event_handler_mutex_lock();
+  int pending = oc_dlist_length(work_items);
+  oc_network_event_handler_mutex_unlock();
+
+  oc_work_handler_t handler;
+  void *data;
+  while (pending-- > 0 && pop_work(&handler, &data)) {
+    handler(data);
+  }
+
+  oc_network_event_handler_mutex_lock();
+  bool more = oc_dlist_length(work_items) > 0;
+  oc_network_event_handler_mutex_unlock();
+  if (more) {
+    oc_process_poll(&oc_work_events);
+  }
+}
+
+static void
+drop_work(void)
+{
+  oc_work_handler_t handler;
+  void *data;
+  int dropped = 0;
+  while (pop_work(&handler, &data)) {
+    dropped++;
+  }
+  if (dropped > 0) {
+    OC_DBG("dropped %d pending work items", dropped);
+  }
+}
+
+OC_PROCESS(oc_work_events, "");
+OC_PROCESS_THREAD(oc_work_events, ev, data)
+{
+  (void)data;
+  OC_PROCESS_POLLHANDLER(run_work());
+  OC_PROCESS_BEGIN();
+  while (oc_process_is_running(&(oc_work_events))) {
+    OC_PROCESS_YIELD();
+  }
+  drop_work();
+  OC_PROCESS_END();
+}
+
+bool
+oc_submit_work(oc_work_handler_t handler, void *data)
+{
+  if (!handler || !oc_process_is_running(&(oc_work_events))) {
+    return false;
+  }
+
+  oc_network_event_handler_mutex_lock();
+  oc_work_item_t *item = (oc_work_item_t *)oc_memb_alloc(&work_items_s);
+  if (item) {
+    item->handler = handler;
+    item->data = data;
+    oc_dlist_add(work_items, item);
+  }
+  oc_network_event_handler_mutex_unlock();
+
+  if (!item) {
+    OC_WRN("insufficient memory to submit work");
+    return false;
+  }
+
+  oc_process_poll(&(oc_work_events));
+  _oc_signal_event_loop();
+  return true;
+}
@@ -18,8 +18,11 @@
  *
  ******************************************************************/
 
+#include <chrono>
 #include <cstdlib>
 #include <string>
+#include <thread>
+#include <vector>
 #include <stdio.h>
 #include <gtest/gtest.h>
 
@@ -27,6 +30,8 @@
 #include "oc_api.h"
 #include "oc_ri.h"
 #include "oc_helpers.h"
+#include "util/oc_etimer.h"
+#include "util/oc_process.h"
 
 
 #define RESOURCE_URI "/LightResourceURI"
@@ -141,3 +146,51 @@ TEST_F(TestOcRi, RiAddResource_P)
     EXPECT_EQ(res_check, 1);
     oc_ri_delete_resource(res);
 }
+
+static std::vector<int> fired_callbacks;
+
+static oc_event_callback_retval_t recordCallback(void *data)
+{
+    fired_callbacks.push_back(*(int *)data);
+    return OC_EVENT_DONE;
+}
+
+/* Lets the given time pass, then runs the event loop until it is idle */
+static void runTimedCallbacks(int milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    oc_etimer_request_poll();
+    while (oc_process_run()) {
+    }
+}
+
+#define TICKS_MS(ms) ((oc_clock_time_t)(ms) * OC_CLOCK_SECOND / 1000)
+
+TEST_F(TestOcRi, TimedCallbacksFireInDeadlineOrder)
+{
+    int data[4] = { 0, 1, 2, 3 };
+
+    fired_callbacks.clear();
+    oc_ri_add_timed_event_callback_ticks(&data[2], recordCallback, TICKS_MS(30));
+    oc_ri_add_timed_event_callback_ticks(&data[0], recordCallback, TICKS_MS(10));
+    oc_ri_add_timed_event_callback_ticks(&data[3], recordCallback, TICKS_MS(40));
+    oc_ri_add_timed_event_callback_ticks(&data[1], recordCallback, TICKS_MS(20));
+
+    runTimedCallbacks(60);
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), fired_callbacks);
+}
+
+TEST_F(TestOcRi, RemoveTimedCallbackRemovesFirstAdded)
+{
+    int data = 7;
+
+    fired_callbacks.clear();
+    oc_ri_add_timed_event_callback_ticks(&data, recordCallback, TICKS_MS(10));
+    oc_ri_add_timed_event_callback_ticks(&data, recordCallback,
+                                         10 * OC_CLOCK_SECOND);
+
+    /* The one added first is gone, so nothing is due yet */
+    oc_ri_remove_timed_event_callback(&data, recordCallback);
+    runTimedCallbacks(30);
+    EXPECT_TRUE(fired_callbacks.empty());
+}
@@ -335,3 +335,29 @@ TEST(OCEndpoints, EndpointStringParsePath)
   }
 
 }
+
+TEST(OCEndpoints, EndpointToCachedString)
+{
+  const char *spu[4] = { "coaps://[fe80::1]:5683", "coap://[2001:db8::ab:1]:9",
+                         "coap+tcp://10.211.55.3:56789",
+                         "coaps+tcp://[ff02::158]:2439" };
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 4; i++) {
+#if !defined(OC_IPV4) || !defined(OC_TCP)
+      if (i >= 2) {
+        continue;
+      }
+#endif /* !OC_IPV4 || !OC_TCP */
+      oc_string_t s;
+      oc_new_string(&s, spu[i], strlen(spu[i]));
+      oc_endpoint_t ep;
+      memset(&ep, 0, sizeof(oc_endpoint_t));
+      int ret = oc_string_to_endpoint(&s, &ep, NULL);
+      EXPECT_EQ(ret, 0) << "spu[" << i << "] " << spu[i];
+      char ep_str[OC_ENDPOINT_STRING_SIZE];
+      EXPECT_EQ(0, oc_endpoint_to_cached_string(&ep, ep_str));
+      EXPECT_STREQ(spu[i], ep_str);
+      oc_free_string(&s);
+    }
+  }
+}
@@ -0,0 +1,189 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "oc_buffer.h"
+#include "oc_mem_stats.h"
+#include "util/oc_memb.h"
+#include "util/oc_mmem.h"
+
+#if defined(OC_MEMORY_STATS) && !defined(OC_MEMB_PREALLOC)
+OC_MEMB(stats_test_pool, uint64_t, 2);
+
+static void
+collect_stats(const oc_mem_pool_stats_t *stats, void *user_data)
+{
+  std::vector<oc_mem_pool_stats_t> *all =
+    (std::vector<oc_mem_pool_stats_t> *)user_data;
+  all->push_back(*stats);
+}
+
+static std::vector<oc_mem_pool_stats_t>
+pool_stats(void)
+{
+  std::vector<oc_mem_pool_stats_t> all;
+  oc_mem_stats_iterate(collect_stats, &all);
+  return all;
+}
+
+/* Counters of the named pool, or nullptr while it is not listed */
+static const oc_mem_pool_stats_t *
+find_pool(const std::vector<oc_mem_pool_stats_t> &all, const char *name,
+          size_t *listed)
+{
+  const oc_mem_pool_stats_t *found = nullptr;
+  *listed = 0;
+  for (const oc_mem_pool_stats_t &stats : all) {
+    if (strcmp(stats.name, name) == 0) {
+      found = &stats;
+      (*listed)++;
+    }
+  }
+  return found;
+}
+
+static const oc_mem_pool_stats_t *
+find_test_pool(const std::vector<oc_mem_pool_stats_t> &all, size_t *listed)
+{
+  return find_pool(all, "stats_test_pool", listed);
+}
+
+static int buffers_avail;
+
+class TestMemStats : public testing::Test
+{
+protected:
+  static void SetUpTestCase() { oc_mmem_init(); }
+};
+
+TEST_F(TestMemStats, MmemPoolsComeFirst)
+{
+  std::vector<oc_mem_pool_stats_t> all = pool_stats();
+  ASSERT_LE(3u, all.size());
+  EXPECT_EQ(std::string("bytes"), all[0].name);
+  EXPECT_EQ(std::string("ints"), all[1].name);
+  EXPECT_EQ(std::string("doubles"), all[2].name);
+  EXPECT_EQ(sizeof(int64_t), all[1].unit_size);
+  EXPECT_EQ(sizeof(double), all[2].unit_size);
+}
+
+TEST_F(TestMemStats, MembPoolIsListedOnceFromFirstAlloc)
+{
+  size_t listed;
+  EXPECT_EQ(nullptr, find_test_pool(pool_stats(), &listed));
+
+  void *a = oc_memb_alloc(&stats_test_pool);
+  ASSERT_NE(nullptr, a);
+  void *b = oc_memb_alloc(&stats_test_pool);
+  ASSERT_NE(nullptr, b);
+  oc_memb_free(&stats_test_pool, b);
+
+  std::vector<oc_mem_pool_stats_t> all = pool_stats();
+  const oc_mem_pool_stats_t *stats = find_test_pool(all, &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(1u, listed);
+  EXPECT_EQ(sizeof(uint64_t), stats->unit_size);
+  EXPECT_EQ(1u, stats->in_use);
+  EXPECT_EQ(2u, stats->peak);
+  EXPECT_EQ(2u, stats->allocs);
+
+  oc_mem_stats_reset_peaks();
+  all = pool_stats();
+  stats = find_test_pool(all, &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(1u, listed);
+  EXPECT_EQ(1u, stats->peak);
+
+  oc_memb_free(&stats_test_pool, a);
+  all = pool_stats();
+  stats = find_test_pool(all, &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(0u, stats->in_use);
+}
+
+TEST_F(TestMemStats, IncomingMessagesAreCounted)
+{
+  /* Other tests may have left messages allocated or cached for reuse */
+  size_t listed;
+  std::vector<oc_mem_pool_stats_t> all = pool_stats();
+  const oc_mem_pool_stats_t *stats =
+    find_pool(all, "oc_incoming_buffers", &listed);
+  oc_mem_pool_stats_t before = {};
+  if (stats) {
+    before = *stats;
+  }
+
+  /* Also with OC_LOCKFREE_NETWORK_EVENTS, where receive threads take the
+   * messages from a free list of their own */
+  oc_message_t *message = oc_allocate_message();
+  ASSERT_NE(nullptr, message);
+  all = pool_stats();
+  stats = find_pool(all, "oc_incoming_buffers", &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(1u, listed);
+  EXPECT_LE(before.in_use, stats->in_use);
+  EXPECT_LE(stats->in_use, before.in_use + 1);
+  EXPECT_LE(stats->in_use, stats->peak);
+  EXPECT_EQ(before.failures, stats->failures);
+#ifndef OC_DYNAMIC_ALLOCATION
+  EXPECT_EQ(before.in_use + 1, stats->in_use);
+  EXPECT_EQ(before.allocs + 1, stats->allocs);
+  size_t in_use = stats->in_use;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+  buffers_avail = -1;
+  oc_set_buffers_avail_cb([](int num_free) { buffers_avail = num_free; });
+  oc_message_unref(message);
+  oc_set_buffers_avail_cb(NULL);
+#ifdef OC_DYNAMIC_ALLOCATION
+  /* The pool is only bounded by the heap */
+  EXPECT_EQ(0, buffers_avail);
+#else  /* OC_DYNAMIC_ALLOCATION */
+  all = pool_stats();
+  stats = find_pool(all, "oc_incoming_buffers", &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(in_use - 1, stats->in_use);
+  EXPECT_EQ((int)(stats->capacity - stats->in_use), buffers_avail);
+#endif /* !OC_DYNAMIC_ALLOCATION */
+}
+
+#ifndef OC_DYNAMIC_ALLOCATION
+TEST_F(TestMemStats, ExhaustionIsCounted)
+{
+  void *a = oc_memb_alloc(&stats_test_pool);
+  void *b = oc_memb_alloc(&stats_test_pool);
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, b);
+  EXPECT_EQ(nullptr, oc_memb_alloc(&stats_test_pool));
+
+  size_t listed;
+  std::vector<oc_mem_pool_stats_t> all = pool_stats();
+  const oc_mem_pool_stats_t *stats = find_test_pool(all, &listed);
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(2u, stats->capacity);
+  EXPECT_EQ(2u, stats->in_use);
+  EXPECT_EQ(1u, stats->failures);
+
+  oc_memb_free(&stats_test_pool, a);
+  oc_memb_free(&stats_test_pool, b);
+}
+#endif /* !OC_DYNAMIC_ALLOCATION */
+#endif /* OC_MEMORY_STATS && !OC_MEMB_PREALLOC */
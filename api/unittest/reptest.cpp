@@ -76,7 +76,7 @@ TEST(TestRep, OCRepSetGetDouble)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -133,7 +133,7 @@ TEST(TestRep, OCRepSetGetInt)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -211,7 +211,7 @@ TEST(TestRep, OCRepSetGetUint)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -280,7 +280,7 @@ TEST(TestRep, OCRepSetGetBool)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -355,7 +355,7 @@ TEST(TestRep, OCRepSetGetTextString)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -430,7 +430,7 @@ TEST(TestRep, OCRepSetGetByteString)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -509,7 +509,7 @@ TEST(TestRep, OCRepSetGetIntArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -585,7 +585,7 @@ TEST(TestRep, OCRepAddGetIntArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -655,7 +655,7 @@ TEST(TestRep, OCRepAddGetIntArrayUsingSetKeyAndBeginArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -713,7 +713,7 @@ TEST(TestRep, OCRepSetGetBoolArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -788,7 +788,7 @@ TEST(TestRep, OCRepAddGetBoolArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -846,7 +846,7 @@ TEST(TestRep, OCRepSetGetDoubleArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -930,7 +930,7 @@ TEST(TestRep, OCRepAddGetDoubleArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1007,7 +1007,7 @@ TEST(TestRep, OCRepSetGetObject)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1112,7 +1112,7 @@ TEST(TestRep, OCRepSetGetObjectArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1240,7 +1240,7 @@ TEST(TestRep, OCRepAddGetByteStringArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1332,7 +1332,7 @@ TEST(TestRep, OCRepSetGetStringArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1424,7 +1424,7 @@ TEST(TestRep, OCRepAddGetStringArray)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1523,7 +1523,7 @@ TEST(TestRep, OCRepRootArrayObject)
   const uint8_t *payload = oc_rep_get_encoder_buf();
   int payload_len = oc_rep_get_encoded_payload_size();
   EXPECT_NE(payload_len, -1);
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
   oc_rep_set_pool(&rep_objects);
   oc_rep_t *rep = NULL;
   oc_parse_rep(payload, payload_len, &rep);
@@ -1605,3 +1605,61 @@ TEST(TestRep, OCRepRootArrayObject)
 
   oc_free_rep(rep);
 }
+
+#ifdef OC_REP_ARENA
+TEST(TestRep, OCRepParseIntoArena)
+{
+  /*buffer for oc_rep_t */
+  uint8_t buf[1024];
+  oc_rep_new(&buf[0], 1024);
+
+  /* add values to root object */
+  oc_rep_start_root_object();
+  oc_rep_set_object(root, my_object);
+  oc_rep_set_int(my_object, a, 1);
+  oc_rep_set_text_string(my_object, c, "three");
+  oc_rep_close_object(root, my_object);
+  int64_t fib[] = { 1, 1, 2, 3, 5, 8, 13 };
+  oc_rep_open_array(root, fibonacci);
+  for (size_t i = 0; i < (sizeof(fib) / sizeof(fib[0])); i++) {
+    oc_rep_add_int(fibonacci, fib[i]);
+  }
+  oc_rep_close_array(root, fibonacci);
+  oc_rep_end_root_object();
+  EXPECT_EQ(CborNoError, oc_rep_get_cbor_errno());
+
+  const uint8_t *payload = oc_rep_get_encoder_buf();
+  int payload_len = oc_rep_get_encoded_payload_size();
+  EXPECT_NE(payload_len, -1);
+  struct oc_memb rep_objects = OC_MEMB_INIT(sizeof(oc_rep_t), 0, 0, 0, 0);
+
+  /* parse twice to check that the arena is reusable after a reset */
+  for (int round = 0; round < 2; round++) {
+    oc_rep_set_pool(&rep_objects);
+    oc_rep_begin_arena();
+    oc_rep_t *rep = NULL;
+    EXPECT_EQ(CborNoError, oc_parse_rep(payload, payload_len, &rep));
+    ASSERT_TRUE(rep != NULL);
+
+    oc_rep_t *my_object_out = NULL;
+    EXPECT_TRUE(oc_rep_get_object(rep, "my_object", &my_object_out));
+    ASSERT_TRUE(my_object_out != NULL);
+    int64_t a_out = 0;
+    EXPECT_TRUE(oc_rep_get_int(my_object_out, "a", &a_out));
+    EXPECT_EQ(1, a_out);
+    char *c_out = NULL;
+    size_t c_out_size = 0;
+    EXPECT_TRUE(oc_rep_get_string(my_object_out, "c", &c_out, &c_out_size));
+    EXPECT_STREQ("three", c_out);
+    int64_t *fib_out = 0;
+    size_t fib_len = 0;
+    EXPECT_TRUE(oc_rep_get_int_array(rep, "fibonacci", &fib_out, &fib_len));
+    ASSERT_EQ(sizeof(fib) / sizeof(fib[0]), fib_len);
+    for (size_t i = 0; i < fib_len; ++i) {
+      EXPECT_EQ(fib[i], fib_out[i]);
+    }
+
+    oc_rep_end_arena(rep);
+  }
+}
+#endif /* OC_REP_ARENA */
@@ -212,40 +212,46 @@ wes_device_callbacks_s g_rsc_cbks[] = {
 };
 
 
-void garage_door_opening_callback() {
-    LOG(" garage_door_opening_callback\n");
-    g_openlevel_openLevel=2;
+/* The door callbacks run on the thread that watches the door sensors, so the
+   new open level is handed to the event loop, which updates the resource and
+   notifies its observers. */
+static void notify_openlevel(void *data) {
+    g_openlevel_openLevel = (int)(intptr_t)data;
     int result = oc_notify_observers(oc_ri_get_app_resource_by_uri(g_openlevel_RESOURCE_ENDPOINT, strlen(g_openlevel_RESOURCE_ENDPOINT), 0));
     char buffer[80];
-    sprintf(buffer, "\n oc_notify_observers result is %d \n", result);    
-    LOG(buffer);  
+    sprintf(buffer, "\n oc_notify_observers result is %d \n", result);
+    LOG(buffer);
+}
+
+/* Work is refused while the stack is not running, or in static builds while
+   too much of it is pending; the level is then only reported by the next
+   callback. */
+static void submit_openlevel(int level) {
+    if (!oc_submit_work(notify_openlevel, (void *)(intptr_t)level)) {
+        char buffer[80];
+        sprintf(buffer, " oc_submit_work failed, open level %d not notified\n", level);
+        LOG(buffer);
+    }
+}
+
+void garage_door_opening_callback() {
+    LOG(" garage_door_opening_callback\n");
+    submit_openlevel(2);
 }
 
 void garage_door_closing_callback() {
     LOG(" garage_door_closing_callback\n");
-    g_openlevel_openLevel = 98;
-    int result = oc_notify_observers(oc_ri_get_app_resource_by_uri(g_openlevel_RESOURCE_ENDPOINT, strlen(g_openlevel_RESOURCE_ENDPOINT), 0));
-    char buffer[80];
-    sprintf(buffer, "\n oc_notify_observers result is %d \n", result);  
-    LOG(buffer);
+    submit_openlevel(98);
 }
 
 void garage_door_open_callback() {
     LOG(" garage_door_open_callback\n");
-    g_openlevel_openLevel = 100;
-    int result = oc_notify_observers(oc_ri_get_app_resource_by_uri(g_openlevel_RESOURCE_ENDPOINT, strlen(g_openlevel_RESOURCE_ENDPOINT), 0));
-    char buffer[80];
-    sprintf(buffer, "\n oc_notify_observers result is %d \n", result);  
-    LOG(buffer);
+    submit_openlevel(100);
 }
 
 void garage_door_closed_callback() {
     LOG(" garage_door_closed_callback\n");
-    g_openlevel_openLevel = 0;
-    int result = oc_notify_observers(oc_ri_get_app_resource_by_uri(g_openlevel_RESOURCE_ENDPOINT, strlen(g_openlevel_RESOURCE_ENDPOINT), 0));
-    char buffer[80];
-    sprintf(buffer, "\n oc_notify_observers result is %d \n", result);  
-    LOG(buffer);
+    submit_openlevel(0);
 }
 
 static void timestamp(char * output)
@@ -1904,6 +1904,31 @@ void oc_set_delayed_callback(void *cb_data, oc_trigger_t callback,
  */
 void oc_remove_delayed_callback(void *cb_data, oc_trigger_t callback);
 
+/**
+ * Callback invoked on the event loop for work submitted with oc_submit_work()
+ *
+ * @param[in] data the user defined context pointer passed to oc_submit_work()
+ */
+typedef void (*oc_work_handler_t)(void *data);
+
+/**
+ * Run a handler on the event loop, from any thread.
+ *
+ * The handler is queued and the event loop is woken up. It then runs on the
+ * event loop in the order in which the work was submitted, where it may call
+ * any API of the stack, e.g. oc_notify_observers(), without the application
+ * having to serialize its threads with oc_main_poll(). Work that is still
+ * pending when the stack shuts down is dropped without being run.
+ *
+ * @param[in] handler the handler to run on the event loop
+ * @param[in] data user defined context pointer that is passed to the handler
+ *
+ * @return true if the work was queued, false if the stack is not running,
+ *         or, without OC_DYNAMIC_ALLOCATION, if OC_MAX_NUM_WORK_ITEMS work
+ *         items are already pending
+ */
+bool oc_submit_work(oc_work_handler_t handler, void *data);
+
 /** API for setting handlers for interrupts */
 
 #define oc_signal_interrupt_handler(name)                                      \
@@ -38,6 +38,7 @@ typedef enum {
 typedef struct oc_blockwise_state_s
 {
   struct oc_blockwise_state_s *next;
+  struct oc_blockwise_state_s *prev;
   oc_string_t href;
   oc_endpoint_t endpoint;
   oc_method_t method;
@@ -117,6 +118,9 @@ const void *oc_blockwise_dispatch_block(oc_blockwise_state_t *buffer,
                                         uint32_t requested_block_size,
                                         uint32_t *payload_size);
 
+/* Makes room for at least size bytes of payload in the buffer. */
+bool oc_blockwise_reserve_buffer(oc_blockwise_state_t *buffer, size_t size);
+
 bool oc_blockwise_handle_block(oc_blockwise_state_t *buffer,
                                uint32_t incoming_block_offset,
                                const uint8_t *incoming_block,
@@ -23,6 +23,7 @@
 #include "util/oc_memb.h"
 #include "util/oc_process.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -31,15 +32,74 @@ extern "C"
 
 OC_PROCESS_NAME(message_buffer_handler);
 oc_message_t *oc_allocate_message(void);
+/* cb is invoked whenever a message returned by oc_allocate_message() is
+ * released, so that receivers which ran out of buffers may resume reading.
+ * The Linux port installs its own callback for this purpose.
+ */
 void oc_set_buffers_avail_cb(oc_memb_buffers_avail_callback_t cb);
 
 oc_message_t *oc_allocate_message_from_pool(struct oc_memb *pool);
 
 oc_message_t *oc_internal_allocate_outgoing_message(void);
 
+#ifdef OC_DYNAMIC_ALLOCATION
+#ifndef OC_MESSAGE_BUFFER_CACHE_SIZE
+/* High-water mark of released messages each buffer pool keeps, together
+ * with their payload buffer, for reuse. Rounded up to a power of two with
+ * OC_LOCKFREE_NETWORK_EVENTS.
+ */
+#define OC_MESSAGE_BUFFER_CACHE_SIZE (8)
+#endif /* !OC_MESSAGE_BUFFER_CACHE_SIZE */
+
+typedef struct
+{
+  size_t recycled;  /* allocations served from the cache */
+  size_t allocated; /* allocations that went to the heap */
+  size_t cached;    /* messages currently held by the cache */
+} oc_message_buffer_stats_t;
+
+void oc_get_message_buffer_stats(oc_message_buffer_stats_t *incoming,
+                                 oc_message_buffer_stats_t *outgoing);
+
+#ifndef OC_BUFFER_FREE_LIST_SIZE
+/* Number of released payload buffers kept per size class for reuse. */
+#define OC_BUFFER_FREE_LIST_SIZE (8)
+#endif /* !OC_BUFFER_FREE_LIST_SIZE */
+
+/* Size-classed payload buffers. A buffer is at least as large as requested;
+ * oc_buffer_capacity() reports how much of it may be used. grow and shrink
+ * preserve the leading contents and return the buffer to use from then on;
+ * shrink moves the first size bytes into the smallest class that fits them.
+ */
+void *oc_buffer_alloc(size_t size);
+void *oc_buffer_grow(void *ptr, size_t size);
+void *oc_buffer_shrink(void *ptr, size_t size);
+void oc_buffer_free(void *ptr);
+size_t oc_buffer_capacity(const void *ptr);
+#endif /* OC_DYNAMIC_ALLOCATION */
+
 void oc_message_add_ref(oc_message_t *message);
 void oc_message_unref(oc_message_t *message);
 
+/* Reasons for which a message was discarded. Receivers that run out of
+ * buffers leave UDP datagrams queued in the socket, where overflows are
+ * dropped by the kernel, so OC_MESSAGE_DROP_NO_BUFFER only counts TCP frames.
+ */
+typedef enum {
+  OC_MESSAGE_DROP_NO_BUFFER = 0,       /* no buffer to receive it into */
+  OC_MESSAGE_DROP_INBOUND_QUEUE_FULL,  /* the event loop could not take it */
+  OC_MESSAGE_DROP_OUTBOUND_QUEUE_FULL, /* could not be queued for sending */
+  OC_MESSAGE_DROP_NOT_RUNNING,         /* arrived while the stack was down */
+  OC_MESSAGE_DROP_NUM_REASONS
+} oc_message_drop_reason_t;
+
+void oc_message_count_drop(oc_message_drop_reason_t reason);
+uint32_t oc_get_message_drop_count(oc_message_drop_reason_t reason);
+
+/* Posts a received message to the event loop. Returns false, leaving the
+ * message with the caller, if the event queue is full.
+ */
+bool oc_try_recv_message(oc_message_t *message);
 void oc_recv_message(oc_message_t *message);
 void oc_send_message(oc_message_t *message);
 void oc_close_all_tls_sessions_for_device(size_t device);
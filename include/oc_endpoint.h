@@ -86,6 +86,15 @@ oc_endpoint_t *oc_new_endpoint(void);
 void oc_free_endpoint(oc_endpoint_t *endpoint);
 void oc_endpoint_set_di(oc_endpoint_t *endpoint, oc_uuid_t *di);
 int oc_endpoint_to_string(oc_endpoint_t *endpoint, oc_string_t *endpoint_str);
+/* Size of a buffer that holds the string of any endpoint: the longest
+ * scheme, an IPv6 address in brackets and a port */
+#define OC_ENDPOINT_STRING_SIZE (67)
+/* Renders the "ep" string of an endpoint through a small cache keyed by
+ * scheme, address and port, so repeated lookups skip the formatting. The
+ * string is copied into buffer, which holds OC_ENDPOINT_STRING_SIZE bytes.
+ * Returns -1 if the endpoint has no address to render.
+ */
+int oc_endpoint_to_cached_string(const oc_endpoint_t *endpoint, char *buffer);
 int oc_string_to_endpoint(oc_string_t *endpoint_str, oc_endpoint_t *endpoint,
                           oc_string_t *uri);
 int oc_endpoint_string_parse_path(oc_string_t *endpoint_str, oc_string_t *path);
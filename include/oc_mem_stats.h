@@ -0,0 +1,93 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+/**
+ * @file
+ * @brief usage counters of the stack's memory pools
+ *
+ * Build with OC_MEMORY_STATS to have every pool declared with OC_MEMB() and
+ * each of the oc_mmem byte, int and double pools count its usage. Unlike
+ * OC_MEMORY_TRACE no record is kept per allocation, so the counters may be
+ * left enabled in production builds and read back to size the OC_MAX_*
+ * limits of a device from field data.
+ *
+ * Counters are updated without synchronization by whichever thread uses a
+ * pool, so values read while the stack is running are approximate.
+ */
+#ifndef OC_MEM_STATS_H
+#define OC_MEM_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct oc_mem_pool_stats_t
+{
+  const char *name;
+  size_t unit_size; /**< bytes per block or element */
+  size_t capacity;  /**< units in the pool, 0 if bounded only by the heap */
+  size_t in_use;    /**< units currently allocated */
+  size_t peak;      /**< highest in_use since start or the last reset */
+  uint32_t allocs;  /**< successful allocations; sample it for the rate */
+  uint32_t failures; /**< allocations refused as the pool was exhausted */
+} oc_mem_pool_stats_t;
+
+/**
+ * @brief callback invoked with the counters of one pool
+ *
+ * @param stats counters of the pool, only valid during the call
+ * @param user_data as passed to oc_mem_stats_iterate()
+ */
+typedef void (*oc_mem_stats_cb_t)(const oc_mem_pool_stats_t *stats,
+                                  void *user_data);
+
+/**
+ * @brief report the counters of every pool
+ *
+ * The oc_mmem pools come first, followed by the OC_MEMB() pools that have
+ * been allocated from at least once.
+ *
+ * @param cb invoked once per pool
+ * @param user_data passed through to cb
+ */
+void oc_mem_stats_iterate(oc_mem_stats_cb_t cb, void *user_data);
+
+/**
+ * @brief restart peak tracking at the current usage of each pool
+ */
+void oc_mem_stats_reset_peaks(void);
+
+#ifdef OC_SERVER
+/**
+ * @brief expose the counters as a read-only resource
+ *
+ * Adds the vendor resource "/oc/memstats" of type "x.org.iotivity.memstats"
+ * to the device, which reports one object per pool in its "pools" array.
+ * Call it from the register_resources handler.
+ *
+ * @param device index of the device to add the resource to
+ * @return true if the resource was added
+ */
+bool oc_mem_stats_add_resource(size_t device);
+#endif /* OC_SERVER */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_MEM_STATS_H */
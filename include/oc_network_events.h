@@ -21,6 +21,7 @@
 
 #include "port/oc_network_events_mutex.h"
 #include "util/oc_process.h"
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -54,6 +55,14 @@ typedef struct oc_message_s oc_message_t;
 
 void oc_network_event(oc_message_t *message);
 
+/**
+  @brief Hands a batch of received messages to the stack under a single
+    acquisition of the network event handler mutex.
+  @param messages  array of received messages, ownership is transferred.
+  @param num_messages  number of entries in messages.
+*/
+void oc_network_event_batch(oc_message_t **messages, size_t num_messages);
+
 void oc_network_interface_event(oc_interface_event_t event);
 
 #ifdef __cplusplus
@@ -958,6 +958,15 @@ typedef struct oc_rep_s
 
 void oc_rep_set_pool(struct oc_memb *rep_objects_pool);
 
+#ifdef OC_REP_ARENA
+/* Parse into a per-payload arena until oc_rep_end_arena() or the next
+ * oc_rep_set_pool(). oc_rep_end_arena() releases the parsed tree and the
+ * arena in one step.
+ */
+void oc_rep_begin_arena(void);
+void oc_rep_end_arena(oc_rep_t *rep);
+#endif /* OC_REP_ARENA */
+
 int oc_parse_rep(const uint8_t *payload, int payload_size,
                  oc_rep_t **value_list);
 
@@ -236,9 +236,11 @@ typedef oc_event_callback_retval_t (*oc_trigger_t)(void *);
 typedef struct oc_event_callback_s
 {
   struct oc_event_callback_s *next;
+  struct oc_event_callback_s *prev;
   struct oc_etimer timer;
   oc_trigger_t callback;
   void *data;
+  struct oc_event_callback_s *bucket_next; /* next in the lookup index */
 } oc_event_callback_t;
 
 void oc_ri_init(void);
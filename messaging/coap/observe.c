@@ -363,6 +363,11 @@ coap_notify_collection_observers(oc_resource_t *resource,
       if (!response_state) {
         goto leave_notify_collections;
       }
+      if (!oc_blockwise_reserve_buffer(response_state,
+                                       response_buf->response_length)) {
+        oc_blockwise_free_response_buffer(response_state);
+        goto leave_notify_collections;
+      }
 
       if (query) {
         oc_new_string(&response_state->uri_query, query, strlen(query));
@@ -783,6 +788,11 @@ coap_notify_observers(oc_resource_t *resource,
             if (!response_state) {
               goto leave_notify_observers;
             }
+            if (!oc_blockwise_reserve_buffer(response_state,
+                                             response_buf->response_length)) {
+              oc_blockwise_free_response_buffer(response_state);
+              goto leave_notify_observers;
+            }
             memcpy(response_state->buffer, response_buf->buffer,
                    response_buf->response_length);
             response_state->payload_size = response_buf->response_length;
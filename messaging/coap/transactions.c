@@ -67,7 +67,7 @@
 
 /*---------------------------------------------------------------------------*/
 OC_MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
-OC_LIST(transactions_list);
+OC_DLIST(transactions_list);
 
 static struct oc_process *transaction_handler_process = NULL;
 
@@ -94,9 +94,7 @@ coap_new_transaction(uint16_t mid, oc_endpoint_t *endpoint)
       /* save client address */
       memcpy(&t->message->endpoint, endpoint, sizeof(oc_endpoint_t));
 
-      oc_list_add(
-        transactions_list,
-        t); /* list itself makes sure same element is not added twice */
+      oc_dlist_add(transactions_list, t);
     } else {
       oc_memb_free(&transactions_memb, t);
       t = NULL;
@@ -136,6 +134,11 @@ coap_send_transaction(coap_transaction_t *t)
       OC_DBG("Keeping transaction %u: %p", t->mid, (void *)t);
 
       if (t->retrans_counter == 0) {
+#ifdef OC_DYNAMIC_ALLOCATION
+        /* The message is held until acknowledged; drop its unused tail */
+        t->message->data =
+          (uint8_t *)oc_buffer_shrink(t->message->data, t->message->length);
+#endif /* OC_DYNAMIC_ALLOCATION */
         t->retrans_timer.timer.interval =
           COAP_RESPONSE_TIMEOUT_TICKS +
           (oc_random_value() %
@@ -196,7 +199,7 @@ coap_clear_transaction(coap_transaction_t *t)
 
     oc_etimer_stop(&t->retrans_timer);
     oc_message_unref(t->message);
-    oc_list_remove(transactions_list, t);
+    oc_dlist_remove(transactions_list, t);
     oc_memb_free(&transactions_memb, t);
   }
 }
@@ -205,7 +208,7 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
-  for (t = (coap_transaction_t *)oc_list_head(transactions_list); t;
+  for (t = (coap_transaction_t *)oc_dlist_head(transactions_list); t;
        t = t->next) {
     if (t->mid == mid) {
       OC_DBG("Found transaction for MID %u: %p", t->mid, (void *)t);
@@ -219,17 +222,18 @@ coap_get_transaction_by_mid(uint16_t mid)
 void
 coap_check_transactions(void)
 {
-  coap_transaction_t *t = (coap_transaction_t *)oc_list_head(transactions_list),
+  coap_transaction_t *t =
+                       (coap_transaction_t *)oc_dlist_head(transactions_list),
                      *next;
   while (t != NULL) {
     next = t->next;
     if (oc_etimer_expired(&t->retrans_timer)) {
       ++(t->retrans_counter);
       OC_DBG("Retransmitting %u (%u)", t->mid, t->retrans_counter);
-      int removed = oc_list_length(transactions_list);
+      int removed = oc_dlist_length(transactions_list);
       coap_send_transaction(t);
-      if ((removed - oc_list_length(transactions_list)) > 1) {
-        t = (coap_transaction_t *)oc_list_head(transactions_list);
+      if ((removed - oc_dlist_length(transactions_list)) > 1) {
+        t = (coap_transaction_t *)oc_dlist_head(transactions_list);
         continue;
       }
     }
@@ -240,7 +244,8 @@ coap_check_transactions(void)
 void
 coap_free_all_transactions(void)
 {
-  coap_transaction_t *t = (coap_transaction_t *)oc_list_head(transactions_list),
+  coap_transaction_t *t =
+                       (coap_transaction_t *)oc_dlist_head(transactions_list),
                      *next;
   while (t != NULL) {
     next = t->next;
@@ -252,18 +257,19 @@ coap_free_all_transactions(void)
 void
 coap_free_transactions_by_endpoint(oc_endpoint_t *endpoint)
 {
-  coap_transaction_t *t = (coap_transaction_t *)oc_list_head(transactions_list),
+  coap_transaction_t *t =
+                       (coap_transaction_t *)oc_dlist_head(transactions_list),
                      *next;
   while (t != NULL) {
     next = t->next;
     if (oc_endpoint_compare(&t->message->endpoint, endpoint) == 0) {
-      int removed = oc_list_length(transactions_list);
+      int removed = oc_dlist_length(transactions_list);
 #ifdef OC_CLIENT
       /* Remove the client callback tied to this transaction */
       oc_ri_free_client_cbs_by_mid(t->mid);
 #endif /* OC_CLIENT */
-      if ((removed - oc_list_length(transactions_list)) > 0) {
-        t = (coap_transaction_t *)oc_list_head(transactions_list);
+      if ((removed - oc_dlist_length(transactions_list)) > 0) {
+        t = (coap_transaction_t *)oc_dlist_head(transactions_list);
         continue;
       }
       coap_clear_transaction(t);
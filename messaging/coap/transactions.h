@@ -73,6 +73,7 @@ extern "C"
 typedef struct coap_transaction
 {
   struct coap_transaction *next; /* for LIST */
+  struct coap_transaction *prev;
 
   uint16_t mid;
   struct oc_etimer retrans_timer;
@@ -16,26 +16,46 @@
 
 #include "port/oc_clock.h"
 #include "port/oc_log.h"
-#include <math.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifdef OC_CLOCK_MONOTONIC_COARSE
+#define OC_CLOCK_MONOTONIC_ID CLOCK_MONOTONIC_COARSE
+#else /* OC_CLOCK_MONOTONIC_COARSE */
+#define OC_CLOCK_MONOTONIC_ID CLOCK_MONOTONIC
+#endif /* !OC_CLOCK_MONOTONIC_COARSE */
+
 void
 oc_clock_init(void)
 {
 }
 
-oc_clock_time_t
-oc_clock_time(void)
+static oc_clock_time_t
+clock_ticks(clockid_t clock_id)
 {
-  oc_clock_time_t time = 0;
   struct timespec t;
-  if (clock_gettime(CLOCK_REALTIME, &t) != -1) {
-    time = (oc_clock_time_t)t.tv_sec * OC_CLOCK_SECOND +
-           (oc_clock_time_t)ceil(t.tv_nsec / (1.e09 / OC_CLOCK_SECOND));
+  if (clock_gettime(clock_id, &t) == -1) {
+    return 0;
   }
-  return time;
+  /* Round the nanoseconds up to the next tick */
+  return (oc_clock_time_t)t.tv_sec * OC_CLOCK_SECOND +
+         ((oc_clock_time_t)t.tv_nsec * OC_CLOCK_SECOND + 999999999) /
+           1000000000;
+}
+
+oc_clock_time_t
+oc_clock_time(void)
+{
+  return clock_ticks(CLOCK_REALTIME);
+}
+
+#ifdef OC_CLOCK_MONOTONIC
+oc_clock_time_t
+oc_clock_time_monotonic(void)
+{
+  return clock_ticks(OC_CLOCK_MONOTONIC_ID);
 }
+#endif /* OC_CLOCK_MONOTONIC */
 
 unsigned long
 oc_clock_seconds(void)
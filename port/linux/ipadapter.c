@@ -16,6 +16,9 @@
 
 #define _GNU_SOURCE
 #include "ipcontext.h"
+#ifdef OC_IO_URING
+#include "uringadapter.h"
+#endif /* OC_IO_URING */
 #ifdef OC_TCP
 #include "tcpadapter.h"
 #endif
@@ -33,11 +36,16 @@
 #include <linux/rtnetlink.h>
 #include <net/if.h>
 #include <netdb.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef OC_EPOLL
+#include <sys/epoll.h>
+#else /* OC_EPOLL */
 #include <sys/select.h>
+#endif /* !OC_EPOLL */
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -59,6 +67,32 @@ static const uint8_t ALL_OCF_NODES_SL[] = {
 };
 #define ALL_COAP_NODES_V4 0xe00001bb
 
+#ifdef OC_EPOLL
+/* Maximum number of ready descriptors returned by a single epoll_wait() */
+#define OC_EPOLL_MAX_EVENTS (16)
+#endif /* OC_EPOLL */
+
+#ifdef OC_RECVMMSG
+#ifndef OC_RECVMMSG_BATCH_SIZE
+/* Maximum number of datagrams drained by a single recvmmsg() */
+#define OC_RECVMMSG_BATCH_SIZE (8)
+#endif /* !OC_RECVMMSG_BATCH_SIZE */
+
+/* Receive state of one network event thread. The messages[] slots are
+ * allocated ahead of the next recvmmsg() call so datagrams land directly in
+ * oc_message_t buffers, and only the consumed slots are refilled.
+ */
+typedef struct udp_recv_ring_t
+{
+  struct mmsghdr msgs[OC_RECVMMSG_BATCH_SIZE];
+  struct iovec iovecs[OC_RECVMMSG_BATCH_SIZE];
+  struct sockaddr_storage clients[OC_RECVMMSG_BATCH_SIZE];
+  char controls[OC_RECVMMSG_BATCH_SIZE]
+               [CMSG_LEN(sizeof(struct sockaddr_storage))];
+  oc_message_t *messages[OC_RECVMMSG_BATCH_SIZE];
+} udp_recv_ring_t;
+#endif /* OC_RECVMMSG */
+
 static pthread_mutex_t mutex;
 struct sockaddr_nl ifchange_nl;
 int ifchange_sock;
@@ -362,8 +396,136 @@ configure_mcast_socket(int mcast_sock, int sa_family)
 }
 
 static void
-get_interface_addresses(ip_context_t *dev, unsigned char family, uint16_t port,
-                        bool secure, bool tcp)
+add_endpoint(ip_context_t *dev, const oc_endpoint_t *ep, uint16_t port,
+             enum transport_flags flags)
+{
+  oc_endpoint_t *new_ep = oc_memb_alloc(&device_eps);
+  if (!new_ep) {
+    OC_WRN("no free endpoint for interface %d", ep->interface_index);
+    return;
+  }
+  memcpy(new_ep, ep, sizeof(oc_endpoint_t));
+  new_ep->flags |= flags;
+#ifdef OC_IPV4
+  if (ep->flags & IPV4) {
+    new_ep->addr.ipv4.port = port;
+  } else
+#endif /* OC_IPV4 */
+  {
+    new_ep->addr.ipv6.port = port;
+  }
+  oc_list_add(dev->eps, new_ep);
+}
+
+/* Adds the endpoints of every port of dev for one interface address */
+static void
+add_interface_endpoints(ip_context_t *dev, unsigned char family,
+                        const struct ifaddrmsg *addrmsg, const void *address)
+{
+  oc_endpoint_t ep;
+  memset(&ep, 0, sizeof(oc_endpoint_t));
+  ep.interface_index = addrmsg->ifa_index;
+
+#ifdef OC_IPV4
+  if (family == AF_INET) {
+    memcpy(ep.addr.ipv4.address, address, 4);
+    ep.flags = IPV4;
+    add_endpoint(dev, &ep, dev->port4, 0);
+#ifdef OC_SECURITY
+    add_endpoint(dev, &ep, dev->dtls4_port, SECURED);
+#endif /* OC_SECURITY */
+#ifdef OC_TCP
+    add_endpoint(dev, &ep, dev->tcp.port4, TCP);
+#ifdef OC_SECURITY
+    add_endpoint(dev, &ep, dev->tcp.tls4_port, SECURED | TCP);
+#endif /* OC_SECURITY */
+#endif /* OC_TCP */
+    return;
+  }
+#endif /* OC_IPV4 */
+  if (family == AF_INET6) {
+    memcpy(ep.addr.ipv6.address, address, 16);
+    ep.flags = IPV6;
+    if (addrmsg->ifa_scope == RT_SCOPE_LINK) {
+      ep.addr.ipv6.scope = addrmsg->ifa_index;
+    }
+    add_endpoint(dev, &ep, dev->port, 0);
+#ifdef OC_SECURITY
+    add_endpoint(dev, &ep, dev->dtls_port, SECURED);
+#endif /* OC_SECURITY */
+#ifdef OC_TCP
+    add_endpoint(dev, &ep, dev->tcp.port, TCP);
+#ifdef OC_SECURITY
+    add_endpoint(dev, &ep, dev->tcp.tls_port, SECURED | TCP);
+#endif /* OC_SECURITY */
+#endif /* OC_TCP */
+  }
+}
+
+static bool
+has_interface_endpoints(ip_context_t *dev, unsigned char family,
+                        int interface_index)
+{
+  enum transport_flags flag = (family == AF_INET6) ? IPV6 : IPV4;
+  oc_endpoint_t *ep = oc_list_head(dev->eps);
+  while (ep != NULL) {
+    if (ep->interface_index == interface_index && (ep->flags & flag)) {
+      return true;
+    }
+    ep = ep->next;
+  }
+  return false;
+}
+
+static bool
+has_endpoint_address(ip_context_t *dev, unsigned char family,
+                     const void *address)
+{
+  oc_endpoint_t *ep = oc_list_head(dev->eps);
+  while (ep != NULL) {
+#ifdef OC_IPV4
+    if (family == AF_INET && (ep->flags & IPV4) &&
+        memcmp(ep->addr.ipv4.address, address, 4) == 0) {
+      return true;
+    }
+#endif /* OC_IPV4 */
+    if (family == AF_INET6 && (ep->flags & IPV6) &&
+        memcmp(ep->addr.ipv6.address, address, 16) == 0) {
+      return true;
+    }
+    ep = ep->next;
+  }
+  return false;
+}
+
+/* Returns the address of an interface address message that endpoints are
+ * published for, or NULL for host scope and temporary addresses.
+ */
+static const void *
+get_endpoint_address(struct nlmsghdr *nlmsg)
+{
+  struct ifaddrmsg *addrmsg = (struct ifaddrmsg *)NLMSG_DATA(nlmsg);
+  const void *address = NULL;
+  if (addrmsg->ifa_scope >= RT_SCOPE_HOST) {
+    return NULL;
+  }
+  struct rtattr *attr = (struct rtattr *)IFA_RTA(addrmsg);
+  int att_len = IFA_PAYLOAD(nlmsg);
+  while (RTA_OK(attr, att_len)) {
+    if (attr->rta_type == IFA_ADDRESS) {
+      address = RTA_DATA(attr);
+    } else if (attr->rta_type == IFA_FLAGS) {
+      if (*(uint32_t *)(RTA_DATA(attr)) & IFA_F_TEMPORARY) {
+        return NULL;
+      }
+    }
+    attr = RTA_NEXT(attr, att_len);
+  }
+  return address;
+}
+
+static void
+get_interface_addresses(ip_context_t *dev, unsigned char family)
 {
   struct
   {
@@ -397,7 +559,6 @@ get_interface_addresses(ip_context_t *dev, unsigned char family, uint16_t port,
     return;
   }
 
-  int prev_interface_index = -1;
   bool done = false;
   while (!done) {
     int guess = 512, response_len;
@@ -429,71 +590,13 @@ get_interface_addresses(ip_context_t *dev, unsigned char family, uint16_t port,
         done = true;
         break;
       }
-      oc_endpoint_t ep;
-      memset(&ep, 0, sizeof(oc_endpoint_t));
-      bool include = false;
       struct ifaddrmsg *addrmsg = (struct ifaddrmsg *)NLMSG_DATA(response);
-      if (addrmsg->ifa_scope < RT_SCOPE_HOST) {
-        if ((int)addrmsg->ifa_index == prev_interface_index) {
-          goto next_ifaddr;
-        }
-        ep.interface_index = addrmsg->ifa_index;
-        include = true;
-        struct rtattr *attr = (struct rtattr *)IFA_RTA(addrmsg);
-        int att_len = IFA_PAYLOAD(response);
-        while (RTA_OK(attr, att_len)) {
-          if (attr->rta_type == IFA_ADDRESS) {
-#ifdef OC_IPV4
-            if (family == AF_INET) {
-              memcpy(ep.addr.ipv4.address, RTA_DATA(attr), 4);
-              ep.flags = IPV4;
-            } else
-#endif /* OC_IPV4 */
-              if (family == AF_INET6) {
-              memcpy(ep.addr.ipv6.address, RTA_DATA(attr), 16);
-              ep.flags = IPV6;
-            }
-          } else if (attr->rta_type == IFA_FLAGS) {
-            if (*(uint32_t *)(RTA_DATA(attr)) & IFA_F_TEMPORARY) {
-              include = false;
-            }
-          }
-          attr = RTA_NEXT(attr, att_len);
-        }
+      const void *address = get_endpoint_address(response);
+      /* One address per interface and family is published */
+      if (address &&
+          !has_interface_endpoints(dev, family, addrmsg->ifa_index)) {
+        add_interface_endpoints(dev, family, addrmsg, address);
       }
-      if (include) {
-        prev_interface_index = addrmsg->ifa_index;
-        if (addrmsg->ifa_scope == RT_SCOPE_LINK && family == AF_INET6) {
-          ep.addr.ipv6.scope = addrmsg->ifa_index;
-        }
-        if (secure) {
-          ep.flags |= SECURED;
-        }
-#ifdef OC_IPV4
-        if (family == AF_INET) {
-          ep.addr.ipv4.port = port;
-        } else
-#endif /* OC_IPV4 */
-          if (family == AF_INET6) {
-          ep.addr.ipv6.port = port;
-        }
-#ifdef OC_TCP
-        if (tcp) {
-          ep.flags |= TCP;
-        }
-#else
-        (void)tcp;
-#endif /* OC_TCP */
-        oc_endpoint_t *new_ep = oc_memb_alloc(&device_eps);
-        if (!new_ep) {
-          close(nl_sock);
-          return;
-        }
-        memcpy(new_ep, &ep, sizeof(oc_endpoint_t));
-        oc_list_add(dev->eps, new_ep);
-      }
-
-    next_ifaddr:
       response = NLMSG_NEXT(response, response_len);
     }
   }
@@ -516,29 +619,45 @@ refresh_endpoints_list(ip_context_t *dev)
 {
   free_endpoints_list(dev);
 
-  get_interface_addresses(dev, AF_INET6, dev->port, false, false);
-#ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET6, dev->dtls_port, true, false);
-#endif /* OC_SECURITY */
+  get_interface_addresses(dev, AF_INET6);
 #ifdef OC_IPV4
-  get_interface_addresses(dev, AF_INET, dev->port4, false, false);
-#ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET, dev->dtls4_port, true, false);
-#endif /* OC_SECURITY */
+  get_interface_addresses(dev, AF_INET);
 #endif /* OC_IPV4 */
+  dev->eps_loaded = true;
+}
 
-#ifdef OC_TCP
-  get_interface_addresses(dev, AF_INET6, dev->tcp.port, false, true);
-#ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET6, dev->tcp.tls_port, true, true);
-#endif /* OC_SECURITY */
+/* Applies an RTM_NEWADDR or RTM_DELADDR message to the endpoint list of dev.
+ * A new address only adds endpoints if its interface has none yet for that
+ * family. Removing a published address rebuilds the list, as another address
+ * of the interface may take its place.
+ */
+static void
+update_endpoints_list(ip_context_t *dev, struct nlmsghdr *nlmsg)
+{
+  struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(nlmsg);
+  unsigned char family = ifa->ifa_family;
 #ifdef OC_IPV4
-  get_interface_addresses(dev, AF_INET, dev->tcp.port4, false, true);
-#ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET, dev->tcp.tls4_port, true, true);
-#endif /* OC_SECURITY */
-#endif /* OC_IPV4 */
-#endif /* OC_TCP */
+  if (family != AF_INET6 && family != AF_INET) {
+#else  /* OC_IPV4 */
+  if (family != AF_INET6) {
+#endif /* !OC_IPV4 */
+    return;
+  }
+  if (!dev->eps_loaded) {
+    return;
+  }
+
+  if (nlmsg->nlmsg_type == RTM_NEWADDR) {
+    const void *address = get_endpoint_address(nlmsg);
+    if (address && !has_interface_endpoints(dev, family, ifa->ifa_index)) {
+      add_interface_endpoints(dev, family, ifa, address);
+    }
+  } else {
+    const void *address = get_endpoint_address(nlmsg);
+    if (address && has_endpoint_address(dev, family, address)) {
+      refresh_endpoints_list(dev);
+    }
+  }
 }
 
 oc_endpoint_t *
@@ -550,7 +669,7 @@ oc_connectivity_get_endpoints(size_t device)
     return NULL;
   }
 
-  if (oc_list_length(dev->eps) == 0) {
+  if (!dev->eps_loaded) {
     oc_network_event_handler_mutex_lock();
     refresh_endpoints_list(dev);
     oc_network_event_handler_mutex_unlock();
@@ -593,8 +712,6 @@ process_interface_change_event(void)
     return -1;
   }
 
-  bool if_state_changed = false;
-
   while (NLMSG_OK(response, response_len)) {
     if (response->nlmsg_type == RTM_NEWADDR) {
       struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(response);
@@ -629,7 +746,12 @@ process_interface_change_event(void)
           attr = RTA_NEXT(attr, att_len);
         }
       }
-      if_state_changed = true;
+      for (i = 0; i < num_devices; i++) {
+        ip_context_t *dev = get_ip_context_for_device(i);
+        oc_network_event_handler_mutex_lock();
+        update_endpoints_list(dev, response);
+        oc_network_event_handler_mutex_unlock();
+      }
     } else if (response->nlmsg_type == RTM_DELADDR) {
       struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(response);
       if (ifa) {
@@ -639,62 +761,37 @@ process_interface_change_event(void)
         }
 #endif /* OC_NETWORK_MONITOR */
       }
-      if_state_changed = true;
+      for (i = 0; i < num_devices; i++) {
+        ip_context_t *dev = get_ip_context_for_device(i);
+        oc_network_event_handler_mutex_lock();
+        update_endpoints_list(dev, response);
+        oc_network_event_handler_mutex_unlock();
+      }
     }
     response = NLMSG_NEXT(response, response_len);
   }
 
-  if (if_state_changed) {
-    for (i = 0; i < num_devices; i++) {
-      ip_context_t *dev = get_ip_context_for_device(i);
-      oc_network_event_handler_mutex_lock();
-      refresh_endpoints_list(dev);
-      oc_network_event_handler_mutex_unlock();
-    }
-  }
-
   return ret;
 }
 
-static int
-recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
-         oc_endpoint_t *endpoint, bool multicast)
+int
+oc_ip_get_endpoint_from_msghdr(struct msghdr *msg, oc_endpoint_t *endpoint,
+                               bool multicast)
 {
-  struct sockaddr_storage client;
-  struct iovec iovec[1];
-  struct msghdr msg;
-  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
-
-  iovec[0].iov_base = recv_buf;
-  iovec[0].iov_len = (size_t)recv_buf_size;
-
-  msg.msg_name = &client;
-  msg.msg_namelen = sizeof(client);
-
-  msg.msg_iov = iovec;
-  msg.msg_iovlen = 1;
-
-  msg.msg_control = msg_control;
-  msg.msg_controllen = sizeof(msg_control);
-
-  msg.msg_flags = 0;
-
-  int ret = recvmsg(sock, &msg, 0);
-
-  if (ret < 0 || (msg.msg_flags & MSG_TRUNC) || (msg.msg_flags & MSG_CTRUNC)) {
-    OC_ERR("recvmsg returned with an error: %d", errno);
+  if ((msg->msg_flags & MSG_TRUNC) || (msg->msg_flags & MSG_CTRUNC)) {
+    OC_ERR("received truncated datagram");
     return -1;
   }
 
   struct cmsghdr *cmsg;
-  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != 0; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg != 0; cmsg = CMSG_NXTHDR(msg, cmsg)) {
     if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
-      if (msg.msg_namelen != sizeof(struct sockaddr_in6)) {
+      if (msg->msg_namelen != sizeof(struct sockaddr_in6)) {
         OC_ERR("anciliary data contains invalid source address");
         return -1;
       }
       /* Set source address of packet in endpoint structure */
-      struct sockaddr_in6 *c6 = (struct sockaddr_in6 *)&client;
+      struct sockaddr_in6 *c6 = (struct sockaddr_in6 *)msg->msg_name;
       memcpy(endpoint->addr.ipv6.address, c6->sin6_addr.s6_addr,
              sizeof(c6->sin6_addr.s6_addr));
       endpoint->addr.ipv6.scope = c6->sin6_scope_id;
@@ -719,12 +816,12 @@ recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
     }
 #ifdef OC_IPV4
     else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_PKTINFO) {
-      if (msg.msg_namelen != sizeof(struct sockaddr_in)) {
+      if (msg->msg_namelen != sizeof(struct sockaddr_in)) {
         OC_ERR("anciliary data contains invalid source address");
         return -1;
       }
       struct in_pktinfo *pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
-      struct sockaddr_in *c4 = (struct sockaddr_in *)&client;
+      struct sockaddr_in *c4 = (struct sockaddr_in *)msg->msg_name;
       memcpy(endpoint->addr.ipv4.address, &c4->sin_addr.s_addr,
              sizeof(c4->sin_addr.s_addr));
       endpoint->addr.ipv4.port = ntohs(c4->sin_port);
@@ -739,9 +836,543 @@ recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
 #endif /* OC_IPV4 */
   }
 
+  return 0;
+}
+
+#if !defined(OC_EPOLL) ||                                                      \
+  (!defined(OC_RECVMMSG) && (!defined(OC_IO_URING) || defined(OC_REUSEPORT)))
+static int
+recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
+         oc_endpoint_t *endpoint, bool multicast, int flags)
+{
+  struct sockaddr_storage client;
+  struct iovec iovec[1];
+  struct msghdr msg;
+  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
+
+  iovec[0].iov_base = recv_buf;
+  iovec[0].iov_len = (size_t)recv_buf_size;
+
+  msg.msg_name = &client;
+  msg.msg_namelen = sizeof(client);
+
+  msg.msg_iov = iovec;
+  msg.msg_iovlen = 1;
+
+  msg.msg_control = msg_control;
+  msg.msg_controllen = sizeof(msg_control);
+
+  msg.msg_flags = 0;
+
+  int ret = recvmsg(sock, &msg, flags);
+
+  if (ret < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      OC_ERR("recvmsg returned with an error: %d", errno);
+    }
+    return -1;
+  }
+
+  if (oc_ip_get_endpoint_from_msghdr(&msg, endpoint, multicast) < 0) {
+    errno = EBADMSG;
+    return -1;
+  }
+
   return ret;
 }
+#endif /* recv_msg() users */
 
+/* A receiver that runs out of message buffers leaves further datagrams
+ * queued in its socket buffers, where the kernel drops what no longer fits,
+ * and sleeps until resume_receive() reports a released buffer rather than
+ * polling its sockets again.
+ */
+static void
+park_receive(bool *parked)
+{
+  __atomic_store_n(parked, true, __ATOMIC_SEQ_CST);
+  /* A buffer released before the flag was set went unnoticed, so check again;
+   * releasing it invokes resume_receive()
+   */
+  oc_message_t *message = oc_allocate_message();
+  if (message) {
+    oc_message_unref(message);
+  }
+}
+
+static bool
+unpark_receive(bool *parked)
+{
+  return __atomic_load_n(parked, __ATOMIC_ACQUIRE) &&
+         __atomic_exchange_n(parked, false, __ATOMIC_SEQ_CST);
+}
+
+/* Installed with oc_set_buffers_avail_cb(), so invoked on whichever thread
+ * released the buffer. num_free is 0 for pools only bounded by the heap.
+ */
+static void
+resume_receive(int num_free)
+{
+  (void)num_free;
+  ip_context_t *dev = (ip_context_t *)oc_list_head(ip_contexts);
+  for (; dev != NULL; dev = dev->next) {
+    if (unpark_receive(&dev->rx_parked) &&
+        write(dev->shutdown_pipe[1], "\n", 1) < 0) {
+      OC_WRN("cannot wakeup network thread");
+    }
+#ifdef OC_REUSEPORT
+    int i;
+    for (i = 0; i < OC_UDP_RECV_SHARDS; i++) {
+      if (unpark_receive(&dev->shards[i].rx_parked) &&
+          write(dev->shards[i].wake_pipe[1], "\n", 1) < 0) {
+        OC_WRN("cannot wakeup shard thread");
+      }
+    }
+#endif /* OC_REUSEPORT */
+  }
+}
+
+#ifdef OC_RECVMMSG
+static int
+fill_recv_ring(udp_recv_ring_t *ring)
+{
+  int i;
+  for (i = 0; i < OC_RECVMMSG_BATCH_SIZE; i++) {
+    if (!ring->messages[i]) {
+      ring->messages[i] = oc_allocate_message();
+      if (!ring->messages[i]) {
+        break;
+      }
+    }
+  }
+  return i;
+}
+
+static void
+release_recv_ring(udp_recv_ring_t *ring)
+{
+  int i;
+  for (i = 0; i < OC_RECVMMSG_BATCH_SIZE; i++) {
+    if (ring->messages[i]) {
+      oc_message_unref(ring->messages[i]);
+      ring->messages[i] = NULL;
+    }
+  }
+}
+
+/* Receives up to OC_RECVMMSG_BATCH_SIZE datagrams from sock with a single
+ * recvmmsg() and hands them to the stack in one oc_network_event_batch().
+ * Returns the number of datagrams read, or -1 with errno set to ENOBUFS when
+ * no receive buffers could be allocated.
+ */
+static int
+recv_batch(ip_context_t *dev, udp_recv_ring_t *ring, int sock,
+           enum transport_flags flags)
+{
+  int i, num = fill_recv_ring(ring);
+  if (num == 0) {
+    errno = ENOBUFS;
+    return -1;
+  }
+
+  for (i = 0; i < num; i++) {
+    ring->iovecs[i].iov_base = ring->messages[i]->data;
+    ring->iovecs[i].iov_len = OC_PDU_SIZE;
+
+    struct msghdr *msg = &ring->msgs[i].msg_hdr;
+    msg->msg_name = &ring->clients[i];
+    msg->msg_namelen = sizeof(struct sockaddr_storage);
+    msg->msg_iov = &ring->iovecs[i];
+    msg->msg_iovlen = 1;
+    msg->msg_control = ring->controls[i];
+    msg->msg_controllen = sizeof(ring->controls[i]);
+    msg->msg_flags = 0;
+  }
+
+  int count = recvmmsg(sock, ring->msgs, (unsigned int)num, MSG_DONTWAIT, NULL);
+  if (count < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      OC_ERR("recvmmsg returned with an error: %d", errno);
+    }
+  } else {
+    oc_message_t *batch[OC_RECVMMSG_BATCH_SIZE];
+    size_t num_batch = 0;
+    for (i = 0; i < count; i++) {
+      oc_message_t *message = ring->messages[i];
+      ring->messages[i] = NULL;
+
+      message->endpoint.device = dev->device;
+      if (oc_ip_get_endpoint_from_msghdr(&ring->msgs[i].msg_hdr,
+                                         &message->endpoint,
+                                         (flags & MULTICAST) != 0) < 0) {
+        oc_message_unref(message);
+        continue;
+      }
+      message->length = (size_t)ring->msgs[i].msg_len;
+      message->endpoint.flags = flags;
+#ifdef OC_SECURITY
+      if (flags & SECURED) {
+        message->encrypted = 1;
+      }
+#endif /* OC_SECURITY */
+
+#ifdef OC_DEBUG
+      PRINT("Incoming message of size %zd bytes from ", message->length);
+      PRINTipaddr(message->endpoint);
+      PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+      batch[num_batch++] = message;
+    }
+    oc_network_event_batch(batch, num_batch);
+  }
+
+#ifndef OC_DYNAMIC_ALLOCATION
+  /* Do not keep buffers of the static pool idle between batches */
+  release_recv_ring(ring);
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+  if (count < 0) {
+    return -1;
+  }
+  return count;
+}
+#endif /* OC_RECVMMSG */
+
+#ifdef OC_EPOLL
+int
+oc_ip_add_event_source(ip_context_t *dev, ip_event_source_t *source,
+                       ip_event_source_type_t type, int sock,
+                       enum transport_flags flags, uint32_t events)
+{
+  struct epoll_event event;
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = events;
+  event.data.ptr = source;
+
+  source->type = type;
+  source->sock = sock;
+  source->flags = flags;
+
+  if (epoll_ctl(dev->epoll_fd, EPOLL_CTL_ADD, sock, &event) == -1) {
+    OC_ERR("adding socket %d to epoll set %d", sock, errno);
+    return -1;
+  }
+  return 0;
+}
+
+void
+oc_ip_remove_event_source(ip_context_t *dev, ip_event_source_t *source)
+{
+  if (epoll_ctl(dev->epoll_fd, EPOLL_CTL_DEL, source->sock, NULL) == -1) {
+    OC_WRN("removing socket %d from epoll set %d", source->sock, errno);
+  }
+}
+
+void
+oc_ip_modify_event_source(ip_context_t *dev, ip_event_source_t *source,
+                          uint32_t events)
+{
+  struct epoll_event event;
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = events;
+  event.data.ptr = source;
+
+  if (epoll_ctl(dev->epoll_fd, EPOLL_CTL_MOD, source->sock, &event) == -1) {
+    OC_WRN("modifying socket %d in epoll set %d", source->sock, errno);
+  }
+}
+
+static int
+add_udp_sock_to_epoll(ip_context_t *dev, int sock, enum transport_flags flags)
+{
+  if (dev->num_udp_events >= OC_UDP_MAX_EVENT_SOURCES) {
+    OC_ERR("no free UDP event source for socket %d", sock);
+    return -1;
+  }
+  ip_event_source_t *source = &dev->udp_events[dev->num_udp_events++];
+  source->owner = NULL;
+#ifdef OC_IO_URING
+  /* Receives are posted on the io_uring instead, see oc_uring_init() */
+  source->type = IP_EVENT_SOURCE_UDP;
+  source->sock = sock;
+  source->flags = flags;
+  return 0;
+#else  /* OC_IO_URING */
+  /* UDP sockets are edge-triggered and drained until EAGAIN */
+  return oc_ip_add_event_source(dev, source, IP_EVENT_SOURCE_UDP, sock, flags,
+                                EPOLLIN | EPOLLET);
+#endif /* !OC_IO_URING */
+}
+
+static int
+oc_udp_add_socks_to_epoll(ip_context_t *dev)
+{
+  int ret = 0;
+  dev->num_udp_events = 0;
+  ret += add_udp_sock_to_epoll(dev, dev->server_sock, IPV6);
+  ret += add_udp_sock_to_epoll(dev, dev->mcast_sock, IPV6 | MULTICAST);
+#ifdef OC_SECURITY
+  ret += add_udp_sock_to_epoll(dev, dev->secure_sock, IPV6 | SECURED);
+#endif /* OC_SECURITY */
+
+#ifdef OC_IPV4
+  ret += add_udp_sock_to_epoll(dev, dev->server4_sock, IPV4);
+  ret += add_udp_sock_to_epoll(dev, dev->mcast4_sock, IPV4 | MULTICAST);
+#ifdef OC_SECURITY
+  ret += add_udp_sock_to_epoll(dev, dev->secure4_sock, IPV4 | SECURED);
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  return ret;
+}
+
+#if defined(OC_IO_URING)
+/* UDP completions are handled by oc_uring_receive_event() */
+#elif defined(OC_RECVMMSG)
+static void
+oc_udp_receive_event(ip_context_t *dev, ip_event_source_t *source,
+                     udp_recv_ring_t *ring)
+{
+  while (dev->terminate != 1) {
+    if (recv_batch(dev, ring, source->sock, source->flags) >= 0) {
+      continue;
+    }
+    if (errno == ENOBUFS) {
+      oc_ip_park_receive(dev);
+      return;
+    }
+    if (errno != EINTR) {
+      return;
+    }
+  }
+}
+#else  /* OC_RECVMMSG */
+static void
+oc_udp_receive_event(ip_context_t *dev, ip_event_source_t *source)
+{
+  while (dev->terminate != 1) {
+    oc_message_t *message = oc_allocate_message();
+    if (!message) {
+      oc_ip_park_receive(dev);
+      return;
+    }
+
+    message->endpoint.device = dev->device;
+
+    int count =
+      recv_msg(source->sock, message->data, OC_PDU_SIZE, &message->endpoint,
+               (source->flags & MULTICAST) != 0, MSG_DONTWAIT);
+    if (count < 0) {
+      oc_message_unref(message);
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      continue;
+    }
+    message->length = (size_t)count;
+    message->endpoint.flags = source->flags;
+#ifdef OC_SECURITY
+    if (source->flags & SECURED) {
+      message->encrypted = 1;
+    }
+#endif /* OC_SECURITY */
+
+#ifdef OC_DEBUG
+    PRINT("Incoming message of size %zd bytes from ", message->length);
+    PRINTipaddr(message->endpoint);
+    PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+    oc_network_event(message);
+  }
+}
+#endif /* !OC_IO_URING && !OC_RECVMMSG */
+
+static int
+init_event_sources(ip_context_t *dev)
+{
+  dev->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (dev->epoll_fd < 0) {
+    OC_ERR("creating epoll instance %d", errno);
+    return -1;
+  }
+
+  dev->shutdown_event.owner = NULL;
+  if (oc_ip_add_event_source(dev, &dev->shutdown_event,
+                             IP_EVENT_SOURCE_SHUTDOWN, dev->shutdown_pipe[0],
+                             0, EPOLLIN) < 0) {
+    return -1;
+  }
+  /* Monitor network interface changes on the platform from only the 0th logical
+   * device
+   */
+  if (dev->device == 0) {
+    dev->ifchange_event.owner = NULL;
+    if (oc_ip_add_event_source(dev, &dev->ifchange_event,
+                               IP_EVENT_SOURCE_IFCHANGE, ifchange_sock, 0,
+                               EPOLLIN) < 0) {
+      return -1;
+    }
+  }
+
+  if (oc_udp_add_socks_to_epoll(dev) < 0) {
+    return -1;
+  }
+#ifdef OC_IO_URING
+  if (oc_uring_init(dev) < 0) {
+    return -1;
+  }
+#endif /* OC_IO_URING */
+#ifdef OC_TCP
+  if (oc_tcp_add_socks_to_epoll(dev) < 0) {
+    return -1;
+  }
+#endif /* OC_TCP */
+  return 0;
+}
+
+/* The receive sources are left out of the epoll set while the network thread
+ * is parked, so that it keeps sending queued TCP data and handling interface
+ * changes without being woken up by data it cannot take. Resuming reports
+ * the data left unread again.
+ */
+static void
+set_receive_paused(ip_context_t *dev, bool paused)
+{
+#ifdef OC_IO_URING
+  /* Completions fill buffers posted earlier, so their eventfd stays watched */
+  if (!paused) {
+    oc_uring_resume(dev);
+  }
+#else  /* OC_IO_URING */
+  int i;
+  for (i = 0; i < dev->num_udp_events; i++) {
+    oc_ip_modify_event_source(dev, &dev->udp_events[i],
+                              paused ? EPOLLET : EPOLLIN | EPOLLET);
+  }
+#endif /* !OC_IO_URING */
+#ifdef OC_TCP
+  oc_tcp_set_receive_paused(dev, paused);
+#endif /* OC_TCP */
+}
+
+/* Only called on the network event thread of dev */
+void
+oc_ip_park_receive(ip_context_t *dev)
+{
+  park_receive(&dev->rx_parked);
+  if (!dev->rx_paused) {
+    dev->rx_paused = true;
+    set_receive_paused(dev, true);
+  }
+}
+
+static void *
+network_event_thread(void *data)
+{
+  ip_context_t *dev = (ip_context_t *)data;
+  struct epoll_event events[OC_EPOLL_MAX_EVENTS];
+  int i, n;
+#ifdef OC_RECVMMSG
+  udp_recv_ring_t ring;
+  memset(&ring, 0, sizeof(udp_recv_ring_t));
+#endif /* OC_RECVMMSG */
+
+  while (dev->terminate != 1) {
+    /* resume_receive() wakes the thread up once a buffer is released */
+    if (dev->rx_paused && !__atomic_load_n(&dev->rx_parked, __ATOMIC_ACQUIRE)) {
+      dev->rx_paused = false;
+      set_receive_paused(dev, false);
+    }
+    n = epoll_wait(dev->epoll_fd, events, OC_EPOLL_MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno != EINTR) {
+        OC_WRN("epoll_wait returned errno %d", errno);
+      }
+      continue;
+    }
+
+    for (i = 0; i < n && dev->terminate != 1; i++) {
+      ip_event_source_t *source = (ip_event_source_t *)events[i].data.ptr;
+      switch (source->type) {
+      case IP_EVENT_SOURCE_SHUTDOWN: {
+        char buf;
+        // write to pipe shall not block - so read the byte we wrote
+        if (read(dev->shutdown_pipe[0], &buf, 1) < 0) {
+          // intentionally left blank
+        }
+      } break;
+      case IP_EVENT_SOURCE_IFCHANGE:
+        if (process_interface_change_event() < 0) {
+          OC_WRN("caught errors while handling a network interface change");
+        }
+        break;
+      case IP_EVENT_SOURCE_UDP:
+        /* Receive events left over once parked are reported again after
+         * resuming */
+        if (dev->rx_paused) {
+          break;
+        }
+#if defined(OC_IO_URING)
+        /* Not registered with epoll */
+#elif defined(OC_RECVMMSG)
+        oc_udp_receive_event(dev, source, &ring);
+#else
+        oc_udp_receive_event(dev, source);
+#endif
+        break;
+      case IP_EVENT_SOURCE_URING:
+#ifdef OC_IO_URING
+        oc_uring_receive_event(dev);
+#endif /* OC_IO_URING */
+        break;
+      case IP_EVENT_SOURCE_TCP_ACCEPT:
+      case IP_EVENT_SOURCE_TCP_SESSION: {
+#ifdef OC_TCP
+        if (source->type == IP_EVENT_SOURCE_TCP_SESSION &&
+            (events[i].events & (EPOLLOUT | EPOLLERR))) {
+          oc_tcp_send_event(dev, source);
+          if (!(events[i].events & (EPOLLIN | EPOLLHUP))) {
+            break;
+          }
+        }
+        if (dev->rx_paused) {
+          break;
+        }
+        oc_message_t *message = oc_allocate_message();
+        if (!message) {
+          oc_ip_park_receive(dev);
+          break;
+        }
+        if (oc_tcp_receive_event(dev, source, message) !=
+            ADAPTER_STATUS_RECEIVE) {
+          oc_message_unref(message);
+          break;
+        }
+#ifdef OC_DEBUG
+        PRINT("Incoming message of size %zd bytes from ", message->length);
+        PRINTipaddr(message->endpoint);
+        PRINT("\n\n");
+#endif /* OC_DEBUG */
+        oc_network_event(message);
+#endif /* OC_TCP */
+      } break;
+      }
+    }
+
+#ifdef OC_TCP
+    pthread_mutex_lock(&dev->tcp.mutex);
+    oc_tcp_free_closed_sessions(dev);
+    pthread_mutex_unlock(&dev->tcp.mutex);
+#endif /* OC_TCP */
+  }
+#ifdef OC_RECVMMSG
+  release_recv_ring(&ring);
+#endif /* OC_RECVMMSG */
+  pthread_exit(NULL);
+  return NULL;
+}
+#else /* OC_EPOLL */
 static void
 oc_udp_add_socks_to_fd_set(ip_context_t *dev)
 {
@@ -760,12 +1391,59 @@ oc_udp_add_socks_to_fd_set(ip_context_t *dev)
 #endif /* OC_IPV4 */
 }
 
+#ifdef OC_RECVMMSG
+/* Drains every ready UDP socket in fds in batches and clears it from fds.
+ * Returns the number of descriptors that were handled.
+ */
+static int
+oc_udp_receive_batches(ip_context_t *dev, fd_set *fds, udp_recv_ring_t *ring)
+{
+  struct
+  {
+    int sock;
+    enum transport_flags flags;
+  } socks[] = {
+    { dev->server_sock, IPV6 },
+    { dev->mcast_sock, IPV6 | MULTICAST },
+#ifdef OC_SECURITY
+    { dev->secure_sock, IPV6 | SECURED },
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+    { dev->server4_sock, IPV4 },
+    { dev->mcast4_sock, IPV4 | MULTICAST },
+#ifdef OC_SECURITY
+    { dev->secure4_sock, IPV4 | SECURED },
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  };
+  int handled = 0;
+  size_t i;
+  for (i = 0; i < sizeof(socks) / sizeof(socks[0]); i++) {
+    if (FD_ISSET(socks[i].sock, fds)) {
+      if (recv_batch(dev, ring, socks[i].sock, socks[i].flags) < 0 &&
+          errno == ENOBUFS) {
+        oc_ip_park_receive(dev);
+      }
+      FD_CLR(socks[i].sock, fds);
+      handled++;
+    }
+  }
+  return handled;
+}
+#endif /* OC_RECVMMSG */
+
+void
+oc_ip_park_receive(ip_context_t *dev)
+{
+  park_receive(&dev->rx_parked);
+}
+
 static adapter_receive_state_t
 oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 {
   if (FD_ISSET(dev->server_sock, fds)) {
     int count = recv_msg(dev->server_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, false);
+                         &message->endpoint, false, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -777,7 +1455,7 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 
   if (FD_ISSET(dev->mcast_sock, fds)) {
     int count = recv_msg(dev->mcast_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, true);
+                         &message->endpoint, true, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -790,7 +1468,7 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_IPV4
   if (FD_ISSET(dev->server4_sock, fds)) {
     int count = recv_msg(dev->server4_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, false);
+                         &message->endpoint, false, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -802,7 +1480,7 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 
   if (FD_ISSET(dev->mcast4_sock, fds)) {
     int count = recv_msg(dev->mcast4_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, true);
+                         &message->endpoint, true, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -816,7 +1494,7 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_SECURITY
   if (FD_ISSET(dev->secure_sock, fds)) {
     int count = recv_msg(dev->secure_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, false);
+                         &message->endpoint, false, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -829,7 +1507,7 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_IPV4
   if (FD_ISSET(dev->secure4_sock, fds)) {
     int count = recv_msg(dev->secure4_sock, message->data, OC_PDU_SIZE,
-                         &message->endpoint, false);
+                         &message->endpoint, false, 0);
     if (count < 0) {
       return ADAPTER_STATUS_ERROR;
     }
@@ -866,9 +1544,24 @@ network_event_thread(void *data)
 #endif /* OC_TCP */
 
   int i, n;
+#ifdef OC_RECVMMSG
+  udp_recv_ring_t ring;
+  memset(&ring, 0, sizeof(udp_recv_ring_t));
+#endif /* OC_RECVMMSG */
 
   while (dev->terminate != 1) {
-    setfds = dev->rfds;
+    /* resume_receive() wakes the thread up once a buffer is released */
+    bool parked = __atomic_load_n(&dev->rx_parked, __ATOMIC_ACQUIRE);
+    if (parked) {
+      /* Only interface changes are handled meanwhile */
+      FD_ZERO(&setfds);
+      FD_SET(dev->shutdown_pipe[0], &setfds);
+      if (dev->device == 0) {
+        FD_SET(ifchange_sock, &setfds);
+      }
+    } else {
+      setfds = dev->rfds;
+    }
     n = select(FD_SETSIZE, &setfds, NULL, NULL, NULL);
 
     if (FD_ISSET(dev->shutdown_pipe[0], &setfds)) {
@@ -883,6 +1576,10 @@ network_event_thread(void *data)
       break;
     }
 
+#ifdef OC_RECVMMSG
+    n -= oc_udp_receive_batches(dev, &setfds, &ring);
+#endif /* OC_RECVMMSG */
+
     for (i = 0; i < n; i++) {
       if (dev->device == 0) {
         if (FD_ISSET(ifchange_sock, &setfds)) {
@@ -893,10 +1590,14 @@ network_event_thread(void *data)
           continue;
         }
       }
+      if (parked) {
+        break;
+      }
 
       oc_message_t *message = oc_allocate_message();
 
       if (!message) {
+        oc_ip_park_receive(dev);
         break;
       }
 
@@ -926,74 +1627,91 @@ network_event_thread(void *data)
       oc_network_event(message);
     }
   }
+#ifdef OC_RECVMMSG
+  release_recv_ring(&ring);
+#endif /* OC_RECVMMSG */
   pthread_exit(NULL);
   return NULL;
 }
+#endif /* !OC_EPOLL */
 
-static int
-send_msg(int sock, struct sockaddr_storage *receiver, oc_message_t *message)
+/* Writes the IP(V6)_PKTINFO control message selecting the outgoing interface
+ * and source address of endpoint into control. Returns the length of the
+ * control data, or 0 for an invalid endpoint.
+ */
+static size_t
+set_pktinfo_cmsg(oc_endpoint_t *endpoint, char *control, size_t control_size)
 {
-  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
-  struct iovec iovec[1];
   struct msghdr msg;
+  struct cmsghdr *cmsg;
 
   memset(&msg, 0, sizeof(struct msghdr));
-  msg.msg_name = (void *)receiver;
-  msg.msg_namelen = sizeof(struct sockaddr_storage);
+  msg.msg_control = control;
+  msg.msg_controllen = control_size;
+  memset(control, 0, control_size);
 
-  msg.msg_iov = iovec;
-  msg.msg_iovlen = 1;
-
-  if (message->endpoint.flags & IPV6) {
-    struct cmsghdr *cmsg;
+  if (endpoint->flags & IPV6) {
     struct in6_pktinfo *pktinfo;
 
-    msg.msg_control = msg_control;
     msg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
-    memset(msg.msg_control, 0, msg.msg_controllen);
-
     cmsg = CMSG_FIRSTHDR(&msg);
     cmsg->cmsg_level = IPPROTO_IPV6;
     cmsg->cmsg_type = IPV6_PKTINFO;
     cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
 
     pktinfo = (struct in6_pktinfo *)CMSG_DATA(cmsg);
-    memset(pktinfo, 0, sizeof(struct in6_pktinfo));
 
     /* Get the outgoing interface index from message->endpint */
-    pktinfo->ipi6_ifindex = message->endpoint.interface_index;
+    pktinfo->ipi6_ifindex = endpoint->interface_index;
     /* Set the source address of this message using the address
      * from the endpoint's addr_local attribute.
      */
-    memcpy(&pktinfo->ipi6_addr, message->endpoint.addr_local.ipv6.address, 16);
+    memcpy(&pktinfo->ipi6_addr, endpoint->addr_local.ipv6.address, 16);
   }
 #ifdef OC_IPV4
-  else if (message->endpoint.flags & IPV4) {
-    struct cmsghdr *cmsg;
+  else if (endpoint->flags & IPV4) {
     struct in_pktinfo *pktinfo;
 
-    msg.msg_control = msg_control;
     msg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
-    memset(msg.msg_control, 0, msg.msg_controllen);
-
     cmsg = CMSG_FIRSTHDR(&msg);
     cmsg->cmsg_level = SOL_IP;
     cmsg->cmsg_type = IP_PKTINFO;
     cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
 
     pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
-    memset(pktinfo, 0, sizeof(struct in_pktinfo));
 
-    pktinfo->ipi_ifindex = message->endpoint.interface_index;
-    memcpy(&pktinfo->ipi_spec_dst, message->endpoint.addr_local.ipv4.address,
-           4);
-  }
-#else  /* OC_IPV4 */
-  else {
-    OC_ERR("invalid endpoint");
+    pktinfo->ipi_ifindex = endpoint->interface_index;
+    memcpy(&pktinfo->ipi_spec_dst, endpoint->addr_local.ipv4.address, 4);
+  }
+#endif /* OC_IPV4 */
+  else {
+    OC_ERR("invalid endpoint");
+    return 0;
+  }
+
+  return msg.msg_controllen;
+}
+
+static int
+send_msg(int sock, struct sockaddr_storage *receiver, oc_message_t *message)
+{
+  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
+  struct iovec iovec[1];
+  struct msghdr msg;
+
+  memset(&msg, 0, sizeof(struct msghdr));
+  msg.msg_name = (void *)receiver;
+  msg.msg_namelen = sizeof(struct sockaddr_storage);
+
+  msg.msg_iov = iovec;
+  msg.msg_iovlen = 1;
+
+  msg.msg_control = msg_control;
+  msg.msg_controllen =
+    set_pktinfo_cmsg(&message->endpoint, msg_control, sizeof(msg_control));
+  if (msg.msg_controllen == 0) {
     return -1;
   }
-#endif /* !OC_IPV4 */
 
   int bytes_sent = 0, x;
   while (bytes_sent < (int)message->length) {
@@ -1015,36 +1733,64 @@ send_msg(int sock, struct sockaddr_storage *receiver, oc_message_t *message)
   return bytes_sent;
 }
 
-int
-oc_send_buffer(oc_message_t *message)
+static void
+get_receiver_for_endpoint(oc_endpoint_t *endpoint,
+                          struct sockaddr_storage *receiver)
 {
-#ifdef OC_DEBUG
-  PRINT("Outgoing message of size %zd bytes to ", message->length);
-  PRINTipaddr(message->endpoint);
-  PRINT("\n\n");
-#endif /* OC_DEBUG */
-
-  struct sockaddr_storage receiver;
-  memset(&receiver, 0, sizeof(struct sockaddr_storage));
+  memset(receiver, 0, sizeof(struct sockaddr_storage));
 #ifdef OC_IPV4
-  if (message->endpoint.flags & IPV4) {
-    struct sockaddr_in *r = (struct sockaddr_in *)&receiver;
-    memcpy(&r->sin_addr.s_addr, message->endpoint.addr.ipv4.address,
+  if (endpoint->flags & IPV4) {
+    struct sockaddr_in *r = (struct sockaddr_in *)receiver;
+    memcpy(&r->sin_addr.s_addr, endpoint->addr.ipv4.address,
            sizeof(r->sin_addr.s_addr));
     r->sin_family = AF_INET;
-    r->sin_port = htons(message->endpoint.addr.ipv4.port);
+    r->sin_port = htons(endpoint->addr.ipv4.port);
   } else {
 #else
   {
 #endif
-    struct sockaddr_in6 *r = (struct sockaddr_in6 *)&receiver;
-    memcpy(r->sin6_addr.s6_addr, message->endpoint.addr.ipv6.address,
+    struct sockaddr_in6 *r = (struct sockaddr_in6 *)receiver;
+    memcpy(r->sin6_addr.s6_addr, endpoint->addr.ipv6.address,
            sizeof(r->sin6_addr.s6_addr));
     r->sin6_family = AF_INET6;
-    r->sin6_port = htons(message->endpoint.addr.ipv6.port);
-    r->sin6_scope_id = message->endpoint.addr.ipv6.scope;
+    r->sin6_port = htons(endpoint->addr.ipv6.port);
+    r->sin6_scope_id = endpoint->addr.ipv6.scope;
   }
-  int send_sock = -1;
+}
+
+static int
+get_udp_send_sock(ip_context_t *dev, oc_endpoint_t *endpoint)
+{
+#ifdef OC_SECURITY
+  if (endpoint->flags & SECURED) {
+#ifdef OC_IPV4
+    if (endpoint->flags & IPV4) {
+      return dev->secure4_sock;
+    }
+#endif /* OC_IPV4 */
+    return dev->secure_sock;
+  }
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+  if (endpoint->flags & IPV4) {
+    return dev->server4_sock;
+  }
+#endif /* OC_IPV4 */
+  (void)endpoint;
+  return dev->server_sock;
+}
+
+int
+oc_send_buffer(oc_message_t *message)
+{
+#ifdef OC_DEBUG
+  PRINT("Outgoing message of size %zd bytes to ", message->length);
+  PRINTipaddr(message->endpoint);
+  PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+  struct sockaddr_storage receiver;
+  get_receiver_for_endpoint(&message->endpoint, &receiver);
 
   ip_context_t *dev = get_ip_context_for_device(message->endpoint.device);
 
@@ -1054,33 +1800,164 @@ oc_send_buffer(oc_message_t *message)
   }
 #endif /* OC_TCP */
 
-#ifdef OC_SECURITY
-  if (message->endpoint.flags & SECURED) {
-#ifdef OC_IPV4
-    if (message->endpoint.flags & IPV4) {
-      send_sock = dev->secure4_sock;
-    } else {
-      send_sock = dev->secure_sock;
+  return send_msg(get_udp_send_sock(dev, &message->endpoint), &receiver,
+                  message);
+}
+
+#ifdef OC_SENDMMSG
+#ifndef OC_SENDMMSG_QUEUE_SIZE
+/* Maximum number of datagrams held back until oc_flush_send_buffers() */
+#define OC_SENDMMSG_QUEUE_SIZE (32)
+#endif /* !OC_SENDMMSG_QUEUE_SIZE */
+
+typedef struct udp_send_entry_t
+{
+  oc_message_t *message;
+  int sock;
+  struct sockaddr_storage receiver;
+  /* Source selection of this datagram; entries sharing it share control */
+  enum transport_flags family;
+  int interface_index;
+  uint8_t addr_local[16];
+  char control[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+  char *cmsg;
+  size_t cmsg_len;
+} udp_send_entry_t;
+
+/* Only accessed from the thread running oc_main_poll() */
+static udp_send_entry_t send_queue[OC_SENDMMSG_QUEUE_SIZE];
+static int send_queue_len;
+
+static void
+set_queued_source(udp_send_entry_t *entry)
+{
+  oc_endpoint_t *endpoint = &entry->message->endpoint;
+  int i;
+
+  entry->family = endpoint->flags & (IPV6 | IPV4);
+  entry->interface_index = endpoint->interface_index;
+  memcpy(entry->addr_local, endpoint->addr_local.ipv6.address, 16);
+
+  for (i = 0; i < send_queue_len; i++) {
+    udp_send_entry_t *e = &send_queue[i];
+    if (e->family == entry->family &&
+        e->interface_index == entry->interface_index &&
+        memcmp(e->addr_local, entry->addr_local, 16) == 0) {
+      entry->cmsg = e->cmsg;
+      entry->cmsg_len = e->cmsg_len;
+      return;
     }
-#else  /* OC_IPV4 */
-    send_sock = dev->secure_sock;
-#endif /* !OC_IPV4 */
-  } else
-#endif /* OC_SECURITY */
-#ifdef OC_IPV4
-    if (message->endpoint.flags & IPV4) {
-    send_sock = dev->server4_sock;
-  } else {
-    send_sock = dev->server_sock;
   }
-#else  /* OC_IPV4 */
-  {
-    send_sock = dev->server_sock;
+
+  entry->cmsg = entry->control;
+  entry->cmsg_len =
+    set_pktinfo_cmsg(endpoint, entry->control, sizeof(entry->control));
+}
+
+static void
+send_batch(int sock, struct mmsghdr *msgs, unsigned int num)
+{
+  unsigned int offset = 0;
+  while (offset < num) {
+    int x = sendmmsg(sock, msgs + offset, num - offset, 0);
+    if (x < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      OC_WRN("sendmmsg() returned errno %d", errno);
+      /* Drop the datagram that failed and carry on with the rest */
+      offset++;
+      continue;
+    }
+    offset += (unsigned int)x;
   }
-#endif /* !OC_IPV4 */
+  OC_DBG("Sent %u datagrams", num);
+}
+
+int
+oc_queue_send_buffer(oc_message_t *message)
+{
+#ifdef OC_TCP
+  if (message->endpoint.flags & TCP) {
+    return oc_send_buffer(message);
+  }
+#endif /* OC_TCP */
+
+  if (send_queue_len == OC_SENDMMSG_QUEUE_SIZE) {
+    oc_flush_send_buffers();
+  }
+
+#ifdef OC_DEBUG
+  PRINT("Queued outgoing message of size %zd bytes to ", message->length);
+  PRINTipaddr(message->endpoint);
+  PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+  udp_send_entry_t *entry = &send_queue[send_queue_len];
+  ip_context_t *dev = get_ip_context_for_device(message->endpoint.device);
+  entry->message = message;
+  entry->sock = get_udp_send_sock(dev, &message->endpoint);
+  get_receiver_for_endpoint(&message->endpoint, &entry->receiver);
+  set_queued_source(entry);
+  if (entry->cmsg_len == 0) {
+    return -1;
+  }
+
+  oc_message_add_ref(message);
+  send_queue_len++;
+  return 0;
+}
+
+void
+oc_flush_send_buffers(void)
+{
+  struct mmsghdr msgs[OC_SENDMMSG_QUEUE_SIZE];
+  struct iovec iovecs[OC_SENDMMSG_QUEUE_SIZE];
+  bool sent[OC_SENDMMSG_QUEUE_SIZE];
+  int i, j;
 
-  return send_msg(send_sock, &receiver, message);
+  if (send_queue_len == 0) {
+    return;
+  }
+
+  memset(msgs, 0, sizeof(msgs));
+  memset(sent, 0, sizeof(sent));
+
+  /* Group the queued datagrams per socket, keeping their relative order */
+  for (i = 0; i < send_queue_len; i++) {
+    if (sent[i]) {
+      continue;
+    }
+    int sock = send_queue[i].sock;
+    unsigned int num = 0;
+    for (j = i; j < send_queue_len; j++) {
+      udp_send_entry_t *entry = &send_queue[j];
+      if (sent[j] || entry->sock != sock) {
+        continue;
+      }
+      iovecs[num].iov_base = entry->message->data;
+      iovecs[num].iov_len = entry->message->length;
+
+      struct msghdr *msg = &msgs[num].msg_hdr;
+      msg->msg_name = &entry->receiver;
+      msg->msg_namelen = sizeof(struct sockaddr_storage);
+      msg->msg_iov = &iovecs[num];
+      msg->msg_iovlen = 1;
+      msg->msg_control = entry->cmsg;
+      msg->msg_controllen = entry->cmsg_len;
+      sent[j] = true;
+      num++;
+    }
+    send_batch(sock, msgs, num);
+  }
+
+  for (i = 0; i < send_queue_len; i++) {
+    oc_message_unref(send_queue[i].message);
+    send_queue[i].message = NULL;
+  }
+  send_queue_len = 0;
 }
+#endif /* OC_SENDMMSG */
 
 #ifdef OC_CLIENT
 void
@@ -1263,6 +2140,297 @@ handle_session_event_callback(const oc_endpoint_t *endpoint,
 }
 #endif /* OC_SESSION_EVENTS */
 
+#ifdef OC_REUSEPORT
+static int
+set_reuseport(int sock)
+{
+  int on = 1;
+  if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+    OC_ERR("setting reuseport option %d", errno);
+    return -1;
+  }
+  return 0;
+}
+
+/* Opens another socket on the address the primary socket was bound to, with
+ * the same receive options.
+ */
+static int
+open_shard_sock(struct sockaddr_storage *addr, bool v6only)
+{
+  int on = 1;
+  int sock = socket(addr->ss_family, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    OC_ERR("creating shard socket %d", errno);
+    return -1;
+  }
+  if (addr->ss_family == AF_INET6) {
+    if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on)) ==
+          -1 ||
+        (v6only &&
+         setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) == -1)) {
+      OC_ERR("setting shard socket option %d", errno);
+      goto error;
+    }
+  }
+#ifdef OC_IPV4
+  else if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) == -1) {
+    OC_ERR("setting shard socket option %d", errno);
+    goto error;
+  }
+#endif /* OC_IPV4 */
+  if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1) {
+    OC_ERR("setting reuseaddr option %d", errno);
+    goto error;
+  }
+  if (set_reuseport(sock) < 0) {
+    goto error;
+  }
+  if (bind(sock, (struct sockaddr *)addr, sizeof(*addr)) == -1) {
+    OC_ERR("binding shard socket %d", errno);
+    goto error;
+  }
+  return sock;
+
+error:
+  close(sock);
+  return -1;
+}
+
+static void
+close_shard_socks(udp_recv_shard_t *shard)
+{
+  if (shard->server_sock >= 0) {
+    close(shard->server_sock);
+  }
+#ifdef OC_SECURITY
+  if (shard->secure_sock >= 0) {
+    close(shard->secure_sock);
+  }
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+  if (shard->server4_sock >= 0) {
+    close(shard->server4_sock);
+  }
+#ifdef OC_SECURITY
+  if (shard->secure4_sock >= 0) {
+    close(shard->secure4_sock);
+  }
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  close(shard->wake_pipe[1]);
+  close(shard->wake_pipe[0]);
+}
+
+static int
+open_shard_socks(ip_context_t *dev, udp_recv_shard_t *shard)
+{
+  shard->dev = dev;
+  shard->rx_parked = false;
+  if (pipe(shard->wake_pipe) < 0) {
+    OC_ERR("shard wake pipe: %d", errno);
+    return -1;
+  }
+  shard->server_sock = open_shard_sock(&dev->server, true);
+#ifdef OC_SECURITY
+  shard->secure_sock = open_shard_sock(&dev->secure, false);
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+  /* Only on the ports that connectivity_ipv4_init() bound, as the device
+     runs without IPv4 when it fails */
+  shard->server4_sock =
+    dev->port4 != 0 ? open_shard_sock(&dev->server4, false) : -1;
+#ifdef OC_SECURITY
+  shard->secure4_sock =
+    dev->dtls4_port != 0 ? open_shard_sock(&dev->secure4, false) : -1;
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+
+  /* A socket that cannot be shared is still read by the network event
+     thread, so the shard is only given up if it has none. poll() skips the
+     missing ones in the shard thread. */
+  if (shard->server_sock < 0
+#ifdef OC_SECURITY
+      && shard->secure_sock < 0
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+      && shard->server4_sock < 0
+#ifdef OC_SECURITY
+      && shard->secure4_sock < 0
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  ) {
+    close_shard_socks(shard);
+    return -1;
+  }
+  return 0;
+}
+
+#ifndef OC_RECVMMSG
+/* Returns false if it ran out of message buffers */
+static bool
+shard_receive(ip_context_t *dev, int sock, enum transport_flags flags)
+{
+  while (dev->terminate != 1) {
+    oc_message_t *message = oc_allocate_message();
+    if (!message) {
+      return false;
+    }
+    message->endpoint.device = dev->device;
+    int count = recv_msg(sock, message->data, OC_PDU_SIZE, &message->endpoint,
+                         false, MSG_DONTWAIT);
+    if (count < 0) {
+      oc_message_unref(message);
+      return true;
+    }
+    message->length = (size_t)count;
+    message->endpoint.flags = flags;
+#ifdef OC_SECURITY
+    if (flags & SECURED) {
+      message->encrypted = 1;
+    }
+#endif /* OC_SECURITY */
+
+#ifdef OC_DEBUG
+    PRINT("Incoming message of size %zd bytes from ", message->length);
+    PRINTipaddr(message->endpoint);
+    PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+    oc_network_event(message);
+  }
+  return true;
+}
+#endif /* !OC_RECVMMSG */
+
+static void *
+udp_recv_shard_thread(void *data)
+{
+  udp_recv_shard_t *shard = (udp_recv_shard_t *)data;
+  ip_context_t *dev = shard->dev;
+  enum transport_flags flags[6];
+  struct pollfd fds[6];
+  nfds_t nfds = 0, num_polled, i;
+#ifdef OC_RECVMMSG
+  udp_recv_ring_t ring;
+  memset(&ring, 0, sizeof(udp_recv_ring_t));
+#endif /* OC_RECVMMSG */
+
+#define ADD_SHARD_FD(s, f)                                                     \
+  do {                                                                         \
+    fds[nfds].fd = (s);                                                        \
+    fds[nfds].events = POLLIN;                                                 \
+    flags[nfds++] = (f);                                                       \
+  } while (0)
+
+  ADD_SHARD_FD(dev->shard_pipe[0], 0);
+  ADD_SHARD_FD(shard->wake_pipe[0], 0);
+  ADD_SHARD_FD(shard->server_sock, IPV6);
+#ifdef OC_SECURITY
+  ADD_SHARD_FD(shard->secure_sock, IPV6 | SECURED);
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+  ADD_SHARD_FD(shard->server4_sock, IPV4);
+#ifdef OC_SECURITY
+  ADD_SHARD_FD(shard->secure4_sock, IPV4 | SECURED);
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+#undef ADD_SHARD_FD
+
+  while (dev->terminate != 1) {
+    /* While parked only the shutdown and wake pipes are watched */
+    num_polled = nfds;
+    if (__atomic_load_n(&shard->rx_parked, __ATOMIC_ACQUIRE)) {
+      num_polled = 2;
+    }
+    if (poll(fds, num_polled, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      OC_ERR("shard poll error: %d", errno);
+      break;
+    }
+    if (dev->terminate || fds[0].revents) {
+      break;
+    }
+    if (fds[1].revents) {
+      char buf;
+      if (read(shard->wake_pipe[0], &buf, 1) < 0) {
+        // intentionally left blank
+      }
+    }
+    for (i = 2; i < num_polled; i++) {
+      if (fds[i].revents & POLLIN) {
+#ifdef OC_RECVMMSG
+        int count = 0;
+        while (dev->terminate != 1 &&
+               (count = recv_batch(dev, &ring, fds[i].fd, flags[i])) > 0)
+          ;
+        if (count < 0 && errno == ENOBUFS) {
+          park_receive(&shard->rx_parked);
+          break;
+        }
+#else  /* OC_RECVMMSG */
+        if (!shard_receive(dev, fds[i].fd, flags[i])) {
+          park_receive(&shard->rx_parked);
+          break;
+        }
+#endif /* !OC_RECVMMSG */
+      }
+    }
+  }
+  /* Nothing reads the wake pipe from now on */
+  __atomic_store_n(&shard->rx_parked, false, __ATOMIC_SEQ_CST);
+#ifdef OC_RECVMMSG
+  release_recv_ring(&ring);
+#endif /* OC_RECVMMSG */
+  pthread_exit(NULL);
+  return NULL;
+}
+
+/* Stops and releases the first num_shards shards of dev */
+static void
+shutdown_recv_shards(ip_context_t *dev, int num_shards)
+{
+  int i;
+  if (write(dev->shard_pipe[1], "\n", 1) < 0) {
+    OC_WRN("cannot wakeup shard threads");
+  }
+  for (i = 0; i < num_shards; i++) {
+    pthread_join(dev->shards[i].thread, NULL);
+    close_shard_socks(&dev->shards[i]);
+  }
+  close(dev->shard_pipe[1]);
+  close(dev->shard_pipe[0]);
+}
+
+static int
+init_recv_shards(ip_context_t *dev)
+{
+  int i;
+  if (pipe(dev->shard_pipe) < 0) {
+    OC_ERR("shard pipe: %d", errno);
+    return -1;
+  }
+  for (i = 0; i < OC_UDP_RECV_SHARDS; i++) {
+    if (open_shard_socks(dev, &dev->shards[i]) < 0) {
+      goto error;
+    }
+    if (pthread_create(&dev->shards[i].thread, NULL, &udp_recv_shard_thread,
+                       &dev->shards[i]) != 0) {
+      OC_ERR("creating shard receive thread");
+      close_shard_socks(&dev->shards[i]);
+      goto error;
+    }
+  }
+  return 0;
+
+error:
+  shutdown_recv_shards(dev, i);
+  return -1;
+}
+#endif /* OC_REUSEPORT */
+
 #ifdef OC_IPV4
 static int
 connectivity_ipv4_init(ip_context_t *dev)
@@ -1314,6 +2482,11 @@ connectivity_ipv4_init(ip_context_t *dev)
     OC_ERR("setting reuseaddr option %d", errno);
     return -1;
   }
+#ifdef OC_REUSEPORT
+  if (set_reuseport(dev->server4_sock) < 0) {
+    return -1;
+  }
+#endif /* OC_REUSEPORT */
   if (bind(dev->server4_sock, (struct sockaddr *)&dev->server4,
            sizeof(dev->server4)) == -1) {
     OC_ERR("binding server4 socket %d", errno);
@@ -1360,6 +2533,11 @@ connectivity_ipv4_init(ip_context_t *dev)
     OC_ERR("setting reuseaddr IPv4 option %d", errno);
     return -1;
   }
+#ifdef OC_REUSEPORT
+  if (set_reuseport(dev->secure4_sock) < 0) {
+    return -1;
+  }
+#endif /* OC_REUSEPORT */
   if (bind(dev->secure4_sock, (struct sockaddr *)&dev->secure4,
            sizeof(dev->secure4)) == -1) {
     OC_ERR("binding IPv4 secure socket %d", errno);
@@ -1393,8 +2571,14 @@ oc_connectivity_init(size_t device)
     oc_abort("Insufficient memory");
   }
   oc_list_add(ip_contexts, dev);
+  oc_set_buffers_avail_cb(resume_receive);
   dev->device = device;
   OC_LIST_STRUCT_INIT(dev, eps);
+  dev->eps_loaded = false;
+  dev->rx_parked = false;
+#ifdef OC_EPOLL
+  dev->rx_paused = false;
+#endif /* OC_EPOLL */
 
   if (pipe(dev->shutdown_pipe) < 0) {
     OC_ERR("shutdown pipe: %d", errno);
@@ -1454,6 +2638,11 @@ oc_connectivity_init(size_t device)
     OC_ERR("setting reuseaddr option %d", errno);
     return -1;
   }
+#ifdef OC_REUSEPORT
+  if (set_reuseport(dev->server_sock) < 0) {
+    return -1;
+  }
+#endif /* OC_REUSEPORT */
 #ifdef IPV6_ADDR_PREFERENCES
   int prefer = 2;
   if (setsockopt(dev->server_sock, IPPROTO_IPV6, IPV6_ADDR_PREFERENCES, &prefer,
@@ -1515,6 +2704,11 @@ oc_connectivity_init(size_t device)
     OC_ERR("setting reuseaddr option %d", errno);
     return -1;
   }
+#ifdef OC_REUSEPORT
+  if (set_reuseport(dev->secure_sock) < 0) {
+    return -1;
+  }
+#endif /* OC_REUSEPORT */
 #ifdef IPV6_ADDR_PREFERENCES
   if (setsockopt(dev->secure_sock, IPPROTO_IPV6, IPV6_ADDR_PREFERENCES, &prefer,
                  sizeof(prefer)) == -1) {
@@ -1591,9 +2785,29 @@ oc_connectivity_init(size_t device)
     ifchange_initialized = true;
   }
 
+#ifdef OC_EPOLL
+  if (init_event_sources(dev) < 0) {
+    OC_ERR("registering sockets with the network event thread");
+    return -1;
+  }
+#endif /* OC_EPOLL */
+
+  /* The shards are started first, so that no thread is left running on the
+   * device when they cannot be set up.
+   */
+#ifdef OC_REUSEPORT
+  if (init_recv_shards(dev) < 0) {
+    OC_ERR("initializing receive shards");
+    return -1;
+  }
+#endif /* OC_REUSEPORT */
+
   if (pthread_create(&dev->event_thread, NULL, &network_event_thread, dev) !=
       0) {
     OC_ERR("creating network polling thread");
+#ifdef OC_REUSEPORT
+    shutdown_recv_shards(dev, OC_UDP_RECV_SHARDS);
+#endif /* OC_REUSEPORT */
     return -1;
   }
 
@@ -1606,6 +2820,9 @@ void
 oc_connectivity_shutdown(size_t device)
 {
   ip_context_t *dev = get_ip_context_for_device(device);
+#ifdef OC_SENDMMSG
+  oc_flush_send_buffers();
+#endif /* OC_SENDMMSG */
   dev->terminate = 1;
   if (write(dev->shutdown_pipe[1], "\n", 1) < 0) {
     OC_WRN("cannot wakeup network thread");
@@ -1632,12 +2849,29 @@ oc_connectivity_shutdown(size_t device)
 
   pthread_join(dev->event_thread, NULL);
 
+#ifdef OC_REUSEPORT
+  shutdown_recv_shards(dev, OC_UDP_RECV_SHARDS);
+#endif /* OC_REUSEPORT */
+
+#ifdef OC_EPOLL
+#ifdef OC_TCP
+  oc_tcp_free_closed_sessions(dev);
+#endif /* OC_TCP */
+#ifdef OC_IO_URING
+  oc_uring_shutdown(dev);
+#endif /* OC_IO_URING */
+  close(dev->epoll_fd);
+#endif /* OC_EPOLL */
+
   close(dev->shutdown_pipe[1]);
   close(dev->shutdown_pipe[0]);
 
   free_endpoints_list(dev);
 
   oc_list_remove(ip_contexts, dev);
+  if (!oc_list_head(ip_contexts)) {
+    oc_set_buffers_avail_cb(NULL);
+  }
   oc_memb_free(&ip_context_s, dev);
 
   OC_DBG("oc_connectivity_shutdown for device %zd", device);
@@ -19,10 +19,24 @@
 #ifndef IPCONTEXT_H
 #define IPCONTEXT_H
 
+#if defined(OC_IO_URING) && !defined(OC_EPOLL)
+#error Preprocessor macro OC_IO_URING is defined but OC_EPOLL is not defined
+#endif /* OC_IO_URING && !OC_EPOLL */
+
+/* Every UDP socket keeps OC_URING_RECV_DEPTH receives posted, each holding
+ * an incoming message, which the small static pool cannot spare */
+#if defined(OC_IO_URING) && !defined(OC_DYNAMIC_ALLOCATION)
+#error Preprocessor macro OC_IO_URING is defined but OC_DYNAMIC_ALLOCATION is not defined
+#endif /* OC_IO_URING && !OC_DYNAMIC_ALLOCATION */
+
 #include "oc_endpoint.h"
 #include <pthread.h>
 #include <stdint.h>
+#ifdef OC_EPOLL
+#include <sys/epoll.h>
+#else /* OC_EPOLL */
 #include <sys/select.h>
+#endif /* !OC_EPOLL */
 #include <sys/socket.h>
 
 #ifdef __cplusplus
@@ -37,6 +51,66 @@ typedef enum {
   ADAPTER_STATUS_ERROR     /* Error */
 } adapter_receive_state_t;
 
+#ifdef OC_EPOLL
+typedef enum {
+  IP_EVENT_SOURCE_SHUTDOWN = 0, /* shutdown_pipe of the ip_context_t */
+  IP_EVENT_SOURCE_IFCHANGE,     /* Netlink interface change socket */
+  IP_EVENT_SOURCE_UDP,          /* UDP unicast, multicast or secure socket */
+  IP_EVENT_SOURCE_TCP_ACCEPT,   /* TCP listening socket */
+  IP_EVENT_SOURCE_TCP_SESSION,  /* TCP session, owner is the tcp_session_t */
+  IP_EVENT_SOURCE_URING         /* Completion eventfd of the io_uring */
+} ip_event_source_type_t;
+
+/* Registered as the epoll_event data pointer of every descriptor monitored by
+ * the network event thread, so a ready descriptor is dispatched directly to
+ * the socket or session that owns it.
+ */
+typedef struct ip_event_source_t
+{
+  ip_event_source_type_t type;
+  int sock;
+  enum transport_flags flags;
+  void *owner;
+} ip_event_source_t;
+
+#define OC_UDP_MAX_EVENT_SOURCES (6)
+#endif /* OC_EPOLL */
+
+#ifdef OC_REUSEPORT
+#ifndef OC_UDP_RECV_SHARDS
+/* Number of additional receive threads per logical device */
+#define OC_UDP_RECV_SHARDS (2)
+#endif /* !OC_UDP_RECV_SHARDS */
+
+struct ip_context_t;
+
+/* A second set of unicast UDP sockets bound to the ports of a logical device
+ * with SO_REUSEPORT, drained by its own thread. The kernel spreads incoming
+ * flows across the sockets of a port by hash. Shards only receive: datagrams
+ * are posted through oc_network_event(), so CoAP parsing, the oc_ri and
+ * coap transaction/observer state, DTLS and resource handlers all remain on
+ * the thread running oc_main_poll(). Replies leave from the primary sockets
+ * of the device, which share the same local ports.
+ */
+typedef struct udp_recv_shard_t
+{
+  struct ip_context_t *dev;
+  pthread_t thread;
+  int server_sock;
+#ifdef OC_SECURITY
+  int secure_sock;
+#endif /* OC_SECURITY */
+#ifdef OC_IPV4
+  int server4_sock;
+#ifdef OC_SECURITY
+  int secure4_sock;
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  bool rx_parked; /* receiving stopped until a message buffer is released */
+  int wake_pipe[2];
+} udp_recv_shard_t;
+#endif /* OC_REUSEPORT */
+
 #ifdef OC_TCP
 typedef struct tcp_context_t
 {
@@ -60,12 +134,22 @@ typedef struct tcp_context_t
 #endif /* OC_IPV4 */
   int connect_pipe[2];
   pthread_mutex_t mutex;
+#ifdef OC_EPOLL
+  ip_event_source_t accept_events[4];
+  int num_accept_events;
+  /* Receiving paused while the network thread is parked */
+  bool rx_paused;
+  /* Sessions that were closed but may still be referenced by events
+     returned from an ongoing epoll_wait() in the network event thread */
+  OC_LIST_STRUCT(closed_sessions);
+#endif /* OC_EPOLL */
 } tcp_context_t;
 #endif
 
 typedef struct ip_context_t {
   struct ip_context_t *next;
   OC_LIST_STRUCT(eps);
+  bool eps_loaded; /* eps reflects the interface addresses */
   struct sockaddr_storage mcast;
   struct sockaddr_storage server;
   int mcast_sock;
@@ -94,10 +178,60 @@ typedef struct ip_context_t {
   pthread_t event_thread;
   int terminate;
   size_t device;
+#ifdef OC_EPOLL
+  int epoll_fd;
+  ip_event_source_t shutdown_event;
+  ip_event_source_t ifchange_event;
+  ip_event_source_t udp_events[OC_UDP_MAX_EVENT_SOURCES];
+  int num_udp_events;
+#ifdef OC_IO_URING
+  struct ip_uring_t *uring;
+  ip_event_source_t uring_event;
+#endif /* OC_IO_URING */
+#else  /* OC_EPOLL */
   fd_set rfds;
+#endif /* !OC_EPOLL */
   int shutdown_pipe[2];
+  /* Receiving stopped until a message buffer is released, see
+   * oc_ip_park_receive()
+   */
+  bool rx_parked;
+#ifdef OC_EPOLL
+  /* Receive sources left out of the epoll set since the network thread
+   * parked, only used by that thread */
+  bool rx_paused;
+#endif /* OC_EPOLL */
+#ifdef OC_REUSEPORT
+  udp_recv_shard_t shards[OC_UDP_RECV_SHARDS];
+  /* Written once on shutdown and never drained, so every shard wakes up */
+  int shard_pipe[2];
+#endif /* OC_REUSEPORT */
 } ip_context_t;
 
+#ifdef OC_EPOLL
+int oc_ip_add_event_source(ip_context_t *dev, ip_event_source_t *source,
+                           ip_event_source_type_t type, int sock,
+                           enum transport_flags flags, uint32_t events);
+
+void oc_ip_remove_event_source(ip_context_t *dev, ip_event_source_t *source);
+
+void oc_ip_modify_event_source(ip_context_t *dev, ip_event_source_t *source,
+                               uint32_t events);
+#endif /* OC_EPOLL */
+
+/* Stops the network thread of dev from reading any socket once no message
+ * buffer is left, until one is released. Datagrams stay queued in the socket
+ * buffers meanwhile, while TCP sends and interface changes are still
+ * handled. Only called on the network thread of dev.
+ */
+void oc_ip_park_receive(ip_context_t *dev);
+
+/* Fills in the local and remote address of endpoint from a message received
+ * with IP(V6)_PKTINFO. Returns -1 if the control data is missing or invalid.
+ */
+int oc_ip_get_endpoint_from_msghdr(struct msghdr *msg, oc_endpoint_t *endpoint,
+                                   bool multicast);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,12 @@ extern "C" {
 
 typedef uint64_t oc_clock_time_t;
 #define OC_CLOCK_CONF_TICKS_PER_SECOND CLOCKS_PER_SEC
+/* Run timers on CLOCK_MONOTONIC so that changes to the system time neither
+ * fire nor stall them; oc_main_poll() still returns a time of the wall clock */
+//#define OC_CLOCK_MONOTONIC or run "make" with MONOTONIC_CLOCK=1
+/* Read CLOCK_MONOTONIC_COARSE instead, faster but only as precise as a tick
+ * of the kernel */
+//#define OC_CLOCK_MONOTONIC_COARSE or run "make" with MONOTONIC_CLOCK=1 COARSE_CLOCK=1
 //#define OC_SPEC_VER_OIC
 /* Security Layer */
 /* Max inactivity timeout before tearing down DTLS connection */
@@ -19,11 +25,42 @@ typedef uint64_t oc_clock_time_t;
 /* Maximum wait time for select function */
 #define SELECT_TIMEOUT_SEC (1)
 
+/* Use an epoll set instead of select() in the network event thread, with
+ * non-blocking TCP connects and sends */
+//#define OC_EPOLL or run "make" with EPOLL=1
+/* Drain UDP sockets in batches with recvmmsg() */
+//#define OC_RECVMMSG or run "make" with RECVMMSG=1
+/* Collect unicast UDP sends of one oc_main_poll() and flush with sendmmsg() */
+//#define OC_SENDMMSG or run "make" with SENDMMSG=1
+/* Receive unicast UDP on OC_UDP_RECV_SHARDS extra SO_REUSEPORT sockets and
+ * threads per logical device; parsing and handlers stay on the main loop */
+//#define OC_REUSEPORT or run "make" with REUSEPORT=1
+/* Receive UDP through io_uring on the epoll network event thread; requires
+ * OC_EPOLL and OC_DYNAMIC_ALLOCATION */
+//#define OC_IO_URING or run "make" with IO_URING=1
+
 /* Add support for passing network up/down events to the app */
 #define OC_NETWORK_MONITOR
 /* Add support for passing TCP/TLS/DTLS session connection events to the app */
 #define OC_SESSION_EVENTS
 
+/* Parse request and response payloads into a per-payload arena that is
+ * released in one step once the handler returns */
+//#define OC_REP_ARENA or run "make" with REP_ARENA=1
+
+/* Hand received messages to the event loop through a lock-free queue
+ * instead of a mutex protected list, and allocate and release incoming
+ * messages and payload buffers without locking (requires GCC atomic
+ * builtins) */
+//#define OC_LOCKFREE_NETWORK_EVENTS or run "make" with LOCKFREE=1
+/* Let any thread post process events, through a lock-free queue of
+ * OC_PROCESS_EVENT_QUEUE_SIZE events (64 by default) that dynamic builds
+ * extend as needed (requires GCC atomic builtins) */
+//#define OC_LOCKFREE_PROCESS_EVENTS or run "make" with LOCKFREE_PROCESS=1
+
+/* Count the usage of every memory pool, see oc_mem_stats.h */
+//#define OC_MEMORY_STATS or run "make" with MEMSTATS=1
+
 /* Add support for software update */
 //#define OC_SOFTWARE_UPDATE or run "make" with SWUPDATE=1
 /* Add support for the oic.if.create interface in Collections */
@@ -50,6 +87,12 @@ typedef uint64_t oc_clock_time_t;
 #define OC_BYTES_POOL_SIZE (1800)
 #define OC_INTS_POOL_SIZE (100)
 #define OC_DOUBLES_POOL_SIZE (4)
+/* Serve the pools from a buddy allocator instead of compacting them on every
+ * free; sizes are rounded up to a power of two of 8 byte blocks */
+//#define OC_MMEM_BUDDY or run "make" with MMEM_BUDDY=1
+/* Carve every OC_MEMB() pool from one region mapped at startup, backed by
+ * huge pages where available, instead of static arrays */
+//#define OC_MEMB_PREALLOC or run "make" with DYNAMIC=0 PREALLOC=1
 
 /* Server-side parameters */
 /* Maximum number of server resources */
@@ -95,6 +138,9 @@ typedef uint64_t oc_clock_time_t;
 /* Maximum number of callbacks for connection of session */
 #define OC_MAX_SESSION_EVENT_CBS (2)
 
+/* Maximum number of pending work items submitted with oc_submit_work() */
+#define OC_MAX_NUM_WORK_ITEMS (8)
+
 #endif /* !OC_DYNAMIC_ALLOCATION */
 
 /* library features that require persistent storage */
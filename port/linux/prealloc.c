@@ -0,0 +1,72 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "oc_config.h"
+#ifdef OC_MEMB_PREALLOC
+#include "port/oc_log.h"
+#include "port/oc_prealloc.h"
+#include <errno.h>
+#include <sys/mman.h>
+
+/* Size of the huge pages reserved through /proc/sys/vm/nr_hugepages */
+#ifndef OC_PREALLOC_HUGE_PAGE_SIZE
+#define OC_PREALLOC_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+#endif /* !OC_PREALLOC_HUGE_PAGE_SIZE */
+
+/* The pages are populated right away by the calling thread, so that on a
+ * NUMA machine they are placed on the node that thread runs on; start the
+ * stack on a thread bound to the node that will run its event loop.
+ */
+void *
+oc_prealloc_map(size_t size)
+{
+  size_t huge_size = (size + OC_PREALLOC_HUGE_PAGE_SIZE - 1) &
+                     ~(OC_PREALLOC_HUGE_PAGE_SIZE - 1);
+  void *region = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+  region = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+                0);
+  if (region != MAP_FAILED) {
+    OC_DBG("mapped %zu bytes of huge pages for the memory pools", huge_size);
+    return region;
+  }
+  OC_DBG("no reserved huge pages for the memory pools %d", errno);
+#endif /* MAP_HUGETLB */
+
+  /* Fall back to transparent huge pages, where enabled */
+  region = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    OC_ERR("mapping %zu bytes for the memory pools %d", huge_size, errno);
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(region, huge_size, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(region, huge_size, MADV_POPULATE_WRITE) == 0) {
+    return region;
+  }
+#endif /* MADV_POPULATE_WRITE */
+  size_t i;
+  for (i = 0; i < huge_size; i += 4096) {
+    ((volatile char *)region)[i] = 0;
+  }
+  return region;
+}
+#else  /* OC_MEMB_PREALLOC */
+typedef int oc_prealloc_unused_t;
+#endif /* !OC_MEMB_PREALLOC */
@@ -23,6 +23,7 @@
 #include "ipcontext.h"
 #include "messaging/coap/coap.h"
 #include "oc_endpoint.h"
+#include "oc_network_events.h"
 #include "oc_session_events.h"
 #include "port/oc_assert.h"
 #include "util/oc_memb.h"
@@ -32,6 +33,9 @@
 #include <fcntl.h>
 #include <ifaddrs.h>
 #include <net/if.h>
+#ifdef OC_EPOLL
+#include <netinet/tcp.h>
+#endif /* OC_EPOLL */
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -41,24 +45,64 @@
 
 #define TLS_HEADER_SIZE 5
 
-#define DEFAULT_RECEIVE_SIZE                                                   \
-  (COAP_TCP_DEFAULT_HEADER_LEN + COAP_TCP_MAX_EXTENDED_LENGTH_LEN)
-
 #define LIMIT_RETRY_CONNECT 5
 
 #define TCP_CONNECT_TIMEOUT 5
 
+#ifndef OC_TCP_SESSION_HASH_SIZE
+/* Buckets of the session indexes by endpoint and by socket, power of two */
+#define OC_TCP_SESSION_HASH_SIZE (64)
+#endif /* !OC_TCP_SESSION_HASH_SIZE */
+
+#ifdef OC_EPOLL
+#ifndef OC_TCP_MAX_SEND_QUEUE
+/* Messages a session may hold back while its socket is not writable */
+#define OC_TCP_MAX_SEND_QUEUE (8)
+#endif /* !OC_TCP_MAX_SEND_QUEUE */
+#endif /* OC_EPOLL */
+
 typedef struct tcp_session
 {
   struct tcp_session *next;
+  struct tcp_session *endpoint_next; /* bucket chain in sessions_by_endpoint */
+  struct tcp_session *sock_next;     /* bucket chain in sessions_by_sock */
   ip_context_t *dev;
   oc_endpoint_t endpoint;
   int sock;
   tcp_csm_state_t csm_state;
+  /* Frame being received, it is handed to the stack once complete */
+  oc_message_t *rx_message;
+#ifdef OC_EPOLL
+  ip_event_source_t event;
+  /* Copies of outbound data that could not be written yet. The head message
+   * has been sent up to send_offset.
+   */
+  OC_LIST_STRUCT(send_q);
+  size_t send_offset;
+  bool connecting;
+#endif /* OC_EPOLL */
 } tcp_session_t;
 
 OC_LIST(session_list);
 OC_MEMB(tcp_session_s, tcp_session_t, OC_MAX_TCP_PEERS);
+static tcp_session_t *sessions_by_endpoint[OC_TCP_SESSION_HASH_SIZE];
+static tcp_session_t *sessions_by_sock[OC_TCP_SESSION_HASH_SIZE];
+#ifndef OC_EPOLL
+/* Upper bound of the session sockets, limits the scan of the ready fd set */
+static int max_session_sock = -1;
+#endif /* !OC_EPOLL */
+#ifdef OC_EPOLL
+/* Events to wait for on a session. While the network thread is parked data
+ * is not waited for, and a hangup is only reported once. Must be called
+ * with dev->tcp.mutex held.
+ */
+static uint32_t
+session_events(tcp_session_t *session, bool sending)
+{
+  uint32_t events = session->dev->tcp.rx_paused ? EPOLLONESHOT : EPOLLIN;
+  return sending ? events | EPOLLOUT : events;
+}
+#endif /* OC_EPOLL */
 
 static int
 configure_tcp_socket(int sock, struct sockaddr_storage *sock_info)
@@ -140,6 +184,71 @@ get_interface_index(int sock)
   return interface_index;
 }
 
+#ifdef OC_EPOLL
+static int
+add_accept_sock_to_epoll(ip_context_t *dev, int sock,
+                         enum transport_flags flags)
+{
+  ip_event_source_t *source =
+    &dev->tcp.accept_events[dev->tcp.num_accept_events++];
+  source->owner = NULL;
+  return oc_ip_add_event_source(dev, source, IP_EVENT_SOURCE_TCP_ACCEPT, sock,
+                                flags, EPOLLIN);
+}
+
+int
+oc_tcp_add_socks_to_epoll(ip_context_t *dev)
+{
+  int ret = 0;
+  dev->tcp.num_accept_events = 0;
+  ret += add_accept_sock_to_epoll(dev, dev->tcp.server_sock, IPV6 | TCP);
+#ifdef OC_SECURITY
+  ret +=
+    add_accept_sock_to_epoll(dev, dev->tcp.secure_sock, IPV6 | SECURED | TCP);
+#endif /* OC_SECURITY */
+
+#ifdef OC_IPV4
+  ret += add_accept_sock_to_epoll(dev, dev->tcp.server4_sock, IPV4 | TCP);
+#ifdef OC_SECURITY
+  ret +=
+    add_accept_sock_to_epoll(dev, dev->tcp.secure4_sock, IPV4 | SECURED | TCP);
+#endif /* OC_SECURITY */
+#endif /* OC_IPV4 */
+  return ret;
+}
+
+void
+oc_tcp_set_receive_paused(ip_context_t *dev, bool paused)
+{
+  pthread_mutex_lock(&dev->tcp.mutex);
+  dev->tcp.rx_paused = paused;
+  int i;
+  for (i = 0; i < dev->tcp.num_accept_events; i++) {
+    oc_ip_modify_event_source(dev, &dev->tcp.accept_events[i],
+                              paused ? EPOLLONESHOT : EPOLLIN);
+  }
+  tcp_session_t *session = (tcp_session_t *)oc_list_head(session_list);
+  for (; session != NULL; session = session->next) {
+    if (session->dev == dev) {
+      bool sending =
+        session->connecting || oc_list_head(session->send_q) != NULL;
+      oc_ip_modify_event_source(dev, &session->event,
+                                session_events(session, sending));
+    }
+  }
+  pthread_mutex_unlock(&dev->tcp.mutex);
+}
+
+void
+oc_tcp_free_closed_sessions(ip_context_t *dev)
+{
+  tcp_session_t *session;
+  while ((session = (tcp_session_t *)oc_list_pop(dev->tcp.closed_sessions)) !=
+         NULL) {
+    oc_memb_free(&tcp_session_s, session);
+  }
+}
+#else /* OC_EPOLL */
 void
 oc_tcp_add_socks_to_fd_set(ip_context_t *dev)
 {
@@ -156,16 +265,100 @@ oc_tcp_add_socks_to_fd_set(ip_context_t *dev)
 #endif /* OC_IPV4 */
   FD_SET(dev->tcp.connect_pipe[0], &dev->rfds);
 }
+#endif /* !OC_EPOLL */
+
+/* Hashes the fields compared by oc_endpoint_compare() */
+static unsigned
+endpoint_hash(const oc_endpoint_t *endpoint)
+{
+  const uint8_t *address = NULL;
+  size_t i, length = 0;
+  uint16_t port = 0;
+  uint32_t hash = 2166136261u;
+
+  if (endpoint->flags & IPV6) {
+    address = endpoint->addr.ipv6.address;
+    length = sizeof(endpoint->addr.ipv6.address);
+    port = endpoint->addr.ipv6.port;
+  }
+#ifdef OC_IPV4
+  else if (endpoint->flags & IPV4) {
+    address = endpoint->addr.ipv4.address;
+    length = sizeof(endpoint->addr.ipv4.address);
+    port = endpoint->addr.ipv4.port;
+  }
+#endif /* OC_IPV4 */
+
+  for (i = 0; i < length; i++) {
+    hash = (hash ^ address[i]) * 16777619u;
+  }
+  hash = (hash ^ port) * 16777619u;
+  hash = (hash ^ (uint32_t)endpoint->device) * 16777619u;
+  return hash & (OC_TCP_SESSION_HASH_SIZE - 1);
+}
+
+#define SOCK_HASH(sock) ((unsigned)(sock) & (OC_TCP_SESSION_HASH_SIZE - 1))
+
+static void
+index_session(tcp_session_t *session)
+{
+  unsigned e = endpoint_hash(&session->endpoint);
+  session->endpoint_next = sessions_by_endpoint[e];
+  sessions_by_endpoint[e] = session;
+
+  unsigned s = SOCK_HASH(session->sock);
+  session->sock_next = sessions_by_sock[s];
+  sessions_by_sock[s] = session;
+#ifndef OC_EPOLL
+  if (session->sock > max_session_sock) {
+    max_session_sock = session->sock;
+  }
+#endif /* !OC_EPOLL */
+}
+
+static void
+unindex_session(tcp_session_t *session)
+{
+  tcp_session_t **s = &sessions_by_endpoint[endpoint_hash(&session->endpoint)];
+  while (*s && *s != session) {
+    s = &(*s)->endpoint_next;
+  }
+  if (*s) {
+    *s = session->endpoint_next;
+  }
+
+  s = &sessions_by_sock[SOCK_HASH(session->sock)];
+  while (*s && *s != session) {
+    s = &(*s)->sock_next;
+  }
+  if (*s) {
+    *s = session->sock_next;
+  }
+}
 
 static void
 free_tcp_session(tcp_session_t *session)
 {
   oc_list_remove(session_list, session);
+  unindex_session(session);
 
   if (!oc_session_events_is_ongoing()) {
     oc_session_end_event(&session->endpoint);
   }
 
+  oc_message_unref(session->rx_message);
+  session->rx_message = NULL;
+
+#ifdef OC_EPOLL
+  oc_message_t *message;
+  while ((message = (oc_message_t *)oc_list_pop(session->send_q)) != NULL) {
+    oc_message_unref(message);
+  }
+  oc_ip_remove_event_source(session->dev, &session->event);
+  close(session->sock);
+  session->sock = -1;
+  oc_list_add(session->dev->tcp.closed_sessions, session);
+#else  /* OC_EPOLL */
   FD_CLR(session->sock, &session->dev->rfds);
 
   ssize_t len = 0;
@@ -177,18 +370,19 @@ free_tcp_session(tcp_session_t *session)
   close(session->sock);
 
   oc_memb_free(&tcp_session_s, session);
+#endif /* !OC_EPOLL */
 
   OC_DBG("freed TCP session");
 }
 
-static int
+static tcp_session_t *
 add_new_session(int sock, ip_context_t *dev, oc_endpoint_t *endpoint,
                 tcp_csm_state_t state)
 {
   tcp_session_t *session = oc_memb_alloc(&tcp_session_s);
   if (!session) {
     OC_ERR("could not allocate new TCP session object");
-    return -1;
+    return NULL;
   }
 
   endpoint->interface_index = get_interface_index(sock);
@@ -198,8 +392,25 @@ add_new_session(int sock, ip_context_t *dev, oc_endpoint_t *endpoint,
   session->endpoint.next = NULL;
   session->sock = sock;
   session->csm_state = state;
+  session->rx_message = NULL;
+
+#ifdef OC_EPOLL
+  OC_LIST_STRUCT_INIT(session, send_q);
+  session->send_offset = 0;
+  session->connecting = false;
+  session->event.owner = session;
+  if (oc_ip_add_event_source(dev, &session->event, IP_EVENT_SOURCE_TCP_SESSION,
+                             sock, endpoint->flags,
+                             session_events(session, false)) < 0) {
+    oc_memb_free(&tcp_session_s, session);
+    return NULL;
+  }
+#else  /* OC_EPOLL */
+  FD_SET(sock, &dev->rfds);
+#endif /* !OC_EPOLL */
 
   oc_list_add(session_list, session);
+  index_session(session);
 
   if (!(endpoint->flags & SECURED)) {
     oc_session_start_event((oc_endpoint_t *)endpoint);
@@ -207,12 +418,11 @@ add_new_session(int sock, ip_context_t *dev, oc_endpoint_t *endpoint,
 
   OC_DBG("recorded new TCP session");
 
-  return 0;
+  return session;
 }
 
 static int
-accept_new_session(ip_context_t *dev, int fd, fd_set *setfds,
-                   oc_endpoint_t *endpoint)
+accept_new_session(ip_context_t *dev, int fd, oc_endpoint_t *endpoint)
 {
   struct sockaddr_storage receive_from;
   socklen_t receive_len = sizeof(receive_from);
@@ -239,26 +449,22 @@ accept_new_session(ip_context_t *dev, int fd, fd_set *setfds,
 #endif /* !OC_IPV4 */
   }
 
-  FD_CLR(fd, setfds);
-
-  if (add_new_session(new_socket, dev, endpoint, CSM_NONE) < 0) {
+  if (!add_new_session(new_socket, dev, endpoint, CSM_NONE)) {
     OC_ERR("could not record new TCP session");
     close(new_socket);
     return -1;
   }
 
-  FD_SET(new_socket, &dev->rfds);
-
   return 0;
 }
 
 static tcp_session_t *
 find_session_by_endpoint(oc_endpoint_t *endpoint)
 {
-  tcp_session_t *session = oc_list_head(session_list);
+  tcp_session_t *session = sessions_by_endpoint[endpoint_hash(endpoint)];
   while (session != NULL &&
          oc_endpoint_compare(&session->endpoint, endpoint) != 0) {
-    session = session->next;
+    session = session->endpoint_next;
   }
 
   if (!session) {
@@ -277,19 +483,50 @@ find_session_by_endpoint(oc_endpoint_t *endpoint)
   return session;
 }
 
+#ifndef OC_EPOLL
+static tcp_session_t *
+find_session_by_sock(int sock)
+{
+  tcp_session_t *session = sessions_by_sock[SOCK_HASH(sock)];
+  while (session != NULL && session->sock != sock) {
+    session = session->sock_next;
+  }
+  return session;
+}
+
 static tcp_session_t *
 get_ready_to_read_session(fd_set *setfds)
 {
-  tcp_session_t *session = oc_list_head(session_list);
-  while (session != NULL && !FD_ISSET(session->sock, setfds)) {
-    session = session->next;
+  int sock;
+  for (sock = 0; sock <= max_session_sock && sock < FD_SETSIZE; sock++) {
+    if (FD_ISSET(sock, setfds)) {
+      tcp_session_t *session = find_session_by_sock(sock);
+      if (session) {
+        return session;
+      }
+    }
   }
 
-  if (!session) {
-    OC_ERR("could not find any open ready-to-read session");
-    return NULL;
+  OC_ERR("could not find any open ready-to-read session");
+  return NULL;
+}
+#endif /* !OC_EPOLL */
+
+/* Number of leading bytes needed to read the frame length */
+static size_t
+get_header_length(const oc_message_t *message, const oc_endpoint_t *endpoint)
+{
+  if (endpoint->flags & SECURED) {
+    return TLS_HEADER_SIZE;
   }
-  return session;
+
+  uint8_t tcp_len = (COAP_TCP_HEADER_LEN_MASK & message->data[0]) >>
+                    COAP_TCP_HEADER_LEN_POSITION;
+  if (tcp_len < COAP_TCP_EXTENDED_LENGTH_1) {
+    return COAP_TCP_DEFAULT_HEADER_LEN;
+  }
+  return COAP_TCP_DEFAULT_HEADER_LEN +
+         ((size_t)1 << (tcp_len - COAP_TCP_EXTENDED_LENGTH_1));
 }
 
 static size_t
@@ -307,6 +544,129 @@ get_total_length_from_header(oc_message_t *message, oc_endpoint_t *endpoint)
   return total_length;
 }
 
+/* Reads what the socket has into the session's pending frame and delivers
+ * every frame that is complete. Bytes past the end of a frame start the next
+ * one, a partial frame stays with the session until more data arrives. When
+ * message is the only frame completed by this read ADAPTER_STATUS_RECEIVE is
+ * returned and the caller hands it to the stack, other frames are handed to
+ * the stack here to keep them in order.
+ */
+static adapter_receive_state_t
+recv_message_from_session(tcp_session_t *session, oc_message_t *message)
+{
+  if (!session->rx_message) {
+    oc_message_add_ref(message);
+    message->length = 0;
+    session->rx_message = message;
+  }
+  oc_message_t *rx = session->rx_message;
+
+  int count =
+    recv(session->sock, rx->data + rx->length, OC_PDU_SIZE - rx->length, 0);
+  if (count < 0) {
+    OC_ERR("recv error! %d", errno);
+
+    free_tcp_session(session);
+
+    return ADAPTER_STATUS_ERROR;
+  } else if (count == 0) {
+    OC_DBG("peer closed TCP session\n");
+
+    free_tcp_session(session);
+
+    return ADAPTER_STATUS_NONE;
+  }
+
+  OC_DBG("recv(): %d bytes.", count);
+  rx->length += (size_t)count;
+
+  oc_message_t *complete = NULL;
+  while (rx && rx->length >= get_header_length(rx, &session->endpoint)) {
+    size_t total_length = get_total_length_from_header(rx, &session->endpoint);
+    if (total_length > (size_t)OC_PDU_SIZE) {
+      OC_ERR("total receive length(%zu) is bigger than max pdu size(%zu)",
+             total_length, (size_t)OC_PDU_SIZE);
+      goto recv_error;
+    }
+    if (rx->length < total_length) {
+      break;
+    }
+    OC_DBG("tcp packet total length : %zu bytes.", total_length);
+
+    oc_message_t *next = NULL;
+    if (rx->length > total_length) {
+      next = oc_allocate_message();
+      if (!next) {
+        OC_ERR("could not allocate buffer for next TCP frame");
+        oc_message_count_drop(OC_MESSAGE_DROP_NO_BUFFER);
+        goto recv_error;
+      }
+      next->length = rx->length - total_length;
+      memcpy(next->data, rx->data + total_length, next->length);
+      rx->length = total_length;
+    }
+
+    memcpy(&rx->endpoint, &session->endpoint, sizeof(oc_endpoint_t));
+#ifdef OC_SECURITY
+    if (rx->endpoint.flags & SECURED) {
+      rx->encrypted = 1;
+    }
+#endif /* OC_SECURITY */
+
+    if (complete) {
+      oc_network_event(complete);
+    }
+    complete = rx;
+    rx = next;
+  }
+  session->rx_message = rx;
+
+  if (complete == message) {
+    oc_message_unref(message);
+    return ADAPTER_STATUS_RECEIVE;
+  } else if (complete) {
+    oc_network_event(complete);
+  }
+  return ADAPTER_STATUS_NONE;
+
+recv_error:
+  oc_message_unref(complete);
+  session->rx_message = rx;
+  free_tcp_session(session);
+  return ADAPTER_STATUS_ERROR;
+}
+
+#ifdef OC_EPOLL
+adapter_receive_state_t
+oc_tcp_receive_event(ip_context_t *dev, ip_event_source_t *source,
+                     oc_message_t *message)
+{
+  pthread_mutex_lock(&dev->tcp.mutex);
+
+  adapter_receive_state_t ret = ADAPTER_STATUS_ERROR;
+  message->endpoint.device = dev->device;
+
+  if (source->type == IP_EVENT_SOURCE_TCP_ACCEPT) {
+    message->endpoint.flags = source->flags;
+    if (accept_new_session(dev, source->sock, &message->endpoint) < 0) {
+      OC_ERR("accept new session fail");
+    } else {
+      ret = ADAPTER_STATUS_ACCEPT;
+    }
+  } else {
+    tcp_session_t *session = (tcp_session_t *)source->owner;
+    if (session->sock < 0) {
+      OC_DBG("TCP session was closed before its event was handled");
+      ret = ADAPTER_STATUS_NONE;
+    } else {
+      ret = recv_message_from_session(session, message);
+    }
+  }
+
+  pthread_mutex_unlock(&dev->tcp.mutex);
+  return ret;
+}
+#else  /* OC_EPOLL */
 adapter_receive_state_t
 oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 {
@@ -321,7 +681,8 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 
   if (FD_ISSET(dev->tcp.server_sock, fds)) {
     message->endpoint.flags = IPV6 | TCP;
-    if (accept_new_session(dev, dev->tcp.server_sock, fds, &message->endpoint) <
+    FD_CLR(dev->tcp.server_sock, fds);
+    if (accept_new_session(dev, dev->tcp.server_sock, &message->endpoint) <
         0) {
       OC_ERR("accept new session fail");
       ret_with_code(ADAPTER_STATUS_ERROR);
@@ -330,7 +691,8 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_SECURITY
   } else if (FD_ISSET(dev->tcp.secure_sock, fds)) {
     message->endpoint.flags = IPV6 | SECURED | TCP;
-    if (accept_new_session(dev, dev->tcp.secure_sock, fds, &message->endpoint) <
+    FD_CLR(dev->tcp.secure_sock, fds);
+    if (accept_new_session(dev, dev->tcp.secure_sock, &message->endpoint) <
         0) {
       OC_ERR("accept new session fail");
       ret_with_code(ADAPTER_STATUS_ERROR);
@@ -340,8 +702,9 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_IPV4
   } else if (FD_ISSET(dev->tcp.server4_sock, fds)) {
     message->endpoint.flags = IPV4 | TCP;
-    if (accept_new_session(dev, dev->tcp.server4_sock, fds,
-                           &message->endpoint) < 0) {
+    FD_CLR(dev->tcp.server4_sock, fds);
+    if (accept_new_session(dev, dev->tcp.server4_sock, &message->endpoint) <
+        0) {
       OC_ERR("accept new session fail");
       ret_with_code(ADAPTER_STATUS_ERROR);
     }
@@ -349,8 +712,9 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 #ifdef OC_SECURITY
   } else if (FD_ISSET(dev->tcp.secure4_sock, fds)) {
     message->endpoint.flags = IPV4 | SECURED | TCP;
-    if (accept_new_session(dev, dev->tcp.secure4_sock, fds,
-                           &message->endpoint) < 0) {
+    FD_CLR(dev->tcp.secure4_sock, fds);
+    if (accept_new_session(dev, dev->tcp.secure4_sock, &message->endpoint) <
+        0) {
       OC_ERR("accept new session fail");
       ret_with_code(ADAPTER_STATUS_ERROR);
     }
@@ -375,72 +739,245 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
   }
 
   // receive message.
-  size_t total_length = 0;
-  size_t want_read = DEFAULT_RECEIVE_SIZE;
-  message->length = 0;
-  do {
-    int count =
-      recv(session->sock, message->data + message->length, want_read, 0);
-    if (count < 0) {
-      OC_ERR("recv error! %d", errno);
+  int sock = session->sock;
+  ret = recv_message_from_session(session, message);
+  FD_CLR(sock, fds);
 
-      free_tcp_session(session);
+oc_tcp_receive_message_done:
+  pthread_mutex_unlock(&dev->tcp.mutex);
+#undef ret_with_code
+  return ret;
+}
+#endif /* !OC_EPOLL */
 
-      ret_with_code(ADAPTER_STATUS_ERROR);
-    } else if (count == 0) {
-      OC_DBG("peer closed TCP session\n");
+void
+oc_tcp_end_session(ip_context_t *dev, oc_endpoint_t *endpoint)
+{
+  pthread_mutex_lock(&dev->tcp.mutex);
+  tcp_session_t *session = find_session_by_endpoint(endpoint);
+  if (session) {
+    free_tcp_session(session);
+  }
+  pthread_mutex_unlock(&dev->tcp.mutex);
+}
 
-      free_tcp_session(session);
+#ifdef OC_EPOLL
+static tcp_session_t *
+initiate_new_session(ip_context_t *dev, oc_endpoint_t *endpoint,
+                     const struct sockaddr_storage *receiver)
+{
+  int sock = -1;
+  if (endpoint->flags & IPV6) {
+    sock = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+#ifdef OC_IPV4
+  } else if (endpoint->flags & IPV4) {
+    sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+#endif
+  }
 
-      ret_with_code(ADAPTER_STATUS_NONE);
-    }
+  if (sock < 0) {
+    OC_ERR("could not create socket for new TCP session");
+    return NULL;
+  }
 
-    OC_DBG("recv(): %d bytes.", count);
-    message->length += (size_t)count;
-    want_read -= (size_t)count;
-
-    if (total_length == 0) {
-      total_length = get_total_length_from_header(message, &session->endpoint);
-      if (total_length >
-          (unsigned)(OC_MAX_APP_DATA_SIZE + COAP_MAX_HEADER_SIZE)) {
-        OC_ERR("total receive length(%ld) is bigger than max pdu size(%ld)",
-               total_length, (OC_MAX_APP_DATA_SIZE + COAP_MAX_HEADER_SIZE));
-        OC_ERR("It may occur buffer overflow.");
-        ret_with_code(ADAPTER_STATUS_ERROR);
-      }
-      OC_DBG("tcp packet total length : %ld bytes.", total_length);
+  /* Bound the connection attempt, it is otherwise only limited by the
+   * kernel's SYN retries.
+   */
+  unsigned int timeout = TCP_CONNECT_TIMEOUT * 1000;
+  if (setsockopt(sock, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout,
+                 sizeof(timeout)) == -1) {
+    OC_WRN("setting TCP user timeout %d", errno);
+  }
 
-      want_read = total_length - (size_t)count;
-    }
-  } while (total_length > message->length);
+  socklen_t receiver_size = sizeof(*receiver);
+  if (connect(sock, (struct sockaddr *)receiver, receiver_size) < 0 &&
+      errno != EINPROGRESS) {
+    OC_ERR("could not initiate TCP connection %d", errno);
+    close(sock);
+    return NULL;
+  }
 
-  memcpy(&message->endpoint, &session->endpoint, sizeof(oc_endpoint_t));
-#ifdef OC_SECURITY
-  if (message->endpoint.flags & SECURED) {
-    message->encrypted = 1;
+  tcp_session_t *session = add_new_session(sock, dev, endpoint, CSM_SENT);
+  if (!session) {
+    OC_ERR("could not record new TCP session");
+    close(sock);
+    return NULL;
   }
-#endif /* OC_SECURITY */
 
-  FD_CLR(session->sock, fds);
-  ret = ADAPTER_STATUS_RECEIVE;
+  /* Completion of the connect is reported as writability */
+  session->connecting = true;
+  oc_ip_modify_event_source(dev, &session->event,
+                            session_events(session, true));
 
-oc_tcp_receive_message_done:
-  pthread_mutex_unlock(&dev->tcp.mutex);
-#undef ret_with_code
-  return ret;
+  OC_DBG("initiated TCP connection");
+
+  return session;
+}
+
+static void
+complete_connect(tcp_session_t *session)
+{
+  unsigned int timeout = 0;
+  int flags;
+
+  session->connecting = false;
+  if (setsockopt(session->sock, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout,
+                 sizeof(timeout)) == -1) {
+    OC_WRN("resetting TCP user timeout %d", errno);
+  }
+  /* Sends use MSG_DONTWAIT, receives expect a blocking socket */
+  flags = fcntl(session->sock, F_GETFL, 0);
+  if (flags >= 0 && fcntl(session->sock, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+    OC_WRN("restoring blocking mode %d", errno);
+  }
+  OC_DBG("successfully connected TCP session");
+}
+
+/* Writes queued data until the socket would block. Returns -1 if the session
+ * failed and was freed.
+ */
+static int
+flush_send_queue(tcp_session_t *session)
+{
+  oc_message_t *message;
+  while ((message = (oc_message_t *)oc_list_head(session->send_q)) != NULL) {
+    ssize_t send_len =
+      send(session->sock, message->data + session->send_offset,
+           message->length - session->send_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (send_len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+      }
+      OC_WRN("send() returned errno %d", errno);
+      free_tcp_session(session);
+      return -1;
+    }
+    session->send_offset += (size_t)send_len;
+    if (session->send_offset == message->length) {
+      oc_list_remove(session->send_q, message);
+      oc_message_unref(message);
+      session->send_offset = 0;
+    }
+  }
+  return 0;
+}
+
+static int
+queue_message(tcp_session_t *session, const uint8_t *data, size_t length)
+{
+  /* The caller's buffer may be transient, e.g. a TLS record in ssl_send() */
+  oc_message_t *copy = oc_internal_allocate_outgoing_message();
+  if (!copy) {
+    return -1;
+  }
+  memcpy(copy->data, data, length);
+  copy->length = length;
+  oc_list_add(session->send_q, copy);
+  return 0;
 }
 
 void
-oc_tcp_end_session(ip_context_t *dev, oc_endpoint_t *endpoint)
+oc_tcp_send_event(ip_context_t *dev, ip_event_source_t *source)
 {
   pthread_mutex_lock(&dev->tcp.mutex);
-  tcp_session_t *session = find_session_by_endpoint(endpoint);
-  if (session) {
-    free_tcp_session(session);
+
+  tcp_session_t *session = (tcp_session_t *)source->owner;
+  if (session->sock < 0) {
+    goto oc_tcp_send_event_done;
   }
+
+  if (session->connecting) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(session->sock, SOL_SOCKET, SO_ERROR, &error, &len) < 0 ||
+        error != 0) {
+      OC_ERR("could not initiate TCP connection %d", error);
+      free_tcp_session(session);
+      goto oc_tcp_send_event_done;
+    }
+    complete_connect(session);
+  }
+
+  if (flush_send_queue(session) < 0) {
+    goto oc_tcp_send_event_done;
+  }
+  bool sending = oc_list_head(session->send_q) != NULL;
+  /* A parked thread is only told about writability once per modification */
+  if (!sending || dev->tcp.rx_paused) {
+    oc_ip_modify_event_source(dev, &session->event,
+                              session_events(session, sending));
+  }
+
+oc_tcp_send_event_done:
   pthread_mutex_unlock(&dev->tcp.mutex);
 }
 
+int
+oc_tcp_send_buffer(ip_context_t *dev, oc_message_t *message,
+                   const struct sockaddr_storage *receiver)
+{
+  int ret = -1;
+  pthread_mutex_lock(&dev->tcp.mutex);
+  tcp_session_t *session = find_session_by_endpoint(&message->endpoint);
+  if (!session) {
+    session = initiate_new_session(dev, &message->endpoint, receiver);
+    if (!session) {
+      OC_ERR("could not initiate new TCP session");
+      goto oc_tcp_send_buffer_done;
+    }
+  }
+
+  bool queued = (oc_list_head(session->send_q) != NULL);
+  if (oc_list_length(session->send_q) >= OC_TCP_MAX_SEND_QUEUE) {
+    OC_WRN("TCP send queue of session is full");
+    goto oc_tcp_send_buffer_done;
+  }
+
+  size_t bytes_sent = 0;
+  while (!session->connecting && !queued && bytes_sent < message->length) {
+    ssize_t send_len =
+      send(session->sock, message->data + bytes_sent,
+           message->length - bytes_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (send_len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      OC_WRN("send() returned errno %d", errno);
+      goto oc_tcp_send_buffer_done;
+    }
+    bytes_sent += (size_t)send_len;
+  }
+
+  if (bytes_sent < message->length) {
+    if (queue_message(session, message->data + bytes_sent,
+                      message->length - bytes_sent) < 0) {
+      OC_WRN("could not queue TCP message");
+      if (bytes_sent > 0) {
+        /* The stream cannot be resumed in the middle of a message */
+        free_tcp_session(session);
+      }
+      goto oc_tcp_send_buffer_done;
+    }
+    if (!queued && !session->connecting) {
+      oc_ip_modify_event_source(dev, &session->event,
+                                session_events(session, true));
+    }
+    OC_DBG("Queued %zd bytes", message->length - bytes_sent);
+  }
+
+  OC_DBG("Sent %zd bytes", bytes_sent);
+  ret = (int)message->length;
+oc_tcp_send_buffer_done:
+  pthread_mutex_unlock(&dev->tcp.mutex);
+  return ret;
+}
+#else /* OC_EPOLL */
 static int
 get_session_socket(oc_endpoint_t *endpoint)
 {
@@ -558,14 +1095,12 @@ initiate_new_session(ip_context_t *dev, oc_endpoint_t *endpoint,
 
   OC_DBG("successfully initiated TCP connection");
 
-  if (add_new_session(sock, dev, endpoint, CSM_SENT) < 0) {
+  if (!add_new_session(sock, dev, endpoint, CSM_SENT)) {
     OC_ERR("could not record new TCP session");
     close(sock);
     return -1;
   }
 
-  FD_SET(sock, &dev->rfds);
-
   ssize_t len = 0;
   do {
     uint8_t dummy_value = 0xef;
@@ -618,6 +1153,7 @@ oc_tcp_send_buffer_done:
 
   return bytes_sent;
 }
+#endif /* !OC_EPOLL */
 
 #ifdef OC_IPV4
 static int
@@ -694,6 +1230,10 @@ oc_tcp_connectivity_init(ip_context_t *dev)
   if (pthread_mutex_init(&dev->tcp.mutex, NULL) != 0) {
     oc_abort("error initializing TCP adapter mutex");
   }
+#ifdef OC_EPOLL
+  dev->tcp.rx_paused = false;
+  OC_LIST_STRUCT_INIT(&dev->tcp, closed_sessions);
+#endif /* OC_EPOLL */
 
   memset(&dev->tcp.server, 0, sizeof(struct sockaddr_storage));
   struct sockaddr_in6 *l = (struct sockaddr_in6 *)&dev->tcp.server;
@@ -22,7 +22,9 @@
 
 #include "ipcontext.h"
 #include "port/oc_connectivity.h"
+#ifndef OC_EPOLL
 #include <sys/select.h>
+#endif /* !OC_EPOLL */
 
 #ifdef __cplusplus
 extern "C"
@@ -36,12 +38,35 @@ void oc_tcp_connectivity_shutdown(ip_context_t *dev);
 int oc_tcp_send_buffer(ip_context_t *dev, oc_message_t *message,
                        const struct sockaddr_storage *receiver);
 
+#ifdef OC_EPOLL
+int oc_tcp_add_socks_to_epoll(ip_context_t *dev);
+
+adapter_receive_state_t oc_tcp_receive_event(ip_context_t *dev,
+                                             ip_event_source_t *source,
+                                             oc_message_t *message);
+
+/* Completes a pending connect and writes queued data of the session behind
+ * source once its socket is writable.
+ */
+void oc_tcp_send_event(ip_context_t *dev, ip_event_source_t *source);
+
+/* Stops or resumes waiting for connections and data on the TCP sockets of
+ * dev, while its network thread is parked. Queued data is still sent.
+ */
+void oc_tcp_set_receive_paused(ip_context_t *dev, bool paused);
+
+/* Releases sessions closed since the last call. The caller must hold
+ * dev->tcp.mutex, or have already joined the network event thread.
+ */
+void oc_tcp_free_closed_sessions(ip_context_t *dev);
+#else /* OC_EPOLL */
 void oc_tcp_add_socks_to_fd_set(ip_context_t *dev);
 
 void oc_tcp_set_session_fds(fd_set *fds);
 
 adapter_receive_state_t oc_tcp_receive_message(ip_context_t *dev, fd_set *fds,
                                                oc_message_t *message);
+#endif /* !OC_EPOLL */
 
 void oc_tcp_end_session(ip_context_t *dev, oc_endpoint_t *endpoint);
 
@@ -0,0 +1,463 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#define _GNU_SOURCE
+#include "uringadapter.h"
+#include "ipcontext.h"
+#include "oc_buffer.h"
+#include "oc_network_events.h"
+#include "port/oc_log.h"
+#include "util/oc_memb.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef OC_IO_URING
+#include <linux/io_uring.h>
+
+#ifndef OC_URING_RECV_DEPTH
+/* Number of receives kept posted on every UDP socket */
+#define OC_URING_RECV_DEPTH (4)
+#endif /* !OC_URING_RECV_DEPTH */
+
+#ifndef OC_URING_MAX_RECV_ERRORS
+/* Number of receives in a row that may fail before one is no longer posted */
+#define OC_URING_MAX_RECV_ERRORS (8)
+#endif /* !OC_URING_MAX_RECV_ERRORS */
+
+#define OC_URING_NUM_RECVS (OC_UDP_MAX_EVENT_SOURCES * OC_URING_RECV_DEPTH)
+
+/* A receive posted on a UDP socket. The datagram is written by the kernel
+ * straight into message->data, and the completion carries this structure
+ * back as its user_data.
+ *
+ * The message buffers are not registered with IORING_REGISTER_BUFFERS: only
+ * the fixed read opcodes take registered buffers, and a read does not return
+ * the address of the sender of a datagram.
+ */
+typedef struct uring_recv_t
+{
+  ip_event_source_t *source;
+  oc_message_t *message;
+  struct msghdr msg;
+  struct iovec iovec;
+  struct sockaddr_storage client;
+  char control[CMSG_LEN(sizeof(struct sockaddr_storage))];
+  int errors;
+  bool posted;
+} uring_recv_t;
+
+/* The ring is owned by the network event thread of its device, which is the
+ * only submitter and consumer while the thread runs.
+ */
+typedef struct ip_uring_t
+{
+  int ring_fd;
+  int event_fd;
+  void *sq_ring;
+  size_t sq_ring_size;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_entries;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  unsigned to_submit;
+  void *cq_ring;
+  size_t cq_ring_size;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  uring_recv_t recvs[OC_URING_NUM_RECVS];
+  int num_recvs;
+} ip_uring_t;
+
+OC_MEMB(ip_uring_s, ip_uring_t, OC_MAX_NUM_DEVICES);
+
+static int
+uring_setup(ip_uring_t *ring, unsigned entries)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(struct io_uring_params));
+
+  ring->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->ring_fd < 0) {
+    OC_ERR("creating io_uring %d", errno);
+    return -1;
+  }
+
+  ring->sq_ring_size =
+    params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size =
+    params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+      ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                       IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    OC_ERR("mapping io_uring submission queue %d", errno);
+    goto error;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                         IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      OC_ERR("mapping io_uring completion queue %d", errno);
+      munmap(ring->sq_ring, ring->sq_ring_size);
+      goto error;
+    }
+  }
+
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    OC_ERR("mapping io_uring submission entries %d", errno);
+    if (ring->cq_ring != ring->sq_ring) {
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    goto error;
+  }
+
+  char *sq = (char *)ring->sq_ring;
+  ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_entries = (unsigned *)(sq + params.sq_off.ring_entries);
+  ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+  char *cq = (char *)ring->cq_ring;
+  ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  ring->to_submit = 0;
+  return 0;
+
+error:
+  close(ring->ring_fd);
+  return -1;
+}
+
+static void
+uring_release(ip_uring_t *ring)
+{
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->ring_fd);
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(ip_uring_t *ring)
+{
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  unsigned tail = *ring->sq_tail + ring->to_submit;
+  if (tail - head >= *ring->sq_entries) {
+    return NULL;
+  }
+  unsigned index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  ring->sq_array[index] = index;
+  ring->to_submit++;
+  return sqe;
+}
+
+static int
+uring_submit(ip_uring_t *ring, unsigned wait_for)
+{
+  unsigned flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+  if (ring->to_submit == 0 && wait_for == 0) {
+    return 0;
+  }
+  __atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->to_submit,
+                   __ATOMIC_RELEASE);
+  unsigned to_submit = ring->to_submit;
+  ring->to_submit = 0;
+
+  int ret;
+  do {
+    ret = (int)syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, wait_for,
+                       flags, NULL, 0);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    OC_ERR("submitting to io_uring %d", errno);
+  }
+  return ret;
+}
+
+static int
+post_recv(ip_uring_t *ring, uring_recv_t *recv)
+{
+  if (!recv->message) {
+    recv->message = oc_allocate_message();
+    if (!recv->message) {
+      return -1;
+    }
+  }
+  struct io_uring_sqe *sqe = uring_get_sqe(ring);
+  if (!sqe) {
+    return -1;
+  }
+
+  recv->iovec.iov_base = recv->message->data;
+  recv->iovec.iov_len = OC_PDU_SIZE;
+  memset(&recv->msg, 0, sizeof(struct msghdr));
+  recv->msg.msg_name = &recv->client;
+  recv->msg.msg_namelen = sizeof(struct sockaddr_storage);
+  recv->msg.msg_iov = &recv->iovec;
+  recv->msg.msg_iovlen = 1;
+  recv->msg.msg_control = recv->control;
+  recv->msg.msg_controllen = sizeof(recv->control);
+
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = recv->source->sock;
+  sqe->addr = (unsigned long)&recv->msg;
+  sqe->len = 1;
+  sqe->user_data = (unsigned long)recv;
+  recv->posted = true;
+  return 0;
+}
+
+/* Posts every receive that is not in flight, except those that failed too
+ * often. Returns the number that could not be posted for want of a message
+ * buffer.
+ */
+static int
+post_idle_recvs(ip_uring_t *ring)
+{
+  int i, idle = 0;
+  for (i = 0; i < ring->num_recvs; i++) {
+    uring_recv_t *recv = &ring->recvs[i];
+    if (!recv->posted && recv->errors < OC_URING_MAX_RECV_ERRORS &&
+        post_recv(ring, recv) < 0) {
+      idle++;
+    }
+  }
+  return idle;
+}
+
+int
+oc_uring_init(ip_context_t *dev)
+{
+  int i, j;
+  ip_uring_t *ring = (ip_uring_t *)oc_memb_alloc(&ip_uring_s);
+  if (!ring) {
+    OC_ERR("no free io_uring for device %zd", dev->device);
+    return -1;
+  }
+  memset(ring, 0, sizeof(ip_uring_t));
+
+  if (uring_setup(ring, OC_URING_NUM_RECVS) < 0) {
+    oc_memb_free(&ip_uring_s, ring);
+    return -1;
+  }
+
+  ring->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (ring->event_fd < 0) {
+    OC_ERR("creating io_uring eventfd %d", errno);
+    goto error;
+  }
+  if (syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_EVENTFD,
+              &ring->event_fd, 1) < 0) {
+    OC_ERR("registering io_uring eventfd %d", errno);
+    close(ring->event_fd);
+    goto error;
+  }
+  dev->uring_event.owner = ring;
+  if (oc_ip_add_event_source(dev, &dev->uring_event, IP_EVENT_SOURCE_URING,
+                             ring->event_fd, 0, EPOLLIN) < 0) {
+    close(ring->event_fd);
+    goto error;
+  }
+
+  for (i = 0; i < dev->num_udp_events; i++) {
+    for (j = 0; j < OC_URING_RECV_DEPTH; j++) {
+      ring->recvs[ring->num_recvs++].source = &dev->udp_events[i];
+    }
+  }
+  post_idle_recvs(ring);
+  if (uring_submit(ring, 0) < 0) {
+    oc_ip_remove_event_source(dev, &dev->uring_event);
+    close(ring->event_fd);
+    goto error;
+  }
+
+  dev->uring = ring;
+  return 0;
+
+error:
+  for (i = 0; i < ring->num_recvs; i++) {
+    oc_message_unref(ring->recvs[i].message);
+  }
+  uring_release(ring);
+  oc_memb_free(&ip_uring_s, ring);
+  return -1;
+}
+
+void
+oc_uring_receive_event(ip_context_t *dev)
+{
+  ip_uring_t *ring = dev->uring;
+  oc_message_t *batch[OC_URING_NUM_RECVS];
+  size_t num_batch = 0;
+  uint64_t count;
+
+  if (read(ring->event_fd, &count, sizeof(count)) < 0) {
+    // intentionally left blank
+  }
+
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    uring_recv_t *recv = (uring_recv_t *)(uintptr_t)cqe->user_data;
+    oc_message_t *message = recv->message;
+    recv->posted = false;
+
+    if (cqe->res < 0) {
+      if (cqe->res != -ECANCELED) {
+        OC_ERR("io_uring receive returned with an error: %d", -cqe->res);
+        /* A socket that keeps failing would otherwise be polled in a busy
+         * loop */
+        if (++recv->errors == OC_URING_MAX_RECV_ERRORS) {
+          OC_ERR("no longer receiving on socket %d through io_uring",
+                 recv->source->sock);
+        }
+      }
+      continue;
+    }
+    recv->errors = 0;
+
+    message->endpoint.device = dev->device;
+    if (oc_ip_get_endpoint_from_msghdr(&recv->msg, &message->endpoint,
+                                       (recv->source->flags & MULTICAST) !=
+                                         0) < 0) {
+      continue;
+    }
+    recv->message = NULL;
+    message->length = (size_t)cqe->res;
+    message->endpoint.flags = recv->source->flags;
+#ifdef OC_SECURITY
+    if (recv->source->flags & SECURED) {
+      message->encrypted = 1;
+    }
+#endif /* OC_SECURITY */
+
+#ifdef OC_DEBUG
+    PRINT("Incoming message of size %zd bytes from ", message->length);
+    PRINTipaddr(message->endpoint);
+    PRINT("\n\n");
+#endif /* OC_DEBUG */
+
+    batch[num_batch++] = message;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+  oc_network_event_batch(batch, num_batch);
+
+  if (post_idle_recvs(ring) > 0) {
+    /* Out of message buffers; see oc_uring_resume() */
+    oc_ip_park_receive(dev);
+  }
+  uring_submit(ring, 0);
+}
+
+void
+oc_uring_resume(ip_context_t *dev)
+{
+  uint64_t count = 1;
+  /* Have oc_uring_receive_event() post the idle receives */
+  if (dev->uring && write(dev->uring->event_fd, &count, sizeof(count)) < 0) {
+    OC_WRN("cannot signal io_uring eventfd %d", errno);
+  }
+}
+
+void
+oc_uring_shutdown(ip_context_t *dev)
+{
+  ip_uring_t *ring = dev->uring;
+  unsigned in_flight = 0;
+  int i;
+
+  if (!ring) {
+    return;
+  }
+
+  /* The kernel may still write into posted buffers until the receives are
+   * cancelled, so wait for every completion before releasing them.
+   */
+  for (i = 0; i < ring->num_recvs; i++) {
+    if (ring->recvs[i].posted) {
+      struct io_uring_sqe *sqe = uring_get_sqe(ring);
+      if (!sqe) {
+        uring_submit(ring, 0);
+        sqe = uring_get_sqe(ring);
+      }
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = (unsigned long)&ring->recvs[i];
+      sqe->user_data = 0;
+      in_flight++;
+    }
+  }
+  uring_submit(ring, 0);
+
+  while (in_flight > 0) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      if (uring_submit(ring, 1) < 0) {
+        break;
+      }
+      continue;
+    }
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      if (cqe->user_data != 0) {
+        ((uring_recv_t *)(uintptr_t)cqe->user_data)->posted = false;
+        in_flight--;
+      }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  oc_ip_remove_event_source(dev, &dev->uring_event);
+  close(ring->event_fd);
+  uring_release(ring);
+  for (i = 0; i < ring->num_recvs; i++) {
+    oc_message_unref(ring->recvs[i].message);
+  }
+  oc_memb_free(&ip_uring_s, ring);
+  dev->uring = NULL;
+}
+#endif /* OC_IO_URING */
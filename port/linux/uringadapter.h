@@ -0,0 +1,51 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef URING_ADAPTER_H
+#define URING_ADAPTER_H
+
+#include "ipcontext.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Creates the io_uring of dev, posts receives on every socket in
+ * dev->udp_events and registers the completion eventfd with the epoll set.
+ */
+int oc_uring_init(ip_context_t *dev);
+
+/* Hands completed receives to the stack and posts new ones. Called by the
+ * network event thread when the completion eventfd is readable.
+ */
+void oc_uring_receive_event(ip_context_t *dev);
+
+/* Makes the network event thread post the receives that were left idle for
+ * want of message buffers, once it has been woken up from parking.
+ */
+void oc_uring_resume(ip_context_t *dev);
+
+/* Cancels outstanding receives and releases the ring. Must be called after
+ * the network event thread has been joined.
+ */
+void oc_uring_shutdown(ip_context_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* URING_ADAPTER_H */
@@ -89,6 +89,21 @@ void oc_clock_init(void);
  */
 oc_clock_time_t oc_clock_time(void);
 
+/**
+ * Get the current time of a clock that is never set, for timers.
+ *
+ * Unlike oc_clock_time() it does not jump when the system time is changed,
+ * but it only counts from an arbitrary point. Ports that do not define
+ * OC_CLOCK_MONOTONIC use oc_clock_time() instead.
+ *
+ * \return The current monotonic clock time, measured in system ticks.
+ */
+#ifdef OC_CLOCK_MONOTONIC
+oc_clock_time_t oc_clock_time_monotonic(void);
+#else /* OC_CLOCK_MONOTONIC */
+#define oc_clock_time_monotonic() oc_clock_time()
+#endif /* !OC_CLOCK_MONOTONIC */
+
 /**
  * Get the current value of the platform seconds.
  *
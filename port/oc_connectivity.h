@@ -92,6 +92,7 @@ extern "C" {
 struct oc_message_s
 {
   struct oc_message_s *next;
+  struct oc_message_s *prev; /* only maintained on doubly linked lists */
   struct oc_memb *pool;
   oc_endpoint_t endpoint;
   size_t length;
@@ -111,6 +112,17 @@ struct oc_message_s
 
 int oc_send_buffer(oc_message_t *message);
 
+#ifdef OC_SENDMMSG
+/* Queues a unicast message for transmission by the next
+ * oc_flush_send_buffers() call. The adapter holds its own reference to the
+ * message until then. TCP messages are sent right away.
+ */
+int oc_queue_send_buffer(oc_message_t *message);
+
+/* Sends all queued messages, batching those that share a socket */
+void oc_flush_send_buffers(void);
+#endif /* OC_SENDMMSG */
+
 int oc_connectivity_init(size_t device);
 
 void oc_connectivity_shutdown(size_t device);
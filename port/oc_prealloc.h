@@ -0,0 +1,39 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+/**
+  @file
+*/
+#ifndef OC_PREALLOC_H
+#define OC_PREALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Map size bytes of zero-filled memory that stay mapped for the lifetime of
+ * the process, for oc_memb_prealloc() to carve the memory pools from.
+ *
+ * \return The start of the region, or NULL if it could not be mapped.
+ */
+void *oc_prealloc_map(size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_PREALLOC_H */
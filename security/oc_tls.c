@@ -58,7 +58,7 @@
 
 OC_PROCESS(oc_tls_handler, "TLS Process");
 OC_MEMB(tls_peers_s, oc_tls_peer_t, OC_MAX_TLS_PEERS);
-OC_LIST(tls_peers);
+OC_DLIST(tls_peers);
 
 static mbedtls_entropy_context entropy_ctx;
 static mbedtls_ctr_drbg_context ctr_drbg_ctx;
@@ -252,7 +252,7 @@ oc_mbedtls_debug(void *ctx, int level, const char *file, int line,
 static bool
 is_peer_active(oc_tls_peer_t *peer)
 {
-  oc_tls_peer_t *p = (oc_tls_peer_t *)oc_list_head(tls_peers);
+  oc_tls_peer_t *p = (oc_tls_peer_t *)oc_dlist_head(tls_peers);
   while (p != NULL) {
     if (p == peer) {
       return true;
@@ -269,20 +269,20 @@ static void
 oc_tls_free_invalid_peer(oc_tls_peer_t *peer)
 {
   OC_DBG("\noc_tls: removing invalid peer");
-  oc_list_remove(tls_peers, peer);
+  oc_dlist_remove(tls_peers, peer);
 
   oc_ri_remove_timed_event_callback(peer, oc_tls_inactive);
 
   mbedtls_ssl_free(&peer->ssl_ctx);
-  oc_message_t *message = (oc_message_t *)oc_list_pop(peer->send_q);
+  oc_message_t *message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   while (message != NULL) {
     oc_message_unref(message);
-    message = (oc_message_t *)oc_list_pop(peer->send_q);
+    message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   }
-  message = (oc_message_t *)oc_list_pop(peer->recv_q);
+  message = (oc_message_t *)oc_dlist_pop(peer->recv_q);
   while (message != NULL) {
     oc_message_unref(message);
-    message = (oc_message_t *)oc_list_pop(peer->recv_q);
+    message = (oc_message_t *)oc_dlist_pop(peer->recv_q);
   }
 #ifdef OC_PKI
   oc_free_string(&peer->public_key);
@@ -297,7 +297,7 @@ static void
 oc_tls_free_peer(oc_tls_peer_t *peer, bool inactivity_cb)
 {
   OC_DBG("\noc_tls: removing peer");
-  oc_list_remove(tls_peers, peer);
+  oc_dlist_remove(tls_peers, peer);
 #ifdef OC_SERVER
   /* remove all observations by this peer */
   coap_remove_observer_by_client(&peer->endpoint);
@@ -329,15 +329,15 @@ oc_tls_free_peer(oc_tls_peer_t *peer, bool inactivity_cb)
     oc_ri_remove_timed_event_callback(peer, oc_tls_inactive);
   }
   mbedtls_ssl_free(&peer->ssl_ctx);
-  oc_message_t *message = (oc_message_t *)oc_list_pop(peer->send_q);
+  oc_message_t *message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   while (message != NULL) {
     oc_message_unref(message);
-    message = (oc_message_t *)oc_list_pop(peer->send_q);
+    message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   }
-  message = (oc_message_t *)oc_list_pop(peer->recv_q);
+  message = (oc_message_t *)oc_dlist_pop(peer->recv_q);
   while (message != NULL) {
     oc_message_unref(message);
-    message = (oc_message_t *)oc_list_pop(peer->recv_q);
+    message = (oc_message_t *)oc_dlist_pop(peer->recv_q);
   }
 #ifdef OC_PKI
   oc_free_string(&peer->public_key);
@@ -350,7 +350,7 @@ oc_tls_free_peer(oc_tls_peer_t *peer, bool inactivity_cb)
 oc_tls_peer_t *
 oc_tls_get_peer(oc_endpoint_t *endpoint)
 {
-  oc_tls_peer_t *peer = oc_list_head(tls_peers);
+  oc_tls_peer_t *peer = oc_dlist_head(tls_peers);
   while (peer != NULL) {
     if (oc_endpoint_compare(&peer->endpoint, endpoint) == 0) {
       return peer;
@@ -415,7 +415,7 @@ oc_tls_inactive(void *data)
   OC_DBG("oc_tls: DTLS inactivity callback");
   oc_tls_peer_t *peer = (oc_tls_peer_t *)data;
   if (is_peer_active(peer)) {
-    oc_clock_time_t time = oc_clock_time();
+    oc_clock_time_t time = oc_timer_now();
     time -= peer->timestamp;
     if (time < (oc_clock_time_t)OC_DTLS_INACTIVITY_TIMEOUT *
                  (oc_clock_time_t)OC_CLOCK_SECOND) {
@@ -436,7 +436,7 @@ static int
 ssl_recv(void *ctx, unsigned char *buf, size_t len)
 {
   oc_tls_peer_t *peer = (oc_tls_peer_t *)ctx;
-  oc_message_t *message = (oc_message_t *)oc_list_head(peer->recv_q);
+  oc_message_t *message = (oc_message_t *)oc_dlist_head(peer->recv_q);
   if (message) {
     size_t recv_len = 0;
 #ifdef OC_TCP
@@ -446,7 +446,7 @@ ssl_recv(void *ctx, unsigned char *buf, size_t len)
       memcpy(buf, message->data + message->read_offset, recv_len);
       message->read_offset += recv_len;
       if (message->read_offset == message->length) {
-        oc_list_remove(peer->recv_q, message);
+        oc_dlist_remove(peer->recv_q, message);
         oc_message_unref(message);
       }
     } else
@@ -454,7 +454,7 @@ ssl_recv(void *ctx, unsigned char *buf, size_t len)
     {
       recv_len = (message->length < len) ? message->length : len;
       memcpy(buf, message->data, recv_len);
-      oc_list_remove(peer->recv_q, message);
+      oc_dlist_remove(peer->recv_q, message);
       oc_message_unref(message);
     }
     return (int)recv_len;
@@ -466,21 +466,21 @@ static int
 ssl_send(void *ctx, const unsigned char *buf, size_t len)
 {
   oc_tls_peer_t *peer = (oc_tls_peer_t *)ctx;
-  peer->timestamp = oc_clock_time();
+  peer->timestamp = oc_timer_now();
   oc_message_t message;
+  size_t send_len = (len < (unsigned)OC_PDU_SIZE) ? len : (unsigned)OC_PDU_SIZE;
 #ifdef OC_DYNAMIC_ALLOCATION
-  message.data = malloc(OC_PDU_SIZE);
+  message.data = (uint8_t *)oc_buffer_alloc(send_len);
   if (!message.data)
     return 0;
 #endif /* OC_DYNAMIC_ALLOCATION */
   memcpy(&message.endpoint, &peer->endpoint, sizeof(oc_endpoint_t));
-  size_t send_len = (len < (unsigned)OC_PDU_SIZE) ? len : (unsigned)OC_PDU_SIZE;
   memcpy(message.data, buf, send_len);
   message.length = send_len;
   message.encrypted = 1;
   int ret = oc_send_buffer(&message);
 #ifdef OC_DYNAMIC_ALLOCATION
-  free(message.data);
+  oc_buffer_free(message.data);
 #endif /* OC_DYNAMIC_ALLOCATION */
   return ret;
 }
@@ -488,7 +488,7 @@ ssl_send(void *ctx, const unsigned char *buf, size_t len)
 static void
 check_retr_timers(void)
 {
-  oc_tls_peer_t *peer = (oc_tls_peer_t *)oc_list_head(tls_peers), *next;
+  oc_tls_peer_t *peer = (oc_tls_peer_t *)oc_dlist_head(tls_peers), *next;
   while (peer != NULL) {
     next = peer->next;
     if (peer->ssl_ctx.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
@@ -582,7 +582,7 @@ get_psk_cb(void *data, mbedtls_ssl_context *ssl, const unsigned char *identity,
   (void)data;
   (void)identity_len;
   OC_DBG("oc_tls: In PSK callback");
-  oc_tls_peer_t *peer = oc_list_head(tls_peers);
+  oc_tls_peer_t *peer = oc_dlist_head(tls_peers);
   while (peer != NULL) {
     if (&peer->ssl_ctx == ssl) {
       break;
@@ -650,7 +650,7 @@ ssl_get_timer(void *ctx)
     timer->fin_timer.timer.interval = 0;
     timer->int_ticks = 0;
     return 2;
-  } else if (oc_clock_time() >
+  } else if (oc_timer_now() >
              (timer->fin_timer.timer.start + timer->int_ticks)) {
     return 1;
   }
@@ -1310,9 +1310,10 @@ oc_tls_add_peer(oc_endpoint_t *endpoint, int role)
     if (peer) {
       OC_DBG("oc_tls: Allocating new peer");
       memcpy(&peer->endpoint, endpoint, sizeof(oc_endpoint_t));
-      OC_LIST_STRUCT_INIT(peer, recv_q);
-      OC_LIST_STRUCT_INIT(peer, send_q);
+      OC_DLIST_STRUCT_INIT(peer, recv_q);
+      OC_DLIST_STRUCT_INIT(peer, send_q);
       peer->next = 0;
+      peer->prev = 0;
       peer->role = role;
       memset(&peer->timer, 0, sizeof(oc_tls_retr_timer_t));
       mbedtls_ssl_init(&peer->ssl_ctx);
@@ -1362,7 +1363,7 @@ oc_tls_add_peer(oc_endpoint_t *endpoint, int role)
         oc_tls_free_peer(peer, false);
         return NULL;
       }
-      oc_list_add(tls_peers, peer);
+      oc_dlist_add(tls_peers, peer);
 
       if (!(endpoint->flags & TCP)) {
         mbedtls_ssl_set_timer_cb(&peer->ssl_ctx, &peer->timer, ssl_set_timer,
@@ -1380,10 +1381,10 @@ oc_tls_add_peer(oc_endpoint_t *endpoint, int role)
 void
 oc_tls_shutdown(void)
 {
-  oc_tls_peer_t *p = oc_list_pop(tls_peers);
+  oc_tls_peer_t *p = oc_dlist_pop(tls_peers);
   while (p != NULL) {
     oc_tls_free_peer(p, false);
-    p = oc_list_pop(tls_peers);
+    p = oc_dlist_pop(tls_peers);
   }
 #ifdef OC_PKI
   oc_x509_crt_t *cert = (oc_x509_crt_t *)oc_list_pop(identity_certs);
@@ -1662,7 +1663,7 @@ write_application_data(oc_tls_peer_t *peer)
     OC_DBG("oc_tls: write_application_data: Peer not active");
     return;
   }
-  oc_message_t *message = (oc_message_t *)oc_list_pop(peer->send_q);
+  oc_message_t *message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   while (message != NULL) {
     int ret = mbedtls_ssl_write(&peer->ssl_ctx, (unsigned char *)message->data,
                                 message->length);
@@ -1677,7 +1678,7 @@ write_application_data(oc_tls_peer_t *peer)
       oc_tls_free_peer(peer, false);
       break;
     }
-    message = (oc_message_t *)oc_list_pop(peer->send_q);
+    message = (oc_message_t *)oc_dlist_pop(peer->send_q);
   }
 }
 
@@ -1702,7 +1703,7 @@ oc_tls_init_connection(oc_message_t *message)
   }
 
   if (peer) {
-    oc_message_t *duplicate = oc_list_head(peer->send_q);
+    oc_message_t *duplicate = oc_dlist_head(peer->send_q);
     while (duplicate != NULL) {
       if (duplicate == message) {
         break;
@@ -1711,7 +1712,7 @@ oc_tls_init_connection(oc_message_t *message)
     }
     if (duplicate == NULL) {
       oc_message_add_ref(message);
-      oc_list_add(peer->send_q, message);
+      oc_dlist_add(peer->send_q, message);
     }
     int ret = mbedtls_ssl_handshake(&peer->ssl_ctx);
     if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ &&
@@ -1772,6 +1773,30 @@ assert_all_roles_internal(oc_client_response_t *data)
 }
 #endif /* OC_PKI && OC_CLIENT */
 
+/* Returns the buffer that mbedtls_ssl_read() decrypts the next application
+ * record into. mbedTLS copies a datagram into its own record buffer in
+ * ssl_recv() and decrypts it there, after which the received message is no
+ * longer needed. When the next record comes from a fresh datagram, that
+ * message is reused as the output buffer, with a reference taken so it
+ * survives the oc_message_unref() in ssl_recv(), and no second message is
+ * allocated for the plaintext. TLS over TCP may split records across
+ * messages, so it always gets a new buffer.
+ */
+static oc_message_t *
+get_decrypt_buffer(oc_tls_peer_t *peer)
+{
+  oc_message_t *message = (oc_message_t *)oc_dlist_head(peer->recv_q);
+  if (message &&
+#ifdef OC_TCP
+      (message->endpoint.flags & TCP) == 0 &&
+#endif /* OC_TCP */
+      mbedtls_ssl_check_pending(&peer->ssl_ctx) == 0) {
+    oc_message_add_ref(message);
+    return message;
+  }
+  return oc_allocate_message();
+}
+
 static void
 read_application_data(oc_tls_peer_t *peer)
 {
@@ -1851,7 +1876,7 @@ read_application_data(oc_tls_peer_t *peer)
 #endif /* OC_CLIENT */
     }
   } else {
-    oc_message_t *message = oc_allocate_message();
+    oc_message_t *message = get_decrypt_buffer(peer);
     if (message) {
       memcpy(&message->endpoint, &peer->endpoint, sizeof(oc_endpoint_t));
       int ret = mbedtls_ssl_read(&peer->ssl_ctx, message->data, OC_PDU_SIZE);
@@ -1905,8 +1930,8 @@ oc_tls_recv_message(oc_message_t *message)
     OC_DBG("oc_tls: Received message from device %s", u);
 #endif /* OC_DEBUG */
 
-    oc_list_add(peer->recv_q, message);
-    peer->timestamp = oc_clock_time();
+    oc_dlist_add(peer->recv_q, message);
+    peer->timestamp = oc_timer_now();
     oc_tls_handler_schedule_read(peer);
   } else {
     oc_message_unref(message);
@@ -1917,7 +1942,7 @@ static void
 close_all_tls_sessions_for_device(size_t device)
 {
   OC_DBG("oc_tls: closing all open (D)TLS sessions on device %zd", device);
-  oc_tls_peer_t *p = oc_list_head(tls_peers), *next;
+  oc_tls_peer_t *p = oc_dlist_head(tls_peers), *next;
   while (p != NULL) {
     next = p->next;
     if (p->endpoint.device == device) {
@@ -1931,7 +1956,7 @@ static void
 close_all_tls_sessions(void)
 {
   OC_DBG("oc_tls: closing all open (D)TLS sessions on all devices");
-  oc_tls_peer_t *p = oc_list_head(tls_peers), *next;
+  oc_tls_peer_t *p = oc_dlist_head(tls_peers), *next;
   while (p != NULL) {
     next = p->next;
     oc_tls_close_connection(&p->endpoint);
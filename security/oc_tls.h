@@ -43,8 +43,9 @@ typedef struct
 typedef struct oc_tls_peer_t
 {
   struct oc_tls_peer_t *next;
-  OC_LIST_STRUCT(recv_q);
-  OC_LIST_STRUCT(send_q);
+  struct oc_tls_peer_t *prev;
+  OC_DLIST_STRUCT(recv_q);
+  OC_DLIST_STRUCT(send_q);
   mbedtls_ssl_context ssl_ctx;
   mbedtls_ssl_config ssl_conf;
   oc_endpoint_t endpoint;
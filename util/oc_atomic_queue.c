@@ -0,0 +1,98 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#if defined(OC_LOCKFREE_NETWORK_EVENTS) || defined(OC_LOCKFREE_PROCESS_EVENTS)
+#include "oc_atomic_queue.h"
+#include <stdint.h>
+
+/* A cell's sequence is kept relative to its index so that a zeroed queue is
+ * ready for use: cell i is free for the push at position i + sequence and
+ * holds the element for the pop at position i + sequence - 1.
+ */
+bool
+oc_atomic_queue_push(oc_atomic_queue_t *queue, void *data)
+{
+  size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+  oc_atomic_queue_cell_t *cell;
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) +
+                      (pos & queue->mask);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0) {
+      /* The slot is free; claim it unless another producer got there first */
+      if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1,
+                                      true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  cell->data = data;
+  __atomic_store_n(&cell->sequence, pos + 1 - (pos & queue->mask),
+                   __ATOMIC_RELEASE);
+  return true;
+}
+
+void *
+oc_atomic_queue_pop(oc_atomic_queue_t *queue)
+{
+  size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+  oc_atomic_queue_cell_t *cell;
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) +
+                      (pos & queue->mask);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1,
+                                      true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  void *data = cell->data;
+  /* Hand the slot back to producers for the next lap around the ring */
+  __atomic_store_n(&cell->sequence, pos + 1 + queue->mask - (pos & queue->mask),
+                   __ATOMIC_RELEASE);
+  return data;
+}
+
+bool
+oc_atomic_queue_is_empty(oc_atomic_queue_t *queue)
+{
+  return __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE) ==
+         __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE);
+}
+
+size_t
+oc_atomic_queue_length(oc_atomic_queue_t *queue)
+{
+  /* Read the consumer side first, so that the difference cannot be
+   * negative */
+  size_t dequeue_pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE);
+  return __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE) - dequeue_pos;
+}
+#else  /* OC_LOCKFREE_NETWORK_EVENTS || OC_LOCKFREE_PROCESS_EVENTS */
+typedef int oc_atomic_queue_unused_t;
+#endif /* !OC_LOCKFREE_NETWORK_EVENTS && !OC_LOCKFREE_PROCESS_EVENTS */
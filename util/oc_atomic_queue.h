@@ -0,0 +1,80 @@
+/*
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+/**
+ * Bounded lock-free queue of pointers that any number of threads may push
+ * to and pop from concurrently. Each slot carries a sequence number that
+ * tells producers and consumers whether it is theirs to use, so neither
+ * side ever waits on a lock held by the other.
+ *
+ * Queues are declared with OC_ATOMIC_QUEUE() and are ready for use without
+ * further initialization. The size is rounded up to a power of two.
+ */
+
+#ifndef OC_ATOMIC_QUEUE_H
+#define OC_ATOMIC_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+  size_t sequence;
+  void *data;
+} oc_atomic_queue_cell_t;
+
+typedef struct
+{
+  oc_atomic_queue_cell_t *cells;
+  size_t mask;
+  size_t enqueue_pos;
+  size_t dequeue_pos;
+} oc_atomic_queue_t;
+
+/* Smallest power of two not below n, for n up to 65536 */
+#define OC_ATOMIC_QUEUE_CAPACITY(n)                                            \
+  ((n) <= 1 ? 1 : (n) <= 2 ? 2 : (n) <= 4 ? 4 : (n) <= 8 ? 8 : (n) <= 16       \
+    ? 16 : (n) <= 32 ? 32 : (n) <= 64 ? 64 : (n) <= 128 ? 128 : (n) <= 256     \
+    ? 256 : (n) <= 512 ? 512 : (n) <= 1024 ? 1024 : (n) <= 2048 ? 2048        \
+    : (n) <= 4096 ? 4096 : (n) <= 8192 ? 8192 : (n) <= 16384 ? 16384          \
+    : (n) <= 32768 ? 32768 : 65536)
+
+#define OC_ATOMIC_QUEUE(name, size)                                            \
+  static oc_atomic_queue_cell_t name##_cells[OC_ATOMIC_QUEUE_CAPACITY(size)];  \
+  static oc_atomic_queue_t name = { name##_cells,                              \
+                                    OC_ATOMIC_QUEUE_CAPACITY(size) - 1, 0, 0 }
+
+/* Returns false if the queue is full */
+bool oc_atomic_queue_push(oc_atomic_queue_t *queue, void *data);
+
+/* Returns NULL if the queue is empty */
+void *oc_atomic_queue_pop(oc_atomic_queue_t *queue);
+
+/* Also false while a push that has claimed a slot is still in progress */
+bool oc_atomic_queue_is_empty(oc_atomic_queue_t *queue);
+
+/* Number of elements, counting pushes still in progress; only a snapshot
+ * while other threads use the queue */
+size_t oc_atomic_queue_length(oc_atomic_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_ATOMIC_QUEUE_H */
@@ -35,43 +35,182 @@
  */
 
 #include "oc_etimer.h"
+#include "oc_list.h"
 #include "oc_process.h"
+#include <stdbool.h>
 
-static struct oc_etimer *timerlist;
-static oc_clock_time_t next_expiration;
+/* Timers are hashed by expiration time into the slots of a wheel that turns
+   by one slot every OC_ETIMER_WHEEL_TICK. A timer further away than a full
+   turn of the wheel stays in its slot for as many turns as it needs. */
+#ifndef OC_ETIMER_WHEEL_SLOTS
+#define OC_ETIMER_WHEEL_SLOTS (64)
+#endif /* !OC_ETIMER_WHEEL_SLOTS */
+
+#ifndef OC_ETIMER_WHEEL_TICK
+#define OC_ETIMER_WHEEL_TICK                                                   \
+  (OC_CLOCK_SECOND / 8 > 0 ? (oc_clock_time_t)(OC_CLOCK_SECOND / 8) : 1)
+#endif /* !OC_ETIMER_WHEEL_TICK */
+
+static struct oc_dlist wheel[OC_ETIMER_WHEEL_SLOTS];
+/* The slot whose expirations are checked next, and the time it starts at */
+static unsigned short wheel_pos;
+static oc_clock_time_t wheel_time;
+static int num_timers;
+/* The timer that expires first, or NULL if it has to be looked up again */
+static struct oc_etimer *next_timer;
 
 OC_PROCESS(oc_etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+static oc_clock_time_t
+timer_distance(struct oc_etimer *t)
+{
+  /* Must calculate distance to wheel_time due to wraps; it is never later
+     than the current time, so timers that have not expired come after it */
+  if (oc_timer_expired(&t->timer)) {
+    return 0;
+  }
+  return t->timer.start + t->timer.interval - wheel_time;
+}
+/*---------------------------------------------------------------------------*/
 static void
-update_time(void)
+wheel_add(struct oc_etimer *t)
+{
+  oc_clock_time_t distance;
+
+  if (num_timers == 0) {
+    wheel_time = oc_timer_now();
+  }
+  distance = timer_distance(t);
+  t->slot = (unsigned short)((wheel_pos + (distance / OC_ETIMER_WHEEL_TICK) %
+                                            OC_ETIMER_WHEEL_SLOTS) %
+                             OC_ETIMER_WHEEL_SLOTS);
+  oc_dlist_add(&wheel[t->slot], t);
+  if (num_timers++ == 0) {
+    next_timer = t;
+  } else if (next_timer && distance < timer_distance(next_timer)) {
+    next_timer = t;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static bool
+on_wheel(struct oc_etimer *t)
+{
+  struct oc_etimer *s;
+
+  /* A timer that was never set may hold anything, so its links are only
+     trusted once it is found in its slot */
+  if (t->slot >= OC_ETIMER_WHEEL_SLOTS) {
+    return false;
+  }
+  for (s = oc_dlist_head(&wheel[t->slot]); s != NULL; s = s->next) {
+    if (s == t) {
+      return true;
+    }
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_remove(struct oc_etimer *t)
+{
+  if (!on_wheel(t)) {
+    return;
+  }
+  oc_dlist_remove(&wheel[t->slot], t);
+  num_timers--;
+  if (t == next_timer) {
+    next_timer = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_next_timer(void)
 {
-  oc_clock_time_t tdist;
-  oc_clock_time_t now;
   struct oc_etimer *t;
+  oc_clock_time_t distance, next_distance = 0;
+  int i;
 
-  if (timerlist == NULL) {
-    next_expiration = 0;
-  } else {
-    now = oc_clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for (t = t->next; t != NULL; t = t->next) {
-      if (t->timer.start + t->timer.interval - now < tdist) {
-        tdist = t->timer.start + t->timer.interval - now;
+  /* Timers in the slots past the i-th from wheel_pos expire at least
+     i ticks after wheel_time, so the scan stops once none can come first. */
+  for (i = 0; i < OC_ETIMER_WHEEL_SLOTS; i++) {
+    if (next_timer &&
+        next_distance <= (oc_clock_time_t)i * OC_ETIMER_WHEEL_TICK) {
+      break;
+    }
+    t = oc_dlist_head(&wheel[(wheel_pos + i) % OC_ETIMER_WHEEL_SLOTS]);
+    for (; t != NULL; t = t->next) {
+      distance = timer_distance(t);
+      if (!next_timer || distance < next_distance) {
+        next_timer = t;
+        next_distance = distance;
       }
     }
-    next_expiration = now + tdist;
   }
 }
 /*---------------------------------------------------------------------------*/
+static bool
+expire_slot(oc_dlist_t slot)
+{
+  struct oc_etimer *t = oc_dlist_head(slot), *next;
+
+  for (; t != NULL; t = next) {
+    next = t->next;
+    if (!oc_timer_expired(&t->timer)) {
+      continue;
+    }
+    if (oc_process_post(t->p, OC_PROCESS_EVENT_TIMER, t) !=
+        OC_PROCESS_ERR_OK) {
+      return false;
+    }
+    wheel_remove(t);
+    /* Reset the process ID of the event timer, to signal that the
+       etimer has expired. This is later checked in the
+       oc_etimer_expired() function. */
+    t->p = OC_PROCESS_NONE;
+  }
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+static void
+expire_timers(void)
+{
+  oc_clock_time_t now = oc_timer_now(), behind;
+  int i;
+
+  for (i = 0; i < OC_ETIMER_WHEEL_SLOTS; i++) {
+    if (!expire_slot(&wheel[wheel_pos])) {
+      /* The event queue is full, check this slot again on the next poll */
+      oc_etimer_request_poll();
+      return;
+    }
+    if (now - wheel_time < OC_ETIMER_WHEEL_TICK) {
+      return;
+    }
+    wheel_pos = (wheel_pos + 1) % OC_ETIMER_WHEEL_SLOTS;
+    wheel_time += OC_ETIMER_WHEEL_TICK;
+  }
+
+  /* A full turn of the wheel went by since the last poll, so every slot has
+     been checked already; move on to the slot of the current time. */
+  behind = (now - wheel_time) / OC_ETIMER_WHEEL_TICK;
+  wheel_pos =
+    (unsigned short)((wheel_pos + behind % OC_ETIMER_WHEEL_SLOTS) %
+                     OC_ETIMER_WHEEL_SLOTS);
+  wheel_time += behind * OC_ETIMER_WHEEL_TICK;
+}
+/*---------------------------------------------------------------------------*/
 OC_PROCESS_THREAD(oc_etimer_process, ev, data)
 {
-  struct oc_etimer *t, *u;
+  struct oc_etimer *t, *next;
+  int i;
 
   OC_PROCESS_BEGIN();
 
-  timerlist = NULL;
+  for (i = 0; i < OC_ETIMER_WHEEL_SLOTS; i++) {
+    oc_dlist_init(&wheel[i]);
+  }
+  num_timers = 0;
+  next_timer = NULL;
 
   while (1) {
     OC_PROCESS_YIELD();
@@ -79,17 +218,13 @@ OC_PROCESS_THREAD(oc_etimer_process, ev, data)
     if (ev == OC_PROCESS_EVENT_EXITED) {
       struct oc_process *p = data;
 
-      while (timerlist != NULL && timerlist->p == p) {
-        timerlist = timerlist->next;
-      }
-
-      if (timerlist != NULL) {
-        t = timerlist;
-        while (t->next != NULL) {
-          if (t->next->p == p) {
-            t->next = t->next->next;
-          } else
-            t = t->next;
+      for (i = 0; i < OC_ETIMER_WHEEL_SLOTS; i++) {
+        for (t = oc_dlist_head(&wheel[i]); t != NULL; t = next) {
+          next = t->next;
+          if (t->p == p) {
+            wheel_remove(t);
+            t->p = OC_PROCESS_NONE;
+          }
         }
       }
       continue;
@@ -97,32 +232,8 @@ OC_PROCESS_THREAD(oc_etimer_process, ev, data)
       continue;
     }
 
-  again:
-
-    u = NULL;
-
-    for (t = timerlist; t != NULL; t = t->next) {
-      if (oc_timer_expired(&t->timer)) {
-        if (oc_process_post(t->p, OC_PROCESS_EVENT_TIMER, t) ==
-            OC_PROCESS_ERR_OK) {
-
-          /* Reset the process ID of the event timer, to signal that the
-             etimer has expired. This is later checked in the
-             oc_etimer_expired() function. */
-          t->p = OC_PROCESS_NONE;
-          if (u != NULL) {
-            u->next = t->next;
-          } else {
-            timerlist = t->next;
-          }
-          t->next = NULL;
-          update_time();
-          goto again;
-        } else {
-          oc_etimer_request_poll();
-        }
-      }
-      u = t;
+    if (num_timers > 0) {
+      expire_timers();
     }
   }
 
@@ -139,27 +250,14 @@ oc_etimer_request_poll(void)
 static void
 add_timer(struct oc_etimer *timer)
 {
-  struct oc_etimer *t;
-
   oc_etimer_request_poll();
 
+  /* The process ID is only set while the timer is on the wheel */
   if (timer->p != OC_PROCESS_NONE) {
-    for (t = timerlist; t != NULL; t = t->next) {
-      if (t == timer) {
-        /* Timer already on list, bail out. */
-        timer->p = OC_PROCESS_CURRENT();
-        update_time();
-        return;
-      }
-    }
+    wheel_remove(timer);
   }
-
-  /* Timer not on list. */
   timer->p = OC_PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
-
-  update_time();
+  wheel_add(timer);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -196,7 +294,10 @@ void
 oc_etimer_adjust(struct oc_etimer *et, int timediff)
 {
   et->timer.start += timediff;
-  update_time();
+  if (et->p != OC_PROCESS_NONE) {
+    wheel_remove(et);
+    wheel_add(et);
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -220,42 +321,27 @@ oc_etimer_start_time(struct oc_etimer *et)
 int
 oc_etimer_pending(void)
 {
-  return timerlist != NULL;
+  return num_timers > 0;
 }
 /*---------------------------------------------------------------------------*/
 oc_clock_time_t
 oc_etimer_next_expiration_time(void)
 {
-  return oc_etimer_pending() ? next_expiration : 0;
+  if (!oc_etimer_pending()) {
+    return 0;
+  }
+  if (!next_timer) {
+    update_next_timer();
+  }
+  return oc_etimer_expiration_time(next_timer);
 }
 /*---------------------------------------------------------------------------*/
 void
 oc_etimer_stop(struct oc_etimer *et)
 {
-  struct oc_etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if (et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for (t = timerlist; t != NULL && t->next != et; t = t->next)
-      ;
-
-    if (t != NULL) {
-      /* We've found the item before the event timer that we are about
-   to remove. We point the items next pointer to the event after
-   the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
+  if (et->p != OC_PROCESS_NONE) {
+    wheel_remove(et);
   }
-
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = OC_PROCESS_NONE;
 }
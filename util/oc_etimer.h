@@ -72,9 +72,11 @@ extern "C"
  */
 struct oc_etimer
 {
-  struct oc_timer timer;
   struct oc_etimer *next;
+  struct oc_etimer *prev;
+  struct oc_timer timer;
   struct oc_process *p;
+  unsigned short slot;
 };
 
 /**
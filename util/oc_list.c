@@ -301,3 +301,151 @@ oc_list_item_next(void *item)
   return item == NULL ? NULL : ((struct list *)item)->next;
 }
 /*---------------------------------------------------------------------------*/
+struct dlist
+{
+  struct dlist *next;
+  struct dlist *prev;
+};
+
+/*---------------------------------------------------------------------------*/
+/**
+ * Initialize a doubly linked list.
+ *
+ * \param list The list to be initialized.
+ */
+void
+oc_dlist_init(oc_dlist_t list)
+{
+  list->head = NULL;
+  list->tail = NULL;
+  list->length = 0;
+}
+/*---------------------------------------------------------------------------*/
+void *
+oc_dlist_head(oc_dlist_t list)
+{
+  return list->head;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the last element of a doubly linked list, without walking the list.
+ */
+void *
+oc_dlist_tail(oc_dlist_t list)
+{
+  return list->tail;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Insert an item after a specified item on a doubly linked list.
+ *
+ * If previtem is NULL, the new item is placed at the start of the list.
+ * The new item must not be on any doubly linked list.
+ *
+ * \param list The list
+ * \param previtem The item after which the new item should be inserted
+ * \param newitem  The new item that is to be inserted
+ */
+void
+oc_dlist_insert(oc_dlist_t list, void *previtem, void *newitem)
+{
+  struct dlist *prev = previtem, *item = newitem;
+  struct dlist *next = prev ? prev->next : list->head;
+
+  item->prev = prev;
+  item->next = next;
+  if (prev) {
+    prev->next = item;
+  } else {
+    list->head = item;
+  }
+  if (next) {
+    next->prev = item;
+  } else {
+    list->tail = item;
+  }
+  list->length++;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an item at the end of a doubly linked list.
+ *
+ * Like oc_dlist_push(), and unlike oc_list_push(), this does not remove the
+ * item from the list first, so it must not be on any doubly linked list.
+ *
+ * \param list The list.
+ * \param item The item to be added.
+ */
+void
+oc_dlist_add(oc_dlist_t list, void *item)
+{
+  oc_dlist_insert(list, list->tail, item);
+}
+/*---------------------------------------------------------------------------*/
+void
+oc_dlist_push(oc_dlist_t list, void *item)
+{
+  oc_dlist_insert(list, NULL, item);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove a specific element from a doubly linked list.
+ *
+ * Unlike oc_list_remove() this does not search the list, so item must be on
+ * this list if it is on any. An item that was never added, or was removed
+ * already, is left alone.
+ *
+ * \param list The list.
+ * \param item The item that is to be removed from the list.
+ */
+void
+oc_dlist_remove(oc_dlist_t list, void *item)
+{
+  struct dlist *l = item;
+
+  if (l == NULL || (l->prev == NULL && list->head != l)) {
+    return;
+  }
+  if (l->prev) {
+    l->prev->next = l->next;
+  } else {
+    list->head = l->next;
+  }
+  if (l->next) {
+    l->next->prev = l->prev;
+  } else {
+    list->tail = l->prev;
+  }
+  l->next = NULL;
+  l->prev = NULL;
+  list->length--;
+}
+/*---------------------------------------------------------------------------*/
+void *
+oc_dlist_pop(oc_dlist_t list)
+{
+  void *item = list->head;
+  oc_dlist_remove(list, item);
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+void *
+oc_dlist_chop(oc_dlist_t list)
+{
+  void *item = list->tail;
+  oc_dlist_remove(list, item);
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+int
+oc_dlist_length(oc_dlist_t list)
+{
+  return list->length;
+}
+/*---------------------------------------------------------------------------*/
+void *
+oc_dlist_item_prev(void *item)
+{
+  return item == NULL ? NULL : ((struct dlist *)item)->prev;
+}
+/*---------------------------------------------------------------------------*/
@@ -146,6 +146,81 @@ void oc_list_insert(oc_list_t list, void *previtem, void *newitem);
 
 void *oc_list_item_next(void *item);
 
+/**
+ * Declare a doubly linked list.
+ *
+ * Items of a doubly linked list \b must be structures whose first two
+ * elements are the pointers to the next and to the previous item. In exchange
+ * an item is added to either end or removed from any position of the list in
+ * constant time, and the length of the list is kept up to date, so that lists
+ * with many items that come and go should use it. oc_list_item_next() works
+ * on its items as well.
+ *
+ * Unlike oc_list_push(), oc_dlist_add(), oc_dlist_push() and
+ * oc_dlist_insert() do not search the list for the item first, so an item
+ * must not be added while it is already on a doubly linked list.
+ *
+ * The list variable is declared as static, like with OC_LIST().
+ *
+ * \param name The name of the list.
+ */
+#define OC_DLIST(name)                                                         \
+  static struct oc_dlist OC_LIST_CONCAT(name, _dlist) = { 0, 0, 0 };           \
+  static oc_dlist_t name = &OC_LIST_CONCAT(name, _dlist)
+
+/**
+ * Declare a doubly linked list inside a structure declaraction.
+ *
+ * The list must be initialized with OC_DLIST_STRUCT_INIT() before it is used.
+ *
+ * \param name The name of the list.
+ */
+#define OC_DLIST_STRUCT(name)                                                  \
+  struct oc_dlist OC_LIST_CONCAT(name, _dlist);                                \
+  oc_dlist_t name
+
+/**
+ * Initialize a doubly linked list that is part of a structure.
+ *
+ * \param struct_ptr A pointer to the struct
+ * \param name The name of the list.
+ */
+#define OC_DLIST_STRUCT_INIT(struct_ptr, name)                                 \
+  do {                                                                         \
+    (struct_ptr)->name = &((struct_ptr)->OC_LIST_CONCAT(name, _dlist));        \
+    oc_dlist_init((struct_ptr)->name);                                         \
+  } while (0)
+
+struct oc_dlist
+{
+  void *head;
+  void *tail;
+  int length;
+};
+
+/**
+ * The doubly linked list type.
+ *
+ */
+typedef struct oc_dlist *oc_dlist_t;
+
+void oc_dlist_init(oc_dlist_t list);
+void *oc_dlist_head(oc_dlist_t list);
+void *oc_dlist_tail(oc_dlist_t list);
+void *oc_dlist_pop(oc_dlist_t list);
+void oc_dlist_push(oc_dlist_t list, void *item);
+
+void *oc_dlist_chop(oc_dlist_t list);
+
+void oc_dlist_add(oc_dlist_t list, void *item);
+void oc_dlist_remove(oc_dlist_t list, void *item);
+
+int oc_dlist_length(oc_dlist_t list);
+
+void oc_dlist_insert(oc_dlist_t list, void *previtem, void *newitem);
+
+void *oc_dlist_item_prev(void *item);
+
 #ifdef __cplusplus
 }
 #endif
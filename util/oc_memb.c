@@ -40,18 +40,139 @@
 #include "oc_mem_trace.h"
 #endif
 
+#ifdef OC_MEMB_PREALLOC
+#include "port/oc_prealloc.h"
+#endif /* OC_MEMB_PREALLOC */
+
+/*---------------------------------------------------------------------------*/
+static void *
+pop_free_block(struct oc_memb *m)
+{
+  void *ptr = m->free_list;
+  if (ptr) {
+    memcpy(&m->free_list, ptr, sizeof(void *));
+  }
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+push_free_block(struct oc_memb *m, void *ptr)
+{
+  memcpy(ptr, &m->free_list, sizeof(void *));
+  m->free_list = ptr;
+}
+/*---------------------------------------------------------------------------*/
+#ifdef OC_MEMORY_STATS
+static struct oc_memb *memb_stats_list;
+
+static void
+list_memb_stats(struct oc_memb *m)
+{
+  if (!m->name) {
+    return;
+  }
+  /* Pools are only ever added, but those in use by other threads may be
+     added concurrently. */
+#ifdef __GNUC__
+  if (__atomic_exchange_n(&m->stats_listed, true, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+  m->stats_next = __atomic_load_n(&memb_stats_list, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&memb_stats_list, &m->stats_next, m,
+                                      true, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+    ;
+#else  /* __GNUC__ */
+  if (m->stats_listed) {
+    return;
+  }
+  m->stats_listed = true;
+  m->stats_next = memb_stats_list;
+  memb_stats_list = m;
+#endif /* !__GNUC__ */
+}
+
+struct oc_memb *
+oc_memb_stats_head(void)
+{
+#ifdef __GNUC__
+  return __atomic_load_n(&memb_stats_list, __ATOMIC_ACQUIRE);
+#else  /* __GNUC__ */
+  return memb_stats_list;
+#endif /* !__GNUC__ */
+}
+#endif /* OC_MEMORY_STATS */
+/*---------------------------------------------------------------------------*/
+#ifdef OC_MEMB_PREALLOC
+/* Bounds of the oc_memb_pools section, defined by the linker */
+extern struct oc_memb *const __start_oc_memb_pools[];
+extern struct oc_memb *const __stop_oc_memb_pools[];
+
+/* Each pool starts on a cache line of its own */
+#define OC_MEMB_PREALLOC_ALIGN (64)
+
+static size_t prealloc_size;
+
+static size_t
+prealloc_pool_size(const struct oc_memb *m)
+{
+  size_t size = (size_t)m->size * m->num;
+  return (size + OC_MEMB_PREALLOC_ALIGN - 1) &
+         ~((size_t)OC_MEMB_PREALLOC_ALIGN - 1);
+}
+
+size_t
+oc_memb_prealloc(void)
+{
+  struct oc_memb *const *m;
+  size_t size = 0;
+
+  if (prealloc_size > 0) {
+    return prealloc_size;
+  }
+  for (m = __start_oc_memb_pools; m < __stop_oc_memb_pools; m++) {
+    size += prealloc_pool_size(*m);
+  }
+
+  char *region = (char *)oc_prealloc_map(size);
+  if (!region) {
+    OC_ERR("could not map %zu bytes for the memory pools", size);
+    return 0;
+  }
+  for (m = __start_oc_memb_pools; m < __stop_oc_memb_pools; m++) {
+    (*m)->mem = region;
+    region += prealloc_pool_size(*m);
+  }
+  prealloc_size = size;
+  OC_DBG("carved %d memory pools from %zu bytes",
+         (int)(__stop_oc_memb_pools - __start_oc_memb_pools), size);
+  return size;
+}
+#endif /* OC_MEMB_PREALLOC */
 /*---------------------------------------------------------------------------*/
 void
 oc_memb_init(struct oc_memb *m)
 {
+#ifdef OC_DYNAMIC_ALLOCATION
+  void *ptr;
+  while ((ptr = pop_free_block(m)) != NULL) {
+    free(ptr);
+  }
+  m->num_cached = 0;
+#else  /* OC_DYNAMIC_ALLOCATION */
+#ifdef OC_MEMB_PREALLOC
+  if (!m->mem && oc_memb_prealloc() == 0) {
+    return;
+  }
+#endif /* OC_MEMB_PREALLOC */
   if (m->num > 0) {
     memset(m->count, 0, m->num);
-#ifndef OC_DYNAMIC_ALLOCATION
     memset(m->mem, 0, (unsigned)m->size * (unsigned)m->num);
-#else  /* !OC_DYNAMIC_ALLOCATION */
-    memset(m->mem, 0, (unsigned)m->num * sizeof(char *));
-#endif /* OC_DYNAMIC_ALLOCATION */
   }
+  m->free_list = NULL;
+  m->next_unused = 0;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  m->num_used = 0;
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -66,41 +187,73 @@ _oc_memb_alloc(
     return NULL;
   }
 
-  int i = m->num;
+#ifdef OC_MEMORY_STATS
+  list_memb_stats(m);
+#endif /* OC_MEMORY_STATS */
+
   void *ptr = NULL;
-  if (m->num > 0) {
+#ifdef OC_DYNAMIC_ALLOCATION
+  if (m->num > 0 && m->num_used >= m->num) {
+#ifdef OC_MEMORY_STATS
+    m->num_failures++;
+#endif /* OC_MEMORY_STATS */
+    return NULL;
+  }
+  ptr = pop_free_block(m);
+  if (ptr) {
+    m->num_cached--;
+    memset(ptr, 0, m->size);
+  } else {
+    ptr = calloc(1, m->size);
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+#ifdef OC_MEMB_PREALLOC
+  if (!m->mem && oc_memb_prealloc() == 0) {
+    return NULL;
+  }
+#endif /* OC_MEMB_PREALLOC */
+  int i = m->num;
+  if (m->size >= sizeof(void *)) {
+    /* Recycle the most recently freed block, else take the next one that
+       was never used. */
+    ptr = pop_free_block(m);
+    if (ptr) {
+      i = (int)(((char *)ptr - (char *)m->mem) / m->size);
+    } else if (m->next_unused < m->num) {
+      i = m->next_unused++;
+    }
+  } else {
+    /* Blocks too small to hold the free list link are found by scanning */
     for (i = 0; i < m->num; i++) {
       if (m->count[i] == 0) {
-        /* If this block was unused, we increase the reference count to
-     indicate that it now is used and return a pointer to the
-     memory block. */
-        ++(m->count[i]);
         break;
       }
     }
-
-    if (i < m->num) {
-#ifdef OC_DYNAMIC_ALLOCATION
-      ptr = calloc(1, m->size);
-      void *slot = (void *)((char *)m->mem + (i * sizeof(void *)));
-      memcpy(slot, &ptr, sizeof(void *));
-#else  /* OC_DYNAMIC_ALLOCATION */
-      ptr = (void *)((char *)m->mem + (i * m->size));
-      memset(ptr, 0, m->size);
-#endif /* !OC_DYNAMIC_ALLOCATION */
-    }
   }
-#ifdef OC_DYNAMIC_ALLOCATION
-  else {
-    ptr = calloc(1, m->size);
+
+  if (i < m->num) {
+    /* Increase the reference count to indicate that the block is used */
+    ++(m->count[i]);
+    ptr = (void *)((char *)m->mem + (i * m->size));
+    memset(ptr, 0, m->size);
   }
-#endif /* OC_DYNAMIC_ALLOCATION */
+#endif /* !OC_DYNAMIC_ALLOCATION */
 
   if (!ptr) {
     /* No free block was found, so we return NULL to indicate failure to
        allocate block. */
+#ifdef OC_MEMORY_STATS
+    m->num_failures++;
+#endif /* OC_MEMORY_STATS */
     return NULL;
   }
+  m->num_used++;
+#ifdef OC_MEMORY_STATS
+  m->num_allocs++;
+  if (m->num_used > m->peak_used) {
+    m->peak_used = m->num_used;
+  }
+#endif /* OC_MEMORY_STATS */
 
 #ifdef OC_MEMORY_TRACE
   oc_mem_trace_add_pace(func, m->size, MEM_TRACE_ALLOC, ptr);
@@ -121,49 +274,99 @@ _oc_memb_free(
     return -1;
   }
 
+  if (!ptr) {
+    return -1;
+  }
+
 #ifdef OC_MEMORY_TRACE
   oc_mem_trace_add_pace(func, m->size, MEM_TRACE_FREE, ptr);
 #endif
 
-  int i = m->num;
-  char *ptr2 = NULL;
-  if (m->num > 0) {
-    /* Walk through the list of blocks and try to find the block to
-       which the pointer "ptr" points to. */
-    ptr2 = (char *)m->mem;
-    for (i = 0; i < m->num; ++i) {
-#ifdef OC_DYNAMIC_ALLOCATION
-      if (memcmp(ptr2, &ptr, sizeof(void *)) == 0) {
-#else  /* OC_DYNAMIC_ALLOCATION */
-      if (ptr2 == (char *)ptr) {
-#endif /* !OC_DYNAMIC_ALLOCATION */
-        /* We've found to block to which "ptr" points so we decrease the
-           reference count and return the new value of it. */
-        if (m->count[i] > 0) {
-          /* Make sure that we don't deallocate free memory. */
-          --(m->count[i]);
-        }
-        break;
-      }
 #ifdef OC_DYNAMIC_ALLOCATION
-      ptr2 += sizeof(void *);
+  if (m->num_used > 0) {
+    m->num_used--;
+  }
+  if (m->size >= sizeof(void *) && m->num_cached < m->max_cached) {
+    push_free_block(m, ptr);
+    m->num_cached++;
+  } else {
+    free(ptr);
+  }
 #else  /* OC_DYNAMIC_ALLOCATION */
-      ptr2 += m->size;
-#endif /* !OC_DYNAMIC_ALLOCATION */
-    }
+  size_t offset = (size_t)((char *)ptr - (char *)m->mem);
+  if (!oc_memb_inmemb(m, ptr) || offset % m->size != 0) {
+    OC_ERR("pointer does not belong to this oc_memb");
+    return -1;
   }
-#ifdef OC_DYNAMIC_ALLOCATION
-  if (i < m->num) {
-    memset(&ptr2, 0, sizeof(void *));
+  size_t i = offset / m->size;
+  if (m->count[i] == 0) {
+    /* Make sure that we don't deallocate free memory. */
+    return -1;
+  }
+  --(m->count[i]);
+  m->num_used--;
+  if (m->size >= sizeof(void *)) {
+    push_free_block(m, ptr);
   }
-  free(ptr);
-#endif /* OC_DYNAMIC_ALLOCATION */
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
   if (m->buffers_avail_cb) {
     m->buffers_avail_cb(oc_memb_numfree(m));
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+void
+oc_memb_count_alloc(struct oc_memb *m, const void *ptr)
+{
+#ifdef OC_MEMORY_STATS
+  list_memb_stats(m);
+#endif /* OC_MEMORY_STATS */
+#ifdef __GNUC__
+  if (!ptr) {
+#ifdef OC_MEMORY_STATS
+    __atomic_add_fetch(&m->num_failures, 1, __ATOMIC_RELAXED);
+#endif /* OC_MEMORY_STATS */
+    return;
+  }
+  size_t used = __atomic_add_fetch(&m->num_used, 1, __ATOMIC_RELAXED);
+#ifdef OC_MEMORY_STATS
+  __atomic_add_fetch(&m->num_allocs, 1, __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n(&m->peak_used, __ATOMIC_RELAXED);
+  while (used > peak &&
+         !__atomic_compare_exchange_n(&m->peak_used, &peak, used, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+#else  /* OC_MEMORY_STATS */
+  (void)used;
+#endif /* !OC_MEMORY_STATS */
+#else  /* __GNUC__ */
+  if (!ptr) {
+#ifdef OC_MEMORY_STATS
+    m->num_failures++;
+#endif /* OC_MEMORY_STATS */
+    return;
+  }
+  m->num_used++;
+#ifdef OC_MEMORY_STATS
+  m->num_allocs++;
+  if (m->num_used > m->peak_used) {
+    m->peak_used = m->num_used;
+  }
+#endif /* OC_MEMORY_STATS */
+#endif /* !__GNUC__ */
+}
+/*---------------------------------------------------------------------------*/
+void
+oc_memb_count_free(struct oc_memb *m)
+{
+#ifdef __GNUC__
+  __atomic_sub_fetch(&m->num_used, 1, __ATOMIC_RELAXED);
+#else  /* __GNUC__ */
+  m->num_used--;
+#endif /* !__GNUC__ */
+}
+/*---------------------------------------------------------------------------*/
 int oc_memb_inmemb(struct oc_memb * m, void *ptr)
 {
   return (char *)ptr >= (char *)m->mem &&
@@ -173,16 +376,10 @@ int oc_memb_inmemb(struct oc_memb * m, void *ptr)
 int
 oc_memb_numfree(struct oc_memb *m)
 {
-  int i;
-  int num_free = 0;
-
-  for (i = 0; i < m->num; ++i) {
-    if (m->count[i] == 0) {
-      ++num_free;
-    }
+  if (m->num_used >= m->num) {
+    return 0;
   }
-
-  return num_free;
+  return (int)(m->num - m->num_used);
 }
 /*---------------------------------------------------------------------------*/
 void oc_memb_set_buffers_avail_cb(struct oc_memb * m,
@@ -48,6 +48,16 @@
 #define OC_MEMB_H
 
 #include "oc_config.h"
+#ifdef OC_MEMB_PREALLOC
+#ifdef OC_DYNAMIC_ALLOCATION
+#error "OC_MEMB_PREALLOC requires a build without OC_DYNAMIC_ALLOCATION"
+#endif /* OC_DYNAMIC_ALLOCATION */
+#include <stddef.h>
+#endif /* OC_MEMB_PREALLOC */
+#ifdef OC_MEMORY_STATS
+#include <stdbool.h>
+#include <stdint.h>
+#endif /* OC_MEMORY_STATS */
 
 #ifdef __cplusplus
 extern "C"
@@ -93,23 +103,66 @@ extern "C"
 extern "C"
 {
 #endif
+#ifndef OC_MEMB_CACHE_SIZE
+/**
+ * Number of freed blocks each pool declared with OC_MEMB() keeps for reuse
+ * instead of returning them to the C library.
+ */
+#define OC_MEMB_CACHE_SIZE (16)
+#endif /* !OC_MEMB_CACHE_SIZE */
 #define OC_MEMB(name, structure, num)                                          \
-  static struct oc_memb name = { sizeof(structure), 0, 0, 0, 0 }
+  static struct oc_memb name = OC_MEMB_NAMED_INIT(                            \
+    name, sizeof(structure), 0, 0, 0, OC_MEMB_CACHE_SIZE)
 #define OC_MEMB_FIXED(name, structure, num)                                    \
+  static struct oc_memb name = OC_MEMB_NAMED_INIT(                            \
+    name, sizeof(structure), num, 0, 0, OC_MEMB_CACHE_SIZE)
+#elif defined(OC_MEMB_PREALLOC)
+/* The blocks are carved by oc_memb_prealloc(), which finds every pool through
+ * the pointer placed in the oc_memb_pools section.
+ */
+#define OC_MEMB(name, structure, num)                                          \
   static char CC_CONCAT(name, _memb_count)[num];                               \
-  static void *CC_CONCAT(name, _memb_mem)[num];                                \
-  static struct oc_memb name = { sizeof(structure), num,                       \
-                                 CC_CONCAT(name, _memb_count),                 \
-                                 (void *)CC_CONCAT(name, _memb_mem), 0 }
+  static struct oc_memb name = OC_MEMB_NAMED_INIT(                            \
+    name, sizeof(structure), num, CC_CONCAT(name, _memb_count), 0, 0);         \
+  static struct oc_memb *const CC_CONCAT(name, _memb_prealloc)                 \
+    __attribute__((used, section("oc_memb_pools"))) = &name
 #else /* OC_DYNAMIC_ALLOCATION */
 #define OC_MEMB(name, structure, num)                                          \
   static char CC_CONCAT(name, _memb_count)[num];                               \
   static structure CC_CONCAT(name, _memb_mem)[num];                            \
-  static struct oc_memb name = { sizeof(structure), num,                       \
-                                 CC_CONCAT(name, _memb_count),                 \
-                                 (void *)CC_CONCAT(name, _memb_mem), 0 }
+  static struct oc_memb name =                                                 \
+    OC_MEMB_NAMED_INIT(name, sizeof(structure), num,                           \
+                       CC_CONCAT(name, _memb_count),                           \
+                       (void *)CC_CONCAT(name, _memb_mem), 0)
 #endif /* !OC_DYNAMIC_ALLOCATION */
 
+/**
+ * Initializer of a struct oc_memb.
+ *
+ * Pools that live on the stack must pass 0 for max_cached, as blocks cached
+ * by the pool are lost with it.
+ */
+#ifdef OC_MEMORY_STATS
+#define OC_MEMB_INIT(size, num, count, mem, max_cached)                        \
+  OC_MEMB_NAMED_INIT_(0, size, num, count, mem, max_cached)
+/* Pools declared with OC_MEMB() carry their name and are listed by
+ * oc_mem_stats_iterate() from their first allocation on. */
+#define OC_MEMB_NAMED_INIT(name, size, num, count, mem, max_cached)            \
+  OC_MEMB_NAMED_INIT_(#name, size, num, count, mem, max_cached)
+#define OC_MEMB_NAMED_INIT_(name, size, num, count, mem, max_cached)           \
+  {                                                                            \
+    (size), (num), (count), (mem), 0, 0, 0, 0, 0, (max_cached), (name), 0, 0, \
+      0, 0, 0                                                                  \
+  }
+#else /* OC_MEMORY_STATS */
+#define OC_MEMB_INIT(size, num, count, mem, max_cached)                        \
+  {                                                                            \
+    (size), (num), (count), (mem), 0, 0, 0, 0, 0, (max_cached)                 \
+  }
+#define OC_MEMB_NAMED_INIT(name, size, num, count, mem, max_cached)            \
+  OC_MEMB_INIT(size, num, count, mem, max_cached)
+#endif /* !OC_MEMORY_STATS */
+
 typedef void (*oc_memb_buffers_avail_callback_t)(int);
 
 struct oc_memb
@@ -119,6 +172,19 @@ struct oc_memb
   char *count;
   void *mem;
   oc_memb_buffers_avail_callback_t buffers_avail_cb;
+  void *free_list; /* free blocks, linked through their first bytes */
+  size_t num_used;
+  unsigned short next_unused; /* static: blocks from here on are unused */
+  unsigned short num_cached;  /* dynamic: blocks held on free_list */
+  unsigned short max_cached;  /* dynamic: limit of num_cached */
+#ifdef OC_MEMORY_STATS
+  const char *name;            /* NULL for pools that are not listed */
+  struct oc_memb *stats_next;  /* next listed pool */
+  bool stats_listed;
+  size_t peak_used;
+  uint32_t num_allocs;
+  uint32_t num_failures;
+#endif /* OC_MEMORY_STATS */
 };
 
 /**
@@ -157,6 +223,25 @@ char _oc_memb_free(
 #endif
   struct oc_memb *m, void *ptr);
 
+/**
+ * Count a block of m that the caller handed out itself instead of through
+ * oc_memb_alloc(), e.g. from a lock-free free list, so that the usage of
+ * the pool stays accurate. The counters are updated atomically, so that
+ * several threads may do so at once.
+ *
+ * \param m The memory block the block belongs to.
+ *
+ * \param ptr The block, or NULL to count a failed allocation.
+ */
+void oc_memb_count_alloc(struct oc_memb *m, const void *ptr);
+
+/**
+ * Count the release of a block counted with oc_memb_count_alloc().
+ *
+ * \param m The memory block the block belongs to.
+ */
+void oc_memb_count_free(struct oc_memb *m);
+
 #ifdef OC_MEMORY_TRACE
 #define oc_memb_alloc(m) (void *)_oc_memb_alloc(__func__, m)
 #define oc_memb_free(m, ptr) (char)_oc_memb_free(__func__, m, ptr)
@@ -172,6 +257,28 @@ int oc_memb_inmemb(struct oc_memb *m, void *ptr);
 
 int oc_memb_numfree(struct oc_memb *m);
 
+#ifdef OC_MEMB_PREALLOC
+/**
+ * Carve the blocks of every pool declared with OC_MEMB() from a single
+ * region obtained through oc_prealloc_map(), sized from the configured
+ * limits the pools were declared with.
+ *
+ * oc_main_init() calls it first thing; allocations that come earlier
+ * call it themselves. Later calls return at once.
+ *
+ * \return The size of the region in bytes, or 0 if it could not be mapped.
+ */
+size_t oc_memb_prealloc(void);
+#endif /* OC_MEMB_PREALLOC */
+
+#ifdef OC_MEMORY_STATS
+/**
+ * Returns the first pool with allocation statistics; the others follow
+ * through stats_next.
+ */
+struct oc_memb *oc_memb_stats_head(void);
+#endif /* OC_MEMORY_STATS */
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,12 +36,26 @@
 #include "oc_config.h"
 #include "oc_list.h"
 #include "port/oc_log.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #ifdef OC_MEMORY_TRACE
 #include "oc_mem_trace.h"
-#include <stdbool.h>
 #endif
+#ifdef OC_MEMORY_STATS
+#include "oc_mem_stats.h"
+
+typedef struct
+{
+  size_t in_use;
+  size_t peak;
+  uint32_t allocs;
+  uint32_t failures;
+} oc_mmem_stats_t;
+
+/* Usage of each pool, counted in elements */
+static oc_mmem_stats_t mmem_stats[DOUBLE_POOL + 1];
+#endif /* OC_MEMORY_STATS */
 
 #ifndef OC_DYNAMIC_ALLOCATION
 #if !defined(OC_BYTES_POOL_SIZE) || !defined(OC_INTS_POOL_SIZE) ||             \
@@ -52,11 +66,252 @@
 static double doubles[OC_DOUBLES_POOL_SIZE];
 static int64_t ints[OC_INTS_POOL_SIZE];
 static unsigned char bytes[OC_BYTES_POOL_SIZE];
+
+#ifdef OC_MMEM_BUDDY
+/* Binary buddy allocator over the pool arrays. Blocks are never moved, so
+ * both alloc and free are O(log pool size) and no oc_mmem is rewritten when
+ * another one is freed. Requests are rounded up to a power of two number of
+ * OC_MMEM_BLOCK_SIZE blocks.
+ */
+#define OC_MMEM_BLOCK_SIZE (8)
+#define OC_MMEM_MAX_ORDER (15)
+#define OC_MMEM_NO_BLOCK (0xffff)
+
+#define BYTES_POOL_BLOCKS (OC_BYTES_POOL_SIZE / OC_MMEM_BLOCK_SIZE)
+#define INTS_POOL_BLOCKS                                                       \
+  (OC_INTS_POOL_SIZE * sizeof(int64_t) / OC_MMEM_BLOCK_SIZE)
+#define DOUBLES_POOL_BLOCKS                                                    \
+  (OC_DOUBLES_POOL_SIZE * sizeof(double) / OC_MMEM_BLOCK_SIZE)
+
+#if (OC_BYTES_POOL_SIZE / OC_MMEM_BLOCK_SIZE >= OC_MMEM_NO_BLOCK) ||           \
+  (OC_INTS_POOL_SIZE >= OC_MMEM_NO_BLOCK) ||                                   \
+  (OC_DOUBLES_POOL_SIZE >= OC_MMEM_NO_BLOCK)
+#error "Pool sizes are too large for OC_MMEM_BUDDY"
+#endif /* ...POOL_SIZE */
+
+/* Header written into the first bytes of every free block */
+typedef struct
+{
+  uint16_t next;
+  uint16_t prev;
+  uint8_t order;
+} oc_mmem_free_block_t;
+
+typedef struct
+{
+  unsigned char *base;
+  size_t elem_size;
+  unsigned int num_blocks;
+  uint8_t *free_map;
+  uint16_t free_lists[OC_MMEM_MAX_ORDER + 1];
+} oc_mmem_buddy_pool_t;
+
+static uint8_t bytes_free_map[BYTES_POOL_BLOCKS / 8 + 1];
+static uint8_t ints_free_map[INTS_POOL_BLOCKS / 8 + 1];
+static uint8_t doubles_free_map[DOUBLES_POOL_BLOCKS / 8 + 1];
+
+/* Indexed by pool */
+static oc_mmem_buddy_pool_t buddy_pools[] = {
+  { bytes, sizeof(uint8_t), BYTES_POOL_BLOCKS, bytes_free_map, { 0 } },
+  { (unsigned char *)ints, sizeof(int64_t), INTS_POOL_BLOCKS, ints_free_map,
+    { 0 } },
+  { (unsigned char *)doubles, sizeof(double), DOUBLES_POOL_BLOCKS,
+    doubles_free_map, { 0 } }
+};
+
+static void
+read_free_block(oc_mmem_buddy_pool_t *p, unsigned int block,
+                oc_mmem_free_block_t *fb)
+{
+  memcpy(fb, p->base + block * OC_MMEM_BLOCK_SIZE, sizeof(*fb));
+}
+
+static void
+write_free_block(oc_mmem_buddy_pool_t *p, unsigned int block,
+                 const oc_mmem_free_block_t *fb)
+{
+  memcpy(p->base + block * OC_MMEM_BLOCK_SIZE, fb, sizeof(*fb));
+}
+
+static bool
+is_free_block(oc_mmem_buddy_pool_t *p, unsigned int block)
+{
+  return (p->free_map[block / 8] & (1 << (block % 8))) != 0;
+}
+
+static void
+push_free_block(oc_mmem_buddy_pool_t *p, unsigned int block,
+                unsigned int order)
+{
+  oc_mmem_free_block_t fb = { p->free_lists[order], OC_MMEM_NO_BLOCK,
+                              (uint8_t)order };
+  write_free_block(p, block, &fb);
+  if (fb.next != OC_MMEM_NO_BLOCK) {
+    oc_mmem_free_block_t head;
+    read_free_block(p, fb.next, &head);
+    head.prev = (uint16_t)block;
+    write_free_block(p, fb.next, &head);
+  }
+  p->free_lists[order] = (uint16_t)block;
+  p->free_map[block / 8] |= (uint8_t)(1 << (block % 8));
+}
+
+static void
+remove_free_block(oc_mmem_buddy_pool_t *p, unsigned int block,
+                  const oc_mmem_free_block_t *fb)
+{
+  oc_mmem_free_block_t link;
+  if (fb->prev != OC_MMEM_NO_BLOCK) {
+    read_free_block(p, fb->prev, &link);
+    link.next = fb->next;
+    write_free_block(p, fb->prev, &link);
+  } else {
+    p->free_lists[fb->order] = fb->next;
+  }
+  if (fb->next != OC_MMEM_NO_BLOCK) {
+    read_free_block(p, fb->next, &link);
+    link.prev = fb->prev;
+    write_free_block(p, fb->next, &link);
+  }
+  p->free_map[block / 8] &= (uint8_t) ~(1 << (block % 8));
+}
+
+static unsigned int
+get_block_order(oc_mmem_buddy_pool_t *p, size_t size)
+{
+  size_t num_blocks =
+    (size * p->elem_size + OC_MMEM_BLOCK_SIZE - 1) / OC_MMEM_BLOCK_SIZE;
+  unsigned int order = 0;
+  while (((size_t)1 << order) < num_blocks) {
+    order++;
+  }
+  return order;
+}
+
+static void *
+buddy_alloc(pool pool_type, size_t size)
+{
+  oc_mmem_buddy_pool_t *p = &buddy_pools[pool_type];
+  unsigned int order = get_block_order(p, size);
+  unsigned int o = order;
+  while (o <= OC_MMEM_MAX_ORDER && p->free_lists[o] == OC_MMEM_NO_BLOCK) {
+    o++;
+  }
+  if (o > OC_MMEM_MAX_ORDER) {
+    return NULL;
+  }
+  unsigned int block = p->free_lists[o];
+  oc_mmem_free_block_t fb;
+  read_free_block(p, block, &fb);
+  remove_free_block(p, block, &fb);
+  /* Hand the upper halves of a larger block back to the lower orders */
+  while (o > order) {
+    o--;
+    push_free_block(p, block + (1u << o), o);
+  }
+  return p->base + block * OC_MMEM_BLOCK_SIZE;
+}
+
+/* Whether block lies within a free block, whose head is the block rounded
+ * down to its order */
+static bool
+is_in_free_block(oc_mmem_buddy_pool_t *p, unsigned int block)
+{
+  unsigned int order;
+  for (order = 0; order <= OC_MMEM_MAX_ORDER; order++) {
+    unsigned int head = block & ~((1u << order) - 1);
+    if (is_free_block(p, head)) {
+      oc_mmem_free_block_t fb;
+      read_free_block(p, head, &fb);
+      return block < head + (1u << fb.order);
+    }
+  }
+  return false;
+}
+
+/* Checks that ptr is an allocated block of the pool before it is freed */
+static bool
+buddy_is_allocated(pool pool_type, void *ptr, size_t size)
+{
+  if (pool_type > DOUBLE_POOL) {
+    return false;
+  }
+  oc_mmem_buddy_pool_t *p = &buddy_pools[pool_type];
+  unsigned char *c = (unsigned char *)ptr;
+  if (c < p->base || c >= p->base + p->num_blocks * OC_MMEM_BLOCK_SIZE ||
+      (size_t)(c - p->base) % OC_MMEM_BLOCK_SIZE != 0) {
+    OC_ERR("freeing a pointer that is not a block of the pool");
+    return false;
+  }
+  unsigned int block = (unsigned int)((c - p->base) / OC_MMEM_BLOCK_SIZE);
+  unsigned int order = get_block_order(p, size);
+  if ((block & ((1u << order) - 1)) != 0 ||
+      block + (1u << order) > p->num_blocks) {
+    OC_ERR("freeing a block with a wrong size");
+    return false;
+  }
+  if (is_in_free_block(p, block)) {
+    OC_ERR("freeing a block that is already free");
+    return false;
+  }
+  return true;
+}
+
+static void
+buddy_free(pool pool_type, void *ptr, size_t size)
+{
+  oc_mmem_buddy_pool_t *p = &buddy_pools[pool_type];
+  unsigned int block =
+    (unsigned int)(((unsigned char *)ptr - p->base) / OC_MMEM_BLOCK_SIZE);
+  unsigned int order = get_block_order(p, size);
+  while (order < OC_MMEM_MAX_ORDER) {
+    unsigned int buddy = block ^ (1u << order);
+    oc_mmem_free_block_t fb;
+    if (buddy + (1u << order) > p->num_blocks || !is_free_block(p, buddy)) {
+      break;
+    }
+    read_free_block(p, buddy, &fb);
+    if (fb.order != order) {
+      break;
+    }
+    remove_free_block(p, buddy, &fb);
+    if (buddy < block) {
+      block = buddy;
+    }
+    order++;
+  }
+  push_free_block(p, block, order);
+}
+
+static void
+buddy_init(void)
+{
+  size_t i;
+  for (i = 0; i < sizeof(buddy_pools) / sizeof(buddy_pools[0]); i++) {
+    oc_mmem_buddy_pool_t *p = &buddy_pools[i];
+    unsigned int order, block = 0;
+    for (order = 0; order <= OC_MMEM_MAX_ORDER; order++) {
+      p->free_lists[order] = OC_MMEM_NO_BLOCK;
+    }
+    /* Carve the pool into the largest aligned blocks that fit */
+    while (block < p->num_blocks) {
+      order = OC_MMEM_MAX_ORDER;
+      while ((block & ((1u << order) - 1)) != 0 ||
+             block + (1u << order) > p->num_blocks) {
+        order--;
+      }
+      push_free_block(p, block, order);
+      block += 1u << order;
+    }
+  }
+}
+#else  /* OC_MMEM_BUDDY */
 static unsigned int avail_bytes, avail_ints, avail_doubles;
 
 OC_LIST(bytes_list);
 OC_LIST(ints_list);
 OC_LIST(doubles_list);
+#endif /* !OC_MMEM_BUDDY */
 #else /* !OC_DYNAMIC_ALLOCATION */
 #include <stdlib.h>
 #endif /* OC_DYNAMIC_ALLOCATION */
@@ -82,9 +337,22 @@ _oc_mmem_alloc(
 #ifdef OC_DYNAMIC_ALLOCATION
     m->ptr = malloc(size);
     m->size = size;
+#elif defined(OC_MMEM_BUDDY)
+    m->ptr = buddy_alloc(BYTE_POOL, size);
+    if (!m->ptr) {
+      OC_WRN("byte pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
+      return 0;
+    }
+    m->size = size;
 #else  /* OC_DYNAMIC_ALLOCATION */
     if (avail_bytes < size) {
       OC_WRN("byte pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
       return 0;
     }
     oc_list_add(bytes_list, m);
@@ -98,9 +366,22 @@ _oc_mmem_alloc(
 #ifdef OC_DYNAMIC_ALLOCATION
     m->ptr = malloc(size * sizeof(int64_t));
     m->size = size;
+#elif defined(OC_MMEM_BUDDY)
+    m->ptr = buddy_alloc(INT_POOL, size);
+    if (!m->ptr) {
+      OC_WRN("int pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
+      return 0;
+    }
+    m->size = size;
 #else  /* OC_DYNAMIC_ALLOCATION */
     if (avail_ints < size) {
       OC_WRN("int pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
       return 0;
     }
     oc_list_add(ints_list, m);
@@ -114,9 +395,22 @@ _oc_mmem_alloc(
 #ifdef OC_DYNAMIC_ALLOCATION
     m->ptr = malloc(size * sizeof(double));
     m->size = size;
+#elif defined(OC_MMEM_BUDDY)
+    m->ptr = buddy_alloc(DOUBLE_POOL, size);
+    if (!m->ptr) {
+      OC_WRN("double pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
+      return 0;
+    }
+    m->size = size;
 #else  /* OC_DYNAMIC_ALLOCATION */
     if (avail_doubles < size) {
       OC_WRN("double pool exhausted");
+#ifdef OC_MEMORY_STATS
+      mmem_stats[pool_type].failures++;
+#endif /* OC_MEMORY_STATS */
       return 0;
     }
     oc_list_add(doubles_list, m);
@@ -133,6 +427,21 @@ _oc_mmem_alloc(
   oc_mem_trace_add_pace(func, bytes_allocated, MEM_TRACE_ALLOC, m->ptr);
 #endif
 
+#ifdef OC_MEMORY_STATS
+  if (pool_type <= DOUBLE_POOL) {
+    oc_mmem_stats_t *stats = &mmem_stats[pool_type];
+    if (!m->ptr && size > 0) {
+      stats->failures++;
+    } else {
+      stats->allocs++;
+      stats->in_use += size;
+      if (stats->in_use > stats->peak) {
+        stats->peak = stats->in_use;
+      }
+    }
+  }
+#endif /* OC_MEMORY_STATS */
+
   return (int) bytes_allocated;
 }
 
@@ -147,6 +456,15 @@ _oc_mmem_free(
     OC_ERR("oc_mmem is NULL");
     return;
   }
+  /* Strings that were never set or were already released with oc_free() */
+  if (!m->ptr) {
+    return;
+  }
+#if !defined(OC_DYNAMIC_ALLOCATION) && defined(OC_MMEM_BUDDY)
+  if (!buddy_is_allocated(pool_type, m->ptr, m->size)) {
+    return;
+  }
+#endif /* !OC_DYNAMIC_ALLOCATION && OC_MMEM_BUDDY */
 
 #ifdef OC_MEMORY_TRACE
   unsigned int bytes_freed = m->size;
@@ -163,7 +481,17 @@ _oc_mmem_free(
   oc_mem_trace_add_pace(func, bytes_freed, MEM_TRACE_FREE, m->ptr);
 #endif /* OC_MEMORY_TRACE */
 
+#ifdef OC_MEMORY_STATS
+  if (pool_type <= DOUBLE_POOL && m->ptr &&
+      mmem_stats[pool_type].in_use >= m->size) {
+    mmem_stats[pool_type].in_use -= m->size;
+  }
+#endif /* OC_MEMORY_STATS */
+
 #ifndef OC_DYNAMIC_ALLOCATION
+#ifdef OC_MMEM_BUDDY
+  buddy_free(pool_type, m->ptr, m->size);
+#else  /* OC_MMEM_BUDDY */
   struct oc_mmem *n;
 
   if (m->next != NULL) {
@@ -205,6 +533,7 @@ _oc_mmem_free(
     oc_list_remove(doubles_list, m);
     break;
   }
+#endif /* !OC_MMEM_BUDDY */
 #else /* !OC_DYNAMIC_ALLOCATION */
   (void)pool_type;
   free(m->ptr);
@@ -220,13 +549,61 @@ oc_mmem_init(void)
   if (inited) {
     return;
   }
+#ifdef OC_MMEM_BUDDY
+  buddy_init();
+#else  /* OC_MMEM_BUDDY */
   oc_list_init(bytes_list);
   oc_list_init(ints_list);
   oc_list_init(doubles_list);
   avail_bytes = OC_BYTES_POOL_SIZE;
   avail_ints = OC_INTS_POOL_SIZE;
   avail_doubles = OC_DOUBLES_POOL_SIZE;
+#endif /* !OC_MMEM_BUDDY */
   inited = 1;
 #endif /* OC_DYNAMIC_ALLOCATION */
 }
 /*---------------------------------------------------------------------------*/
+#ifdef OC_MEMORY_STATS
+void
+oc_mmem_get_stats(pool pool_type, oc_mem_pool_stats_t *stats)
+{
+  static const char *names[] = { "bytes", "ints", "doubles" };
+  memset(stats, 0, sizeof(oc_mem_pool_stats_t));
+  if (pool_type > DOUBLE_POOL) {
+    return;
+  }
+  stats->name = names[pool_type];
+  switch (pool_type) {
+  case INT_POOL:
+    stats->unit_size = sizeof(int64_t);
+#ifndef OC_DYNAMIC_ALLOCATION
+    stats->capacity = OC_INTS_POOL_SIZE;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+    break;
+  case DOUBLE_POOL:
+    stats->unit_size = sizeof(double);
+#ifndef OC_DYNAMIC_ALLOCATION
+    stats->capacity = OC_DOUBLES_POOL_SIZE;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+    break;
+  default:
+    stats->unit_size = sizeof(uint8_t);
+#ifndef OC_DYNAMIC_ALLOCATION
+    stats->capacity = OC_BYTES_POOL_SIZE;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+    break;
+  }
+  stats->in_use = mmem_stats[pool_type].in_use;
+  stats->peak = mmem_stats[pool_type].peak;
+  stats->allocs = mmem_stats[pool_type].allocs;
+  stats->failures = mmem_stats[pool_type].failures;
+}
+
+void
+oc_mmem_reset_peak(pool pool_type)
+{
+  if (pool_type <= DOUBLE_POOL) {
+    mmem_stats[pool_type].peak = mmem_stats[pool_type].in_use;
+  }
+}
+#endif /* OC_MEMORY_STATS */
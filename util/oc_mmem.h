@@ -35,6 +35,7 @@
 #ifndef OC_MMEM_H
 #define OC_MMEM_H
 
+#include "oc_config.h"
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -55,6 +56,12 @@ typedef enum { BYTE_POOL, INT_POOL, DOUBLE_POOL } pool;
 
 void oc_mmem_init(void);
 
+#ifdef OC_MEMORY_STATS
+struct oc_mem_pool_stats_t;
+void oc_mmem_get_stats(pool pool_type, struct oc_mem_pool_stats_t *stats);
+void oc_mmem_reset_peak(pool pool_type);
+#endif /* OC_MEMORY_STATS */
+
 #ifdef OC_MEMORY_TRACE
 
 #define oc_mmem_alloc(m, size, pool_type)                                      \
@@ -40,6 +40,10 @@
 #include <stdlib.h>
 #include <string.h>
 #endif /* OC_DYNAMIC_ALLOCATION */
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+#include "oc_atomic_queue.h"
+#include <stdbool.h>
+#endif /* OC_LOCKFREE_PROCESS_EVENTS */
 
 /*
  * Pointer to the currently running process structure.
@@ -59,6 +63,27 @@ struct event_data
   struct oc_process *p;
 };
 
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+/* Events are posted from any thread and taken by the event loop. A post
+ * takes an event from a fixed pool and queues a pointer to it on an
+ * oc_atomic_queue; the loop hands the event back to the pool once it has
+ * copied it out. In dynamic builds the events that do not fit go to an
+ * overflow array that grows as needed, and every post goes there until the
+ * event loop has drained it, so that the events of each thread stay in order.
+ */
+
+static struct event_data event_pool[OC_PROCESS_EVENT_QUEUE_SIZE];
+OC_ATOMIC_QUEUE(free_events, OC_PROCESS_EVENT_QUEUE_SIZE);
+/* At least as large as the pool, so that queueing a pooled event never
+   fails */
+OC_ATOMIC_QUEUE(posted_events, OC_PROCESS_EVENT_QUEUE_SIZE);
+#ifdef OC_DYNAMIC_ALLOCATION
+static struct event_data *overflow;
+static size_t overflow_size, overflow_head, overflow_tail, overflow_count;
+static bool overflow_active;
+static bool overflow_lock;
+#endif /* OC_DYNAMIC_ALLOCATION */
+#else /* OC_LOCKFREE_PROCESS_EVENTS */
 #ifdef OC_DYNAMIC_ALLOCATION
 static unsigned long OC_PROCESS_NUMEVENTS = 10;
 #else /* OC_DYNAMIC_ALLOCATION */
@@ -71,10 +96,9 @@ static struct event_data *events;
 #else  /* OC_DYNAMIC_ALLOCATION */
 static struct event_data events[OC_PROCESS_NUMEVENTS];
 #endif /* !OC_DYNAMIC_ALLOCATION */
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
 
-#if OC_PROCESS_CONF_STATS
-oc_process_num_events_t process_maxevents;
-#endif
+static oc_process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
@@ -194,13 +218,30 @@ void
 oc_process_shutdown(void)
 {
 #ifdef OC_DYNAMIC_ALLOCATION
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  free(overflow);
+  overflow = NULL;
+  overflow_size = overflow_head = overflow_tail = overflow_count = 0;
+  overflow_active = false;
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
   free(events);
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
 #endif /* OC_DYNAMIC_ALLOCATION */
 }
 
 void
 oc_process_init(void)
 {
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  size_t i;
+  while (oc_atomic_queue_pop(&posted_events))
+    ;
+  while (oc_atomic_queue_pop(&free_events))
+    ;
+  for (i = 0; i < OC_PROCESS_EVENT_QUEUE_SIZE; i++) {
+    oc_atomic_queue_push(&free_events, &event_pool[i]);
+  }
+#else /* OC_LOCKFREE_PROCESS_EVENTS */
 #ifdef OC_DYNAMIC_ALLOCATION
   events = (struct event_data *)calloc(OC_PROCESS_NUMEVENTS,
                                        sizeof(struct event_data));
@@ -208,13 +249,11 @@ oc_process_init(void)
     oc_abort("Insufficient memory");
   }
 #endif /* OC_DYNAMIC_ALLOCATION */
+  nevents = fevent = 0;
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
 
   lastevent = OC_PROCESS_EVENT_MAX;
-
-  nevents = fevent = 0;
-#if OC_PROCESS_CONF_STATS
   process_maxevents = 0;
-#endif /* OC_PROCESS_CONF_STATS */
 
   oc_process_current = oc_process_list = NULL;
 }
@@ -228,6 +267,16 @@ do_poll(void)
 {
   struct oc_process *p;
 
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  __atomic_store_n(&poll_requested, 0, __ATOMIC_SEQ_CST);
+  /* Call the processes that needs to be polled. */
+  for (p = oc_process_list; p != NULL; p = p->next) {
+    if (__atomic_exchange_n(&p->needspoll, 0, __ATOMIC_ACQ_REL)) {
+      p->state = OC_PROCESS_STATE_RUNNING;
+      call_process(p, OC_PROCESS_EVENT_POLL, NULL);
+    }
+  }
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
   poll_requested = 0;
   /* Call the processes that needs to be polled. */
   for (p = oc_process_list; p != NULL; p = p->next) {
@@ -237,8 +286,136 @@ do_poll(void)
       call_process(p, OC_PROCESS_EVENT_POLL, NULL);
     }
   }
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
+}
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+/*---------------------------------------------------------------------------*/
+static size_t
+queued_events(void)
+{
+  size_t n = oc_atomic_queue_length(&posted_events);
+#ifdef OC_DYNAMIC_ALLOCATION
+  n += __atomic_load_n(&overflow_count, __ATOMIC_ACQUIRE);
+#endif /* OC_DYNAMIC_ALLOCATION */
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_max_events(void)
+{
+  oc_process_num_events_t n = (oc_process_num_events_t)queued_events();
+  oc_process_num_events_t max =
+    __atomic_load_n(&process_maxevents, __ATOMIC_RELAXED);
+  while (n > max &&
+         !__atomic_compare_exchange_n(&process_maxevents, &max, n, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+/*---------------------------------------------------------------------------*/
+static bool
+queue_push(const struct event_data *event)
+{
+  struct event_data *pooled =
+    (struct event_data *)oc_atomic_queue_pop(&free_events);
+  if (!pooled) {
+    return false;
+  }
+  *pooled = *event;
+  oc_atomic_queue_push(&posted_events, pooled);
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+static bool
+queue_pop(struct event_data *event)
+{
+  struct event_data *pooled =
+    (struct event_data *)oc_atomic_queue_pop(&posted_events);
+  if (!pooled) {
+    return false;
+  }
+  *event = *pooled;
+  oc_atomic_queue_push(&free_events, pooled);
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+#ifdef OC_DYNAMIC_ALLOCATION
+static void
+lock_overflow(void)
+{
+  while (__atomic_test_and_set(&overflow_lock, __ATOMIC_ACQUIRE))
+    ;
 }
 /*---------------------------------------------------------------------------*/
+static void
+unlock_overflow(void)
+{
+  __atomic_clear(&overflow_lock, __ATOMIC_RELEASE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+overflow_push(const struct event_data *event)
+{
+  lock_overflow();
+  if (overflow_tail == overflow_size) {
+    if (overflow_head > 0) {
+      memmove(overflow, &overflow[overflow_head],
+              (overflow_tail - overflow_head) * sizeof(struct event_data));
+      overflow_tail -= overflow_head;
+      overflow_head = 0;
+    } else {
+      overflow_size = overflow_size ? overflow_size << 1
+                                    : OC_PROCESS_EVENT_QUEUE_SIZE;
+      overflow = (struct event_data *)realloc(
+        overflow, overflow_size * sizeof(struct event_data));
+      if (!overflow) {
+        oc_abort("Insufficient memory");
+      }
+    }
+  }
+  overflow[overflow_tail++] = *event;
+  __atomic_add_fetch(&overflow_count, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&overflow_active, true, __ATOMIC_RELEASE);
+  unlock_overflow();
+}
+/*---------------------------------------------------------------------------*/
+static bool
+overflow_pop(struct event_data *event)
+{
+  bool found = false;
+
+  lock_overflow();
+  if (overflow_head < overflow_tail) {
+    *event = overflow[overflow_head++];
+    __atomic_sub_fetch(&overflow_count, 1, __ATOMIC_RELEASE);
+    found = true;
+  }
+  if (overflow_head == overflow_tail) {
+    overflow_head = overflow_tail = 0;
+    __atomic_store_n(&overflow_active, false, __ATOMIC_RELEASE);
+  }
+  unlock_overflow();
+  return found;
+}
+#endif /* OC_DYNAMIC_ALLOCATION */
+/*---------------------------------------------------------------------------*/
+static bool
+take_event(struct event_data *event)
+{
+  if (queue_pop(event)) {
+    return true;
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  /* Overflowed events come after all those in the queue, including any
+     that a producer has claimed a cell for but not yet written. */
+  if (__atomic_load_n(&overflow_active, __ATOMIC_ACQUIRE) &&
+      oc_atomic_queue_is_empty(&posted_events)) {
+    return overflow_pop(event);
+  }
+#endif /* OC_DYNAMIC_ALLOCATION */
+  return false;
+}
+#endif /* OC_LOCKFREE_PROCESS_EVENTS */
+/*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
@@ -260,6 +437,14 @@ do_event(void)
    * call the poll handlers inbetween.
    */
 
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  struct event_data event;
+
+  if (take_event(&event)) {
+    ev = event.ev;
+    data = event.data;
+    receiver = event.p;
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
   if (nevents > 0) {
 
     /* There are events that we should deliver. */
@@ -272,6 +457,7 @@ do_event(void)
        and decrease the number of events. */
     fevent = (fevent + 1) % OC_PROCESS_NUMEVENTS;
     --nevents;
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -311,19 +497,46 @@ oc_process_run(void)
   /* Process one event from the queue */
   do_event();
 
-  return nevents + poll_requested;
+  return oc_process_nevents();
 }
 /*---------------------------------------------------------------------------*/
 int
 oc_process_nevents(void)
 {
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  return (int)queued_events() +
+         __atomic_load_n(&poll_requested, __ATOMIC_ACQUIRE);
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
   return nevents + poll_requested;
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
+}
+/*---------------------------------------------------------------------------*/
+oc_process_num_events_t
+oc_process_max_events(void)
+{
+  return process_maxevents;
 }
 /*---------------------------------------------------------------------------*/
 int
 oc_process_post(struct oc_process *p, oc_process_event_t ev,
                 oc_process_data_t data)
 {
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+  struct event_data event = { ev, data, p };
+
+#ifdef OC_DYNAMIC_ALLOCATION
+  if (__atomic_load_n(&overflow_active, __ATOMIC_ACQUIRE) ||
+      !queue_push(&event)) {
+    overflow_push(&event);
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+  if (!queue_push(&event)) {
+    return OC_PROCESS_ERR_FULL;
+  }
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  update_max_events();
+  return OC_PROCESS_ERR_OK;
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
   static oc_process_num_events_t snum;
 
   if (nevents == OC_PROCESS_NUMEVENTS) {
@@ -356,13 +569,12 @@ oc_process_post(struct oc_process *p, oc_process_event_t ev,
   events[snum].p = p;
   ++nevents;
 
-#if OC_PROCESS_CONF_STATS
   if (nevents > process_maxevents) {
     process_maxevents = nevents;
   }
-#endif /* OC_PROCESS_CONF_STATS */
 
   return OC_PROCESS_ERR_OK;
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -381,8 +593,13 @@ oc_process_poll(struct oc_process *p)
   if (p != NULL) {
     if (p->state == OC_PROCESS_STATE_RUNNING ||
         p->state == OC_PROCESS_STATE_CALLED) {
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+      __atomic_store_n(&p->needspoll, 1, __ATOMIC_RELEASE);
+      __atomic_store_n(&poll_requested, 1, __ATOMIC_SEQ_CST);
+#else  /* OC_LOCKFREE_PROCESS_EVENTS */
       p->needspoll = 1;
       poll_requested = 1;
+#endif /* !OC_LOCKFREE_PROCESS_EVENTS */
     }
   }
 }
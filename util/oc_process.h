@@ -61,6 +61,13 @@ typedef unsigned long oc_process_num_events_t;
 typedef unsigned char oc_process_num_events_t;
 #endif
 
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+/* Number of posted events that the lock-free queue holds */
+#ifndef OC_PROCESS_EVENT_QUEUE_SIZE
+#define OC_PROCESS_EVENT_QUEUE_SIZE (64)
+#endif /* !OC_PROCESS_EVENT_QUEUE_SIZE */
+#endif /* OC_LOCKFREE_PROCESS_EVENTS */
+
 /**
  * \name Return values
  * @{
@@ -352,6 +359,9 @@ void oc_process_start(struct oc_process *p, oc_process_data_t data);
  * all processes, in which case all processes in the system will be
  * scheduled to handle the event.
  *
+ * With OC_LOCKFREE_PROCESS_EVENTS it may be called from any thread,
+ * which should then wake the event loop with _oc_signal_event_loop().
+ *
  * \param ev The event to be posted.
  *
  * \param data The auxiliary data to be sent with the event
@@ -525,6 +535,14 @@ int oc_process_is_running(struct oc_process *p);
  */
 int oc_process_nevents(void);
 
+/**
+ * Highest number of events that have been waiting to be processed at
+ * once since oc_process_init().
+ *
+ * \return The high-water mark of the event queue.
+ */
+oc_process_num_events_t oc_process_max_events(void);
+
 /** @} */
 
 extern struct oc_process *oc_process_list;
@@ -33,6 +33,10 @@
  */
 
 #include "oc_timer.h"
+#include <stdbool.h>
+
+static oc_clock_time_t held_now;
+static bool now_held;
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -50,7 +54,7 @@ void
 oc_timer_set(struct oc_timer *t, oc_clock_time_t interval)
 {
   t->interval = interval;
-  t->start = oc_clock_time();
+  t->start = oc_timer_now();
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -90,7 +94,7 @@ oc_timer_reset(struct oc_timer *t)
 void
 oc_timer_restart(struct oc_timer *t)
 {
-  t->start = oc_clock_time();
+  t->start = oc_timer_now();
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -109,7 +113,7 @@ oc_timer_expired(struct oc_timer *t)
 {
   /* Note: Can not return diff >= t->interval so we add 1 to diff and return
      t->interval < diff - required to avoid an internal error in mspgcc. */
-  oc_clock_time_t diff = (oc_clock_time() - t->start) + 1;
+  oc_clock_time_t diff = (oc_timer_now() - t->start) + 1;
   return t->interval < diff;
 }
 /*---------------------------------------------------------------------------*/
@@ -126,6 +130,49 @@ oc_timer_expired(struct oc_timer *t)
 oc_clock_time_t
 oc_timer_remaining(struct oc_timer *t)
 {
-  return t->start + t->interval - oc_clock_time();
+  return t->start + t->interval - oc_timer_now();
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * The current time for timers
+ *
+ * This function returns the time that timers are set and checked
+ * against. It is read from the monotonic clock, or from the time held
+ * by oc_timer_hold_now() until oc_timer_release_now() is called.
+ *
+ * \return The current time, measured in system ticks.
+ */
+oc_clock_time_t
+oc_timer_now(void)
+{
+  return now_held ? held_now : oc_clock_time_monotonic();
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Read the clock once for a pass of the event loop
+ *
+ * This function is called by oc_main_poll() before running the next
+ * process, so that the timers it checks and sets need not each read the
+ * clock. A timer set meanwhile starts at most one pass early.
+ *
+ * \sa oc_timer_release_now()
+ */
+void
+oc_timer_hold_now(void)
+{
+  held_now = oc_clock_time_monotonic();
+  now_held = true;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Read the clock again on every call to oc_timer_now()
+ *
+ * This function is called by oc_main_poll() when it returns, as timers
+ * may be set from outside the event loop while it waits.
+ */
+void
+oc_timer_release_now(void)
+{
+  now_held = false;
 }
 /*---------------------------------------------------------------------------*/
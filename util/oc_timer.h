@@ -90,6 +90,10 @@ void oc_timer_restart(struct oc_timer *t);
 int oc_timer_expired(struct oc_timer *t);
 oc_clock_time_t oc_timer_remaining(struct oc_timer *t);
 
+oc_clock_time_t oc_timer_now(void);
+void oc_timer_hold_now(void);
+void oc_timer_release_now(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,121 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstdint>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "util/oc_atomic_queue.h"
+
+#if defined(OC_LOCKFREE_NETWORK_EVENTS) || defined(OC_LOCKFREE_PROCESS_EVENTS)
+#define VALUE(i) ((void *)(uintptr_t)((i) + 1))
+
+TEST(TestAtomicQueue, CapacityIsRoundedUp)
+{
+  EXPECT_EQ(1, OC_ATOMIC_QUEUE_CAPACITY(1));
+  EXPECT_EQ(8, OC_ATOMIC_QUEUE_CAPACITY(8));
+  EXPECT_EQ(16, OC_ATOMIC_QUEUE_CAPACITY(9));
+  EXPECT_EQ(128, OC_ATOMIC_QUEUE_CAPACITY(100));
+}
+
+TEST(TestAtomicQueue, FifoUntilFull)
+{
+  OC_ATOMIC_QUEUE(queue, 6);
+  EXPECT_TRUE(oc_atomic_queue_is_empty(&queue));
+  EXPECT_EQ(nullptr, oc_atomic_queue_pop(&queue));
+
+  int i;
+  for (i = 0; i < 8; i++) {
+    ASSERT_TRUE(oc_atomic_queue_push(&queue, VALUE(i)));
+  }
+  EXPECT_FALSE(oc_atomic_queue_push(&queue, VALUE(i)));
+  EXPECT_FALSE(oc_atomic_queue_is_empty(&queue));
+  EXPECT_EQ(8u, oc_atomic_queue_length(&queue));
+
+  for (i = 0; i < 8; i++) {
+    EXPECT_EQ(VALUE(i), oc_atomic_queue_pop(&queue));
+  }
+  EXPECT_EQ(nullptr, oc_atomic_queue_pop(&queue));
+  EXPECT_TRUE(oc_atomic_queue_is_empty(&queue));
+  EXPECT_EQ(0u, oc_atomic_queue_length(&queue));
+}
+
+TEST(TestAtomicQueue, WrapsAround)
+{
+  OC_ATOMIC_QUEUE(queue, 4);
+  int pushed = 0, popped = 0;
+  while (pushed < 100) {
+    while (oc_atomic_queue_push(&queue, VALUE(pushed))) {
+      pushed++;
+    }
+    EXPECT_EQ(4u, oc_atomic_queue_length(&queue));
+    /* Leave some behind, so that the positions drift across the cells */
+    EXPECT_EQ(VALUE(popped), oc_atomic_queue_pop(&queue));
+    popped++;
+    EXPECT_EQ(VALUE(popped), oc_atomic_queue_pop(&queue));
+    popped++;
+    EXPECT_EQ(VALUE(popped), oc_atomic_queue_pop(&queue));
+    popped++;
+  }
+  void *data;
+  while ((data = oc_atomic_queue_pop(&queue)) != NULL) {
+    EXPECT_EQ(VALUE(popped), data);
+    popped++;
+  }
+  EXPECT_EQ(pushed, popped);
+}
+
+TEST(TestAtomicQueue, ConcurrentProducers)
+{
+  OC_ATOMIC_QUEUE(queue, 16);
+  const int num_producers = 4, num_values = 10000;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([p, num_values] {
+      for (int i = 0; i < num_values; i++) {
+        while (!oc_atomic_queue_push(
+          &queue, VALUE((uintptr_t)p * num_values + i))) {
+          sched_yield();
+        }
+      }
+    });
+  }
+
+  /* Every producer's values must come out in the order they went in */
+  std::vector<int> next(num_producers, 0);
+  int received = 0;
+  while (received < num_producers * num_values) {
+    void *data = oc_atomic_queue_pop(&queue);
+    if (!data) {
+      sched_yield();
+      continue;
+    }
+    int value = (int)((uintptr_t)data - 1);
+    int p = value / num_values;
+    ASSERT_LT(p, num_producers);
+    EXPECT_EQ(next[p], value % num_values);
+    next[p] = value % num_values + 1;
+    received++;
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(oc_atomic_queue_is_empty(&queue));
+}
+#endif /* OC_LOCKFREE_NETWORK_EVENTS || OC_LOCKFREE_PROCESS_EVENTS */
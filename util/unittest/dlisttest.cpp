@@ -0,0 +1,157 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "util/oc_list.h"
+
+typedef struct item_t
+{
+  struct item_t *next;
+  struct item_t *prev;
+  int value;
+} item_t;
+
+class TestDList : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    oc_dlist_init(&list);
+    memset(items, 0, sizeof(items));
+    for (int i = 0; i < 4; i++) {
+      items[i].value = i;
+    }
+  }
+
+  /* Values from head to tail, checking the links both ways */
+  std::vector<int> values()
+  {
+    std::vector<int> v;
+    item_t *prev = NULL;
+    item_t *item = (item_t *)oc_dlist_head(&list);
+    for (; item != NULL; item = (item_t *)oc_list_item_next(item)) {
+      EXPECT_EQ(prev, oc_dlist_item_prev(item));
+      v.push_back(item->value);
+      prev = item;
+    }
+    EXPECT_EQ(prev, oc_dlist_tail(&list));
+    EXPECT_EQ((int)v.size(), oc_dlist_length(&list));
+    return v;
+  }
+
+  void add_all()
+  {
+    for (int i = 0; i < 4; i++) {
+      oc_dlist_add(&list, &items[i]);
+    }
+  }
+
+  struct oc_dlist list;
+  item_t items[4];
+};
+
+TEST_F(TestDList, AddAndPush)
+{
+  EXPECT_EQ(NULL, oc_dlist_head(&list));
+  EXPECT_EQ(NULL, oc_dlist_tail(&list));
+  EXPECT_EQ(0, oc_dlist_length(&list));
+
+  oc_dlist_add(&list, &items[1]);
+  oc_dlist_add(&list, &items[2]);
+  oc_dlist_push(&list, &items[0]);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2 }), values());
+
+  oc_dlist_insert(&list, &items[2], &items[3]);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), values());
+}
+
+TEST_F(TestDList, RemoveHead)
+{
+  add_all();
+  oc_dlist_remove(&list, &items[0]);
+  EXPECT_EQ(std::vector<int>({ 1, 2, 3 }), values());
+  EXPECT_EQ(NULL, items[0].next);
+  EXPECT_EQ(NULL, items[0].prev);
+}
+
+TEST_F(TestDList, RemoveMiddle)
+{
+  add_all();
+  oc_dlist_remove(&list, &items[2]);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 3 }), values());
+  oc_dlist_remove(&list, &items[1]);
+  EXPECT_EQ(std::vector<int>({ 0, 3 }), values());
+}
+
+TEST_F(TestDList, RemoveTail)
+{
+  add_all();
+  oc_dlist_remove(&list, &items[3]);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2 }), values());
+  EXPECT_EQ(&items[2], oc_dlist_chop(&list));
+  EXPECT_EQ(std::vector<int>({ 0, 1 }), values());
+}
+
+TEST_F(TestDList, RemoveItemNotOnList)
+{
+  add_all();
+  oc_dlist_remove(&list, &items[1]);
+  oc_dlist_remove(&list, &items[1]);
+  oc_dlist_remove(&list, NULL);
+  EXPECT_EQ(std::vector<int>({ 0, 2, 3 }), values());
+}
+
+TEST_F(TestDList, PopUntilEmpty)
+{
+  add_all();
+  for (int i = 0; i < 4; i++) {
+    item_t *item = (item_t *)oc_dlist_pop(&list);
+    ASSERT_NE((item_t *)NULL, item);
+    EXPECT_EQ(i, item->value);
+    EXPECT_EQ(3 - i, oc_dlist_length(&list));
+  }
+  EXPECT_EQ(NULL, oc_dlist_pop(&list));
+  EXPECT_EQ(NULL, oc_dlist_head(&list));
+  EXPECT_EQ(NULL, oc_dlist_tail(&list));
+  EXPECT_EQ(0, oc_dlist_length(&list));
+}
+
+TEST_F(TestDList, PushDoesNotDeduplicate)
+{
+  /* oc_list_push() moves an item that is already on the list to the front */
+  OC_LIST(slist);
+  oc_list_add(slist, &items[0]);
+  oc_list_add(slist, &items[1]);
+  oc_list_push(slist, &items[1]);
+  EXPECT_EQ(2, oc_list_length(slist));
+  EXPECT_EQ(&items[1], oc_list_head(slist));
+
+  /* The doubly linked list does not search for it, so an item is removed
+   * before being added again */
+  add_all();
+  oc_dlist_remove(&list, &items[3]);
+  oc_dlist_push(&list, &items[3]);
+  EXPECT_EQ(4, oc_dlist_length(&list));
+  EXPECT_EQ(&items[3], oc_dlist_head(&list));
+  EXPECT_EQ(&items[2], oc_dlist_tail(&list));
+  oc_dlist_remove(&list, &items[0]);
+  oc_dlist_add(&list, &items[0]);
+  EXPECT_EQ(4, oc_dlist_length(&list));
+  EXPECT_EQ(&items[0], oc_dlist_tail(&list));
+}
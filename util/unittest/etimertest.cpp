@@ -0,0 +1,242 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "port/oc_clock.h"
+#include "util/oc_etimer.h"
+#include "util/oc_process.h"
+
+/* The timers run on this clock instead of the port's, so that a test can
+ * move time forward by any amount at once. */
+static oc_clock_time_t fake_now = 1000 * OC_CLOCK_SECOND;
+
+extern "C" oc_clock_time_t
+oc_clock_time(void)
+{
+  return fake_now;
+}
+
+#ifdef OC_CLOCK_MONOTONIC
+extern "C" oc_clock_time_t
+oc_clock_time_monotonic(void)
+{
+  return fake_now;
+}
+#endif /* OC_CLOCK_MONOTONIC */
+
+/* Timers expired so far, in the order their events arrived */
+static std::vector<struct oc_etimer *> fired;
+/* Invoked by timer_process for each timer event, if set */
+static void (*on_timer)(struct oc_etimer *t);
+
+OC_PROCESS(timer_process, "etimer test");
+OC_PROCESS_THREAD(timer_process, ev, data)
+{
+  OC_PROCESS_BEGIN();
+  while (1) {
+    OC_PROCESS_YIELD();
+    if (ev == OC_PROCESS_EVENT_TIMER) {
+      struct oc_etimer *t = (struct oc_etimer *)data;
+      fired.push_back(t);
+      if (on_timer) {
+        on_timer(t);
+      }
+    }
+  }
+  OC_PROCESS_END();
+}
+
+class TestEtimer : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    fired.clear();
+    on_timer = NULL;
+    oc_process_init();
+    oc_process_start(&oc_etimer_process, NULL);
+    oc_process_start(&timer_process, NULL);
+  }
+
+  virtual void TearDown()
+  {
+    oc_process_exit(&timer_process);
+    EXPECT_EQ(0, oc_etimer_pending());
+    oc_process_exit(&oc_etimer_process);
+    oc_process_shutdown();
+  }
+
+  /* Sets et on behalf of timer_process, like it would itself */
+  static void set(struct oc_etimer *et, oc_clock_time_t interval)
+  {
+    OC_PROCESS_CONTEXT_BEGIN(&timer_process);
+    oc_etimer_set(et, interval);
+    OC_PROCESS_CONTEXT_END(&timer_process);
+  }
+
+  /* Moves the clock forward by the given time in steps, running the event
+   * loop after each step */
+  static void advance(oc_clock_time_t time, oc_clock_time_t step)
+  {
+    while (time > 0) {
+      oc_clock_time_t by = time < step ? time : step;
+      fake_now += by;
+      time -= by;
+      oc_etimer_request_poll();
+      while (oc_process_run()) {
+      }
+    }
+  }
+};
+
+TEST_F(TestEtimer, ExpiresAfterMoreThanOneTurn)
+{
+  /* A full turn of the wheel takes 8 seconds by default */
+  struct oc_etimer et = {};
+  set(&et, 20 * OC_CLOCK_SECOND);
+  EXPECT_EQ(fake_now + 20 * OC_CLOCK_SECOND,
+            oc_etimer_next_expiration_time());
+
+  /* The slot of the timer is checked twice before it expires */
+  advance(20 * OC_CLOCK_SECOND - 1, OC_CLOCK_SECOND / 8);
+  EXPECT_TRUE(fired.empty());
+  EXPECT_FALSE(oc_etimer_expired(&et));
+
+  advance(1, 1);
+  ASSERT_EQ(1u, fired.size());
+  EXPECT_EQ(&et, fired[0]);
+  EXPECT_TRUE(oc_etimer_expired(&et));
+}
+
+TEST_F(TestEtimer, ExpiresAfterLongSleep)
+{
+  struct oc_etimer first = {}, second = {};
+  set(&first, 3 * OC_CLOCK_SECOND);
+  set(&second, 30 * OC_CLOCK_SECOND);
+
+  /* No poll for several turns of the wheel */
+  advance(25 * OC_CLOCK_SECOND, 25 * OC_CLOCK_SECOND);
+  ASSERT_EQ(1u, fired.size());
+  EXPECT_EQ(&first, fired[0]);
+  EXPECT_EQ(fake_now + 5 * OC_CLOCK_SECOND,
+            oc_etimer_next_expiration_time());
+
+  advance(5 * OC_CLOCK_SECOND, OC_CLOCK_SECOND);
+  ASSERT_EQ(2u, fired.size());
+  EXPECT_EQ(&second, fired[1]);
+}
+
+static struct oc_etimer periodic;
+
+static void
+reset_periodic(struct oc_etimer *t)
+{
+  if (t == &periodic && fired.size() < 3) {
+    oc_etimer_reset(t);
+  }
+}
+
+TEST_F(TestEtimer, RestartFromTimerEvent)
+{
+  on_timer = reset_periodic;
+  set(&periodic, OC_CLOCK_SECOND);
+
+  advance(10 * OC_CLOCK_SECOND, OC_CLOCK_SECOND / 4);
+  EXPECT_EQ(3u, fired.size());
+  EXPECT_TRUE(oc_etimer_expired(&periodic));
+}
+
+static struct oc_etimer first_timer, stopped_timer, later_timer;
+
+static void
+stop_other_timer(struct oc_etimer *t)
+{
+  if (t == &first_timer) {
+    oc_etimer_stop(&stopped_timer);
+    OC_PROCESS_CONTEXT_BEGIN(&timer_process);
+    oc_etimer_set(&later_timer, 10 * OC_CLOCK_SECOND);
+    OC_PROCESS_CONTEXT_END(&timer_process);
+  }
+}
+
+TEST_F(TestEtimer, StopFromTimerEvent)
+{
+  on_timer = stop_other_timer;
+  set(&first_timer, OC_CLOCK_SECOND);
+  set(&stopped_timer, 2 * OC_CLOCK_SECOND);
+
+  advance(OC_CLOCK_SECOND, OC_CLOCK_SECOND);
+  ASSERT_EQ(1u, fired.size());
+  EXPECT_TRUE(oc_etimer_expired(&stopped_timer));
+  EXPECT_EQ(fake_now + 10 * OC_CLOCK_SECOND,
+            oc_etimer_next_expiration_time());
+
+  advance(10 * OC_CLOCK_SECOND, OC_CLOCK_SECOND);
+  ASSERT_EQ(2u, fired.size());
+  EXPECT_EQ(&later_timer, fired[1]);
+}
+
+TEST_F(TestEtimer, NextExpirationAfterStop)
+{
+  struct oc_etimer soon = {}, later = {}, next_turn = {};
+  set(&soon, OC_CLOCK_SECOND);
+  /* Its slot comes before the one of later, but on the next turn */
+  set(&next_turn, 10 * OC_CLOCK_SECOND);
+  set(&later, 5 * OC_CLOCK_SECOND);
+  EXPECT_EQ(fake_now + OC_CLOCK_SECOND, oc_etimer_next_expiration_time());
+
+  oc_etimer_stop(&soon);
+  EXPECT_EQ(fake_now + 5 * OC_CLOCK_SECOND, oc_etimer_next_expiration_time());
+  oc_etimer_stop(&later);
+  EXPECT_EQ(fake_now + 10 * OC_CLOCK_SECOND,
+            oc_etimer_next_expiration_time());
+  oc_etimer_stop(&next_turn);
+  EXPECT_EQ(0, oc_etimer_pending());
+  EXPECT_EQ(0u, oc_etimer_next_expiration_time());
+}
+
+TEST_F(TestEtimer, SetTimerWithStaleContents)
+{
+  struct oc_etimer et, other = {};
+  set(&other, 2 * OC_CLOCK_SECOND);
+  memset(&et, 0xff, sizeof(et));
+  set(&et, OC_CLOCK_SECOND);
+  EXPECT_EQ(fake_now + OC_CLOCK_SECOND, oc_etimer_next_expiration_time());
+
+  advance(2 * OC_CLOCK_SECOND, OC_CLOCK_SECOND);
+  ASSERT_EQ(2u, fired.size());
+  EXPECT_EQ(&et, fired[0]);
+  EXPECT_EQ(&other, fired[1]);
+}
+
+TEST_F(TestEtimer, ExpiresInDeadlineOrder)
+{
+  struct oc_etimer timers[4] = {};
+  set(&timers[0], 3 * OC_CLOCK_SECOND);
+  set(&timers[1], OC_CLOCK_SECOND);
+  set(&timers[2], 9 * OC_CLOCK_SECOND);
+  set(&timers[3], 2 * OC_CLOCK_SECOND);
+
+  advance(10 * OC_CLOCK_SECOND, OC_CLOCK_SECOND / 8);
+  ASSERT_EQ(4u, fired.size());
+  EXPECT_EQ(&timers[1], fired[0]);
+  EXPECT_EQ(&timers[3], fired[1]);
+  EXPECT_EQ(&timers[0], fired[2]);
+  EXPECT_EQ(&timers[2], fired[3]);
+}
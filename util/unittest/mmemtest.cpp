@@ -0,0 +1,155 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "util/oc_mmem.h"
+
+class TestMmem : public testing::Test
+{
+protected:
+  virtual void SetUp() { oc_mmem_init(); }
+};
+
+TEST_F(TestMmem, AllocAndFree)
+{
+  struct oc_mmem bytes, ints;
+  memset(&bytes, 0, sizeof(bytes));
+  memset(&ints, 0, sizeof(ints));
+
+  EXPECT_EQ(16u, oc_mmem_alloc(&bytes, 16, BYTE_POOL));
+  ASSERT_NE(nullptr, bytes.ptr);
+  memset(bytes.ptr, 0xab, 16);
+  EXPECT_EQ(4 * sizeof(int64_t), oc_mmem_alloc(&ints, 4, INT_POOL));
+  ASSERT_NE(nullptr, ints.ptr);
+  int64_t *i = (int64_t *)ints.ptr;
+  i[0] = i[3] = -1;
+
+  oc_mmem_free(&ints, INT_POOL);
+  oc_mmem_free(&bytes, BYTE_POOL);
+}
+
+TEST_F(TestMmem, FreeUnsetIsIgnored)
+{
+  struct oc_mmem m;
+  memset(&m, 0, sizeof(m));
+  oc_mmem_free(&m, BYTE_POOL);
+  oc_mmem_free(&m, INT_POOL);
+  oc_mmem_free(&m, DOUBLE_POOL);
+}
+
+#if !defined(OC_DYNAMIC_ALLOCATION) && defined(OC_MMEM_BUDDY)
+#define BLOCK_SIZE (8)
+
+/* Size in bytes of the largest block of the bytes pool */
+static size_t
+largest_block(void)
+{
+  size_t size = BLOCK_SIZE;
+  while (size * 2 <= OC_BYTES_POOL_SIZE) {
+    size *= 2;
+  }
+  return size;
+}
+
+TEST_F(TestMmem, BuddiesMerge)
+{
+  std::vector<struct oc_mmem> blocks(OC_BYTES_POOL_SIZE / BLOCK_SIZE);
+  size_t i, n = 0;
+  for (i = 0; i < blocks.size(); i++) {
+    memset(&blocks[i], 0, sizeof(struct oc_mmem));
+    if (oc_mmem_alloc(&blocks[i], BLOCK_SIZE, BYTE_POOL) == 0) {
+      break;
+    }
+    n++;
+  }
+  EXPECT_EQ(blocks.size(), n);
+
+  struct oc_mmem large;
+  memset(&large, 0, sizeof(large));
+  EXPECT_EQ(0u, oc_mmem_alloc(&large, BLOCK_SIZE, BYTE_POOL));
+
+  /* Free every other block first, so that no block is merged until the
+   * second pass */
+  for (i = 0; i < n; i += 2) {
+    oc_mmem_free(&blocks[i], BYTE_POOL);
+  }
+  EXPECT_EQ(0u, oc_mmem_alloc(&large, 2 * BLOCK_SIZE, BYTE_POOL));
+  for (i = 1; i < n; i += 2) {
+    oc_mmem_free(&blocks[i], BYTE_POOL);
+  }
+
+  EXPECT_EQ(largest_block(), oc_mmem_alloc(&large, largest_block(), BYTE_POOL));
+  oc_mmem_free(&large, BYTE_POOL);
+}
+
+TEST_F(TestMmem, DoubleFreeIsRejected)
+{
+  struct oc_mmem a, b, c, d;
+  memset(&a, 0, sizeof(a));
+  memset(&b, 0, sizeof(b));
+  memset(&c, 0, sizeof(c));
+  memset(&d, 0, sizeof(d));
+  ASSERT_NE(0u, oc_mmem_alloc(&a, BLOCK_SIZE, BYTE_POOL));
+  ASSERT_NE(0u, oc_mmem_alloc(&b, BLOCK_SIZE, BYTE_POOL));
+
+  struct oc_mmem again = a;
+  oc_mmem_free(&a, BYTE_POOL);
+  oc_mmem_free(&again, BYTE_POOL);
+
+  /* The block was put back once, so it cannot be handed out twice */
+  ASSERT_NE(0u, oc_mmem_alloc(&c, BLOCK_SIZE, BYTE_POOL));
+  ASSERT_NE(0u, oc_mmem_alloc(&d, BLOCK_SIZE, BYTE_POOL));
+  EXPECT_NE(c.ptr, d.ptr);
+  EXPECT_NE(b.ptr, c.ptr);
+  EXPECT_NE(b.ptr, d.ptr);
+
+  oc_mmem_free(&b, BYTE_POOL);
+  oc_mmem_free(&c, BYTE_POOL);
+  oc_mmem_free(&d, BYTE_POOL);
+
+  struct oc_mmem large;
+  memset(&large, 0, sizeof(large));
+  EXPECT_EQ(largest_block(), oc_mmem_alloc(&large, largest_block(), BYTE_POOL));
+  oc_mmem_free(&large, BYTE_POOL);
+}
+
+TEST_F(TestMmem, ForeignPointerIsRejected)
+{
+  struct oc_mmem m;
+  memset(&m, 0, sizeof(m));
+  ASSERT_NE(0u, oc_mmem_alloc(&m, 4 * BLOCK_SIZE, BYTE_POOL));
+
+  unsigned char outside[BLOCK_SIZE];
+  struct oc_mmem bad = m;
+  bad.ptr = outside;
+  oc_mmem_free(&bad, BYTE_POOL);
+  bad.ptr = (unsigned char *)m.ptr + 1;
+  oc_mmem_free(&bad, BYTE_POOL);
+  bad.ptr = (unsigned char *)m.ptr + BLOCK_SIZE;
+  oc_mmem_free(&bad, BYTE_POOL);
+
+  oc_mmem_free(&m, BYTE_POOL);
+
+  struct oc_mmem large;
+  memset(&large, 0, sizeof(large));
+  EXPECT_EQ(largest_block(), oc_mmem_alloc(&large, largest_block(), BYTE_POOL));
+  oc_mmem_free(&large, BYTE_POOL);
+}
+#endif /* !OC_DYNAMIC_ALLOCATION && OC_MMEM_BUDDY */
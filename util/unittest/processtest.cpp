@@ -0,0 +1,173 @@
+/******************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstdint>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "util/oc_process.h"
+
+#ifdef OC_LOCKFREE_PROCESS_EVENTS
+#define NUM_THREADS 4
+#define DATA(thread, i) ((oc_process_data_t)(uintptr_t)((thread) << 16 | (i)))
+
+static oc_process_event_t test_event;
+/* Data of the test events received, in the order they arrived */
+static std::vector<uintptr_t> received;
+
+OC_PROCESS(sink_process, "process test");
+OC_PROCESS_THREAD(sink_process, ev, data)
+{
+  OC_PROCESS_BEGIN();
+  while (1) {
+    OC_PROCESS_YIELD();
+    if (ev == test_event) {
+      received.push_back((uintptr_t)data);
+    }
+  }
+  OC_PROCESS_END();
+}
+
+class TestProcess : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    received.clear();
+    oc_process_init();
+    test_event = oc_process_alloc_event();
+    oc_process_start(&sink_process, NULL);
+    run();
+  }
+
+  virtual void TearDown()
+  {
+    oc_process_exit(&sink_process);
+    EXPECT_EQ(0, oc_process_nevents());
+    oc_process_shutdown();
+  }
+
+  static void run()
+  {
+    while (oc_process_run()) {
+    }
+  }
+
+  /* Posts count events, waiting for the event loop whenever the queue is
+   * full */
+  static void post(uintptr_t thread, int count)
+  {
+    for (int i = 0; i < count; i++) {
+      while (oc_process_post(&sink_process, test_event, DATA(thread, i)) !=
+             OC_PROCESS_ERR_OK) {
+        sched_yield();
+      }
+    }
+  }
+
+  /* Checks that every thread's count events arrived, in the order they
+   * were posted */
+  static void expect_received(int count)
+  {
+    std::vector<int> next(NUM_THREADS, 0);
+    for (uintptr_t data : received) {
+      uintptr_t thread = data >> 16;
+      ASSERT_LT(thread, (uintptr_t)NUM_THREADS);
+      EXPECT_EQ(next[thread], (int)(data & 0xffff));
+      next[thread] = (int)(data & 0xffff) + 1;
+    }
+    EXPECT_EQ((size_t)NUM_THREADS * count, received.size());
+  }
+};
+
+TEST_F(TestProcess, PostsFromManyThreads)
+{
+  const int count = 2000;
+  std::vector<std::thread> threads;
+  bool done = false;
+  for (uintptr_t t = 0; t < NUM_THREADS; t++) {
+    threads.emplace_back([t, count] { post(t, count); });
+  }
+  std::thread joiner([&threads, &done] {
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+  });
+
+  while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+    if (!oc_process_run()) {
+      sched_yield();
+    }
+  }
+  joiner.join();
+  run();
+  expect_received(count);
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+TEST_F(TestProcess, SpillsIntoOverflowAndDrainsBack)
+{
+  /* Well beyond what the lock-free queue holds, with the loop not
+   * running */
+  const int count = 3 * OC_PROCESS_EVENT_QUEUE_SIZE;
+  std::vector<std::thread> threads;
+  for (uintptr_t t = 0; t < NUM_THREADS; t++) {
+    threads.emplace_back([t, count] { post(t, count); });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(NUM_THREADS * count, oc_process_nevents());
+  EXPECT_LE(NUM_THREADS * count, (int)oc_process_max_events());
+
+  run();
+  expect_received(count);
+
+  /* Once drained, posts go through the queue again and keep their order */
+  received.clear();
+  for (uintptr_t t = 0; t < NUM_THREADS; t++) {
+    post(t, OC_PROCESS_EVENT_QUEUE_SIZE / NUM_THREADS);
+  }
+  EXPECT_EQ(OC_PROCESS_EVENT_QUEUE_SIZE, oc_process_nevents());
+  run();
+  expect_received(OC_PROCESS_EVENT_QUEUE_SIZE / NUM_THREADS);
+}
+#else  /* OC_DYNAMIC_ALLOCATION */
+TEST_F(TestProcess, RejectsPostsWhileFull)
+{
+  int i;
+  for (i = 0; i < OC_PROCESS_EVENT_QUEUE_SIZE; i++) {
+    ASSERT_EQ(OC_PROCESS_ERR_OK,
+              oc_process_post(&sink_process, test_event, DATA(0, i)));
+  }
+  EXPECT_EQ(OC_PROCESS_ERR_FULL,
+            oc_process_post(&sink_process, test_event, DATA(0, i)));
+
+  /* Taking one event makes room for one more */
+  oc_process_run();
+  EXPECT_EQ(OC_PROCESS_ERR_OK,
+            oc_process_post(&sink_process, test_event, DATA(0, i)));
+  run();
+  ASSERT_EQ((size_t)OC_PROCESS_EVENT_QUEUE_SIZE + 1, received.size());
+  for (i = 0; i <= OC_PROCESS_EVENT_QUEUE_SIZE; i++) {
+    EXPECT_EQ((uintptr_t)DATA(0, i), received[i]);
+  }
+}
+#endif /* !OC_DYNAMIC_ALLOCATION */
+#endif /* OC_LOCKFREE_PROCESS_EVENTS */